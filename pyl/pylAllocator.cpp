@@ -0,0 +1,539 @@
+/*      This program is free software; you can redistribute it and/or modify
+*      it under the terms of the GNU General Public License as published by
+*      the Free Software Foundation; either version 3 of the License, or
+*      (at your option) any later version.
+*
+*      This program is distributed in the hope that it will be useful,
+*      but WITHOUT ANY WARRANTY; without even the implied warranty of
+*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*      GNU General Public License for more details.
+*
+*      You should have received a copy of the GNU General Public License
+*      along with this program; if not, write to the Free Software
+*      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+*      MA 02110-1301, USA.
+*
+*      Author:
+*      John Joseph
+*
+*/
+
+
+#include "pyliaison.h"
+
+#include <mutex>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// An allocator for python's object and memory domains. Small blocks come from per thread
+// pools of fixed size classes, carved out of aligned chunks that each hold one size class
+// (much like pymalloc's pools, but without the arena bookkeeping.) Chunk addresses are kept
+// in a radix map so that freeing a block doesn't need a header in front of it. Anything
+// larger goes to the allocator we replaced, behind a small header recording its size.
+// Live and peak bytes are counted as we go, and allocations that would go past
+// the memory cap fail (which python reports as a MemoryError.)
+
+namespace pyl
+{
+	static const size_t c_uClassSize = 16;          /*!< Size classes are multiples of this (python's alignment)*/
+	static const size_t c_uNumClasses = 32;         /*!< So pools serve up to 512 bytes, like pymalloc*/
+	static const size_t c_uMaxPooled = c_uClassSize * c_uNumClasses;
+	static const size_t c_uChunkBits = 16;
+	static const size_t c_uChunkSize = size_t( 1 ) << c_uChunkBits; /*!< Chunks are this big, and aligned to it*/
+
+	// Sits at the start of each chunk, tells us the size class of its blocks
+	struct alignas( 16 ) _ChunkHeader
+	{
+		uint32_t uClass;
+	};
+
+	// Sits in front of blocks from the allocator we replaced
+	struct alignas( 16 ) _BlockHeader
+	{
+		size_t uSize;     /*!< The size that was asked for*/
+		size_t uMagic;    /*!< Tells us the block is ours*/
+	};
+	static const size_t c_uMagic = 0x70796C416C6C6F63; /*!< 'pylAlloc'*/
+
+	// Freed pool blocks are kept in singly linked lists threaded through their payload
+	struct _FreeBlock
+	{
+		_FreeBlock * pNext;
+	};
+
+	// The radix map of our chunks. A chunk's index (its address over the chunk size) is split
+	// in two; the top half picks a bitmap (allocated on demand) and the bottom half a bit in it.
+	// This covers 48 bit addresses; chunks that land higher aren't used
+	static const size_t c_uIndexBits = 48 - c_uChunkBits;
+	static const size_t c_uLeafBits = c_uIndexBits / 2;
+	static const size_t c_uRootBits = c_uIndexBits - c_uLeafBits;
+	using _ChunkBitmap = uint64_t[( size_t( 1 ) << c_uLeafBits ) / 64];
+	static std::atomic<uint64_t *> _s_arChunkMap[size_t( 1 ) << c_uRootBits];
+	static std::mutex _s_muChunks;
+	static std::atomic<size_t> _s_uPoolBytes( 0 ); /*!< Taken for chunks so far*/
+
+	static inline bool _is_pool_block( const void * ptr )
+	{
+		const uintptr_t uIndex = uintptr_t( ptr ) >> c_uChunkBits;
+		if ( uIndex >> c_uIndexBits )
+			return false;
+		const uint64_t * pLeaf = _s_arChunkMap[uIndex >> c_uLeafBits].load( std::memory_order_acquire );
+		if ( pLeaf == nullptr )
+			return false;
+		const uintptr_t uBit = uIndex & ( ( uintptr_t( 1 ) << c_uLeafBits ) - 1 );
+		return ( pLeaf[uBit / 64] >> ( uBit % 64 ) ) & 1;
+	}
+
+	// Get a new chunk for a size class and add it to the map (we never give chunks back)
+	static _ChunkHeader * _new_chunk( uint32_t uClass )
+	{
+		void * pChunk = nullptr;
+#ifdef _WIN32
+		pChunk = _aligned_malloc( c_uChunkSize, c_uChunkSize );
+#else
+		if ( posix_memalign( &pChunk, c_uChunkSize, c_uChunkSize ) != 0 )
+			pChunk = nullptr;
+#endif
+		if ( pChunk == nullptr )
+			return nullptr;
+
+		const uintptr_t uIndex = uintptr_t( pChunk ) >> c_uChunkBits;
+		if ( uIndex >> c_uIndexBits )
+		{
+#ifdef _WIN32
+			_aligned_free( pChunk );
+#else
+			free( pChunk );
+#endif
+			return nullptr;
+		}
+
+		std::lock_guard<std::mutex> lg( _s_muChunks );
+		uint64_t * pLeaf = _s_arChunkMap[uIndex >> c_uLeafBits].load( std::memory_order_relaxed );
+		if ( pLeaf == nullptr )
+		{
+			pLeaf = (uint64_t *) calloc( 1, sizeof( _ChunkBitmap ) );
+			if ( pLeaf == nullptr )
+				return nullptr;
+			_s_arChunkMap[uIndex >> c_uLeafBits].store( pLeaf, std::memory_order_release );
+		}
+		const uintptr_t uBit = uIndex & ( ( uintptr_t( 1 ) << c_uLeafBits ) - 1 );
+		pLeaf[uBit / 64] |= uint64_t( 1 ) << ( uBit % 64 );
+
+		_ChunkHeader * pHeader = (_ChunkHeader *) pChunk;
+		pHeader->uClass = uClass;
+		_s_uPoolBytes += c_uChunkSize;
+		return pHeader;
+	}
+
+	static inline uint32_t _get_class( const void * ptr )
+	{
+		return ( (const _ChunkHeader *) ( uintptr_t( ptr ) & ~( c_uChunkSize - 1 ) ) )->uClass;
+	}
+
+	static inline size_t _class_size( uint32_t uClass )
+	{
+		return ( uClass + 1 ) * c_uClassSize;
+	}
+
+	// Free blocks move between threads in batches of a chunk's worth
+	static inline size_t _batch_size( uint32_t uClass )
+	{
+		return c_uChunkSize / _class_size( uClass );
+	}
+
+	// The allocator we replaced in each domain
+	static PyMemAllocatorEx _s_OldMem, _s_OldObj;
+	static bool _s_bAllocatorInstalled = false;
+
+	static std::atomic<bool> _s_bPoolEnabled( false );
+	static std::atomic<size_t> _s_uMemoryCap( 0 );
+	static std::atomic<size_t> _s_uLiveBytes( 0 );
+	static std::atomic<size_t> _s_uPeakBytes( 0 );
+	static std::atomic<size_t> _s_uAllocs( 0 );
+	static std::atomic<size_t> _s_uFailures( 0 );
+
+	// A free list handed from one thread to another, kept in its first block
+	struct _FreeBatch
+	{
+		_FreeBlock * pRest;        /*!< The blocks after this one*/
+		_FreeBatch * pNextBatch;
+	};
+
+	// The part of a chunk a thread hadn't carved yet when it exited,
+	// threaded through the first block of what's left
+	struct _CarveRange
+	{
+		_CarveRange * pNext;
+		char * pEnd;
+	};
+
+	// Free blocks that threads had more of than they need (or that they left behind
+	// when they exited), and what exited threads hadn't carved yet. Threads take
+	// from these before getting a new chunk
+	static std::mutex _s_muOrphans;
+	static std::atomic<bool> _s_bHaveOrphans( false );
+	static _FreeBatch * _s_arOrphans[c_uNumClasses];
+	static _CarveRange * _s_arOrphanCarves[c_uNumClasses];
+
+	// Whether anything is left to adopt, call with _s_muOrphans locked
+	static bool _have_orphans()
+	{
+		for ( size_t c = 0; c < c_uNumClasses; c++ )
+			if ( _s_arOrphans[c] || _s_arOrphanCarves[c] )
+				return true;
+		return false;
+	}
+
+	// This is kept trivial so that getting at it doesn't cost a guard check every allocation
+	struct _ThreadPools
+	{
+		_FreeBlock * arFree[c_uNumClasses];   /*!< Free blocks of each class*/
+		ptrdiff_t arFreeCount[c_uNumClasses]; /*!< At most how long each free list is (adopted blocks aren't counted)*/
+		char * arCarve[c_uNumClasses];        /*!< Where to carve the next block of each class*/
+		char * arCarveEnd[c_uNumClasses];     /*!< The end of the chunk being carved*/
+		bool bReaped;                         /*!< Whether the reaper below has been made for this thread*/
+	};
+	static thread_local _ThreadPools _t_Pools;
+
+	// Put a free list on the shared ones, call with _s_muOrphans locked
+	static void _push_orphans( uint32_t uClass, _FreeBlock * pFirst )
+	{
+		_FreeBatch * pBatch = (_FreeBatch *) pFirst;
+		pBatch->pRest = pFirst->pNext;
+		pBatch->pNextBatch = _s_arOrphans[uClass];
+		_s_arOrphans[uClass] = pBatch;
+	}
+
+	// Made the first time a thread touches its pools, hands its free blocks
+	// and whatever it hadn't carved yet on to other threads when it exits
+	struct _ThreadPoolsReaper
+	{
+		~_ThreadPoolsReaper()
+		{
+			_ThreadPools& pools = _t_Pools;
+			std::lock_guard<std::mutex> lg( _s_muOrphans );
+			for ( uint32_t c = 0; c < c_uNumClasses; c++ )
+			{
+				if ( pools.arFree[c] )
+					_push_orphans( c, pools.arFree[c] );
+				pools.arFree[c] = nullptr;
+				pools.arFreeCount[c] = 0;
+
+				char * pCarve = pools.arCarve[c];
+				if ( pCarve && pCarve + _class_size( c ) <= pools.arCarveEnd[c] )
+				{
+					_CarveRange * pRange = (_CarveRange *) pCarve;
+					pRange->pEnd = pools.arCarveEnd[c];
+					pRange->pNext = _s_arOrphanCarves[c];
+					_s_arOrphanCarves[c] = pRange;
+				}
+				pools.arCarve[c] = pools.arCarveEnd[c] = nullptr;
+			}
+			_s_bHaveOrphans = _have_orphans();
+		}
+	};
+
+	static void _make_reaper()
+	{
+		static thread_local _ThreadPoolsReaper s_Reaper;
+		(void) s_Reaper;
+		_t_Pools.bReaped = true;
+	}
+
+	// Python only calls these domains while holding the GIL, so the counters
+	// don't need locked increments; they're atomic so they can be read anywhere
+	static inline void _add( std::atomic<size_t>& counter, size_t uAmount )
+	{
+		counter.store( counter.load( std::memory_order_relaxed ) + uAmount, std::memory_order_relaxed );
+	}
+
+	static inline void _sub( std::atomic<size_t>& counter, size_t uAmount )
+	{
+		counter.store( counter.load( std::memory_order_relaxed ) - uAmount, std::memory_order_relaxed );
+	}
+
+	// Account for a new allocation, returning false if it would go past the cap
+	static inline bool _count_alloc( size_t uSize )
+	{
+		size_t uLive = _s_uLiveBytes.load( std::memory_order_relaxed ) + uSize;
+		size_t uCap = _s_uMemoryCap.load( std::memory_order_relaxed );
+		if ( uCap && uLive > uCap )
+		{
+			_add( _s_uFailures, 1 );
+			return false;
+		}
+
+		_s_uLiveBytes.store( uLive, std::memory_order_relaxed );
+		_add( _s_uAllocs, 1 );
+		if ( uLive > _s_uPeakBytes.load( std::memory_order_relaxed ) )
+			_s_uPeakBytes.store( uLive, std::memory_order_relaxed );
+		return true;
+	}
+
+	static void * _pool_refill( uint32_t uClass )
+	{
+		_ThreadPools& pools = _t_Pools;
+
+		// Adopt any orphaned blocks of this size, or else a range to carve
+		if ( _s_bHaveOrphans.load( std::memory_order_relaxed ) )
+		{
+			std::lock_guard<std::mutex> lg( _s_muOrphans );
+			void * pRet = nullptr;
+			if ( _FreeBatch * pBatch = _s_arOrphans[uClass] )
+			{
+				_s_arOrphans[uClass] = pBatch->pNextBatch;
+				pools.arFree[uClass] = pBatch->pRest;
+				pools.arFreeCount[uClass] = 0;
+				pRet = pBatch;
+			}
+			else if ( _CarveRange * pRange = _s_arOrphanCarves[uClass] )
+			{
+				_s_arOrphanCarves[uClass] = pRange->pNext;
+				pools.arCarve[uClass] = (char *) pRange + _class_size( uClass );
+				pools.arCarveEnd[uClass] = pRange->pEnd;
+				pRet = pRange;
+			}
+
+			if ( pRet )
+			{
+				_s_bHaveOrphans = _have_orphans();
+				return pRet;
+			}
+		}
+
+		// Start carving a new chunk
+		_ChunkHeader * pChunk = _new_chunk( uClass );
+		if ( pChunk == nullptr )
+			return nullptr;
+
+		pools.arCarve[uClass] = (char *) ( pChunk + 1 ) + _class_size( uClass );
+		pools.arCarveEnd[uClass] = (char *) pChunk + c_uChunkSize;
+		return pChunk + 1;
+	}
+
+	// Hand a batch of this thread's free blocks to other threads. Without this, blocks one
+	// thread keeps freeing for another (like a producer and a consumer) would never get back
+	static void _pool_spill( uint32_t uClass )
+	{
+		_ThreadPools& pools = _t_Pools;
+		const size_t uBatch = _batch_size( uClass );
+
+		// The list is at least as long as its count, which is over two batches
+		_FreeBlock * pFirst = pools.arFree[uClass];
+		_FreeBlock * pLast = pFirst;
+		for ( size_t i = 1; i < uBatch; i++ )
+			pLast = pLast->pNext;
+		pools.arFree[uClass] = pLast->pNext;
+		pools.arFreeCount[uClass] -= ptrdiff_t( uBatch );
+		pLast->pNext = nullptr;
+
+		std::lock_guard<std::mutex> lg( _s_muOrphans );
+		_push_orphans( uClass, pFirst );
+		_s_bHaveOrphans = true;
+	}
+
+	static inline void * _pool_alloc( uint32_t uClass )
+	{
+		_ThreadPools& pools = _t_Pools;
+		if ( !pools.bReaped )
+			_make_reaper();
+
+		if ( _FreeBlock * pBlock = pools.arFree[uClass] )
+		{
+			pools.arFree[uClass] = pBlock->pNext;
+			pools.arFreeCount[uClass]--;
+			return pBlock;
+		}
+
+		const size_t uBlockSize = _class_size( uClass );
+		char * pCarve = pools.arCarve[uClass];
+		if ( pCarve && pCarve + uBlockSize <= pools.arCarveEnd[uClass] )
+		{
+			pools.arCarve[uClass] = pCarve + uBlockSize;
+			return pCarve;
+		}
+
+		return _pool_refill( uClass );
+	}
+
+	// The PyMemAllocatorEx functions, ctx is the allocator we replaced
+	static void * _pyl_malloc( void * ctx, size_t uSize )
+	{
+		// Python wants a unique pointer even for zero bytes
+		if ( uSize == 0 )
+			uSize = 1;
+
+		if ( uSize <= c_uMaxPooled && _s_bPoolEnabled.load( std::memory_order_relaxed ) )
+		{
+			uint32_t uClass = uint32_t( ( uSize - 1 ) / c_uClassSize );
+			if ( !_count_alloc( _class_size( uClass ) ) )
+				return nullptr;
+
+			void * pRet = _pool_alloc( uClass );
+			if ( pRet == nullptr )
+				_sub( _s_uLiveBytes, _class_size( uClass ) );
+			return pRet;
+		}
+
+		if ( !_count_alloc( uSize ) )
+			return nullptr;
+
+		PyMemAllocatorEx * pOld = (PyMemAllocatorEx *) ctx;
+		_BlockHeader * pHeader = (_BlockHeader *) pOld->malloc( pOld->ctx, sizeof( _BlockHeader ) + uSize );
+		if ( pHeader == nullptr )
+		{
+			_sub( _s_uLiveBytes, uSize );
+			return nullptr;
+		}
+
+		pHeader->uSize = uSize;
+		pHeader->uMagic = c_uMagic;
+		return pHeader + 1;
+	}
+
+	static void * _pyl_calloc( void * ctx, size_t uCount, size_t uElemSize )
+	{
+		if ( uElemSize && uCount > SIZE_MAX / uElemSize )
+			return nullptr;
+
+		void * pRet = _pyl_malloc( ctx, uCount * uElemSize );
+		if ( pRet )
+			memset( pRet, 0, uCount * uElemSize );
+		return pRet;
+	}
+
+	static void _pyl_free( void * ctx, void * ptr )
+	{
+		if ( ptr == nullptr )
+			return;
+
+		if ( _is_pool_block( ptr ) )
+		{
+			uint32_t uClass = _get_class( ptr );
+			_sub( _s_uLiveBytes, _class_size( uClass ) );
+			_ThreadPools& pools = _t_Pools;
+			if ( !pools.bReaped )
+				_make_reaper();
+
+			_FreeBlock * pBlock = (_FreeBlock *) ptr;
+			pBlock->pNext = pools.arFree[uClass];
+			pools.arFree[uClass] = pBlock;
+			if ( ++pools.arFreeCount[uClass] > ptrdiff_t( 2 * _batch_size( uClass ) ) )
+				_pool_spill( uClass );
+			return;
+		}
+
+		// Anything without our header belongs to the allocator we replaced
+		PyMemAllocatorEx * pOld = (PyMemAllocatorEx *) ctx;
+		_BlockHeader * pHeader = (_BlockHeader *) ptr - 1;
+		if ( pHeader->uMagic != c_uMagic )
+		{
+			pOld->free( pOld->ctx, ptr );
+			return;
+		}
+
+		_sub( _s_uLiveBytes, pHeader->uSize );
+		pHeader->uMagic = 0;
+		pOld->free( pOld->ctx, pHeader );
+	}
+
+	static void * _pyl_realloc( void * ctx, void * ptr, size_t uSize )
+	{
+		if ( ptr == nullptr )
+			return _pyl_malloc( ctx, uSize );
+
+		if ( uSize == 0 )
+			uSize = 1;
+
+		// Pool blocks can grow or shrink within their size class
+		size_t uOldSize( 0 );
+		if ( _is_pool_block( ptr ) )
+		{
+			uOldSize = _class_size( _get_class( ptr ) );
+			if ( uSize <= uOldSize && uSize > uOldSize - c_uClassSize )
+				return ptr;
+		}
+		else
+		{
+			PyMemAllocatorEx * pOld = (PyMemAllocatorEx *) ctx;
+			_BlockHeader * pHeader = (_BlockHeader *) ptr - 1;
+			if ( pHeader->uMagic != c_uMagic )
+				return pOld->realloc( pOld->ctx, ptr, uSize );
+
+			// Large blocks that stay large can be reallocated in place
+			uOldSize = pHeader->uSize;
+			if ( uSize > c_uMaxPooled || !_s_bPoolEnabled.load( std::memory_order_relaxed ) )
+			{
+				if ( uSize > uOldSize && !_count_alloc( uSize - uOldSize ) )
+					return nullptr;
+				_BlockHeader * pNew = (_BlockHeader *) pOld->realloc( pOld->ctx, pHeader, sizeof( _BlockHeader ) + uSize );
+				if ( pNew == nullptr )
+				{
+					if ( uSize > uOldSize )
+						_sub( _s_uLiveBytes, uSize - uOldSize );
+					return nullptr;
+				}
+				if ( uSize < uOldSize )
+					_sub( _s_uLiveBytes, uOldSize - uSize );
+				pNew->uSize = uSize;
+				return pNew + 1;
+			}
+		}
+
+		// Otherwise move it
+		void * pRet = _pyl_malloc( ctx, uSize );
+		if ( pRet == nullptr )
+			return nullptr;
+		memcpy( pRet, ptr, std::min( uSize, uOldSize ) );
+		_pyl_free( ctx, ptr );
+		return pRet;
+	}
+
+	bool _install_allocator()
+	{
+		if ( _s_bAllocatorInstalled )
+			return true;
+
+		// We can't take over memory python has already handed out
+		if ( Py_IsInitialized() )
+			return false;
+
+		PyMem_GetAllocator( PYMEM_DOMAIN_MEM, &_s_OldMem );
+		PyMem_GetAllocator( PYMEM_DOMAIN_OBJ, &_s_OldObj );
+
+		PyMemAllocatorEx memAlloc { &_s_OldMem, _pyl_malloc, _pyl_calloc, _pyl_realloc, _pyl_free };
+		PyMemAllocatorEx objAlloc { &_s_OldObj, _pyl_malloc, _pyl_calloc, _pyl_realloc, _pyl_free };
+		PyMem_SetAllocator( PYMEM_DOMAIN_MEM, &memAlloc );
+		PyMem_SetAllocator( PYMEM_DOMAIN_OBJ, &objAlloc );
+
+		_s_bAllocatorInstalled = true;
+		return true;
+	}
+
+	bool _is_allocator_installed()
+	{
+		return _s_bAllocatorInstalled;
+	}
+
+	void _configure_allocator( bool bPool, size_t uMemoryCap )
+	{
+		_s_bPoolEnabled = bPool && _s_bAllocatorInstalled;
+		_s_uMemoryCap = uMemoryCap;
+	}
+
+	MemoryStats get_memory_stats()
+	{
+		return { _s_uLiveBytes.load(), _s_uPeakBytes.load(), _s_uAllocs.load(), _s_uFailures.load(), _s_uPoolBytes.load() };
+	}
+
+	void reset_peak_memory()
+	{
+		_s_uPeakBytes = _s_uLiveBytes.load();
+	}
+}
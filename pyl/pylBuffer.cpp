@@ -0,0 +1,249 @@
+/*      This program is free software; you can redistribute it and/or modify
+*      it under the terms of the GNU General Public License as published by
+*      the Free Software Foundation; either version 3 of the License, or
+*      (at your option) any later version.
+*
+*      This program is distributed in the hope that it will be useful,
+*      but WITHOUT ANY WARRANTY; without even the implied warranty of
+*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*      GNU General Public License for more details.
+*
+*      You should have received a copy of the GNU General Public License
+*      along with this program; if not, write to the Free Software
+*      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+*      MA 02110-1301, USA.
+*
+*      Author:
+*      John Joseph
+*
+*/
+
+
+#include "pylBuffer.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pyl
+{
+	// The python object that exports our buffers; python only ever sees memoryviews of it
+	struct _PyBuffer
+	{
+		PyObject_HEAD
+		_BufferOwner * pOwner;  /*!< Owned, deleted on dealloc*/
+		void * pData;           /*!< The start of the buffer*/
+		Py_ssize_t nLen;        /*!< Its size in bytes*/
+		Py_ssize_t nItemSize;   /*!< The size of each item (also the stride)*/
+		Py_ssize_t nCount;      /*!< The number of items (the shape)*/
+		const char * szFormat;  /*!< Item format, a string literal*/
+		bool bWritable;         /*!< Whether python can write to it*/
+	};
+
+	static void _PyBuffer_dealloc( PyObject * self )
+	{
+		_PyBuffer * pBuf = (_PyBuffer *) self;
+		delete pBuf->pOwner;
+		pBuf->pOwner = nullptr;
+		Py_TYPE( self )->tp_free( self );
+	}
+
+	static int _PyBuffer_getbuffer( PyObject * self, Py_buffer * view, int flags )
+	{
+		_PyBuffer * pBuf = (_PyBuffer *) self;
+		if ( ( flags & PyBUF_WRITABLE ) && !pBuf->bWritable )
+		{
+			PyErr_SetString( PyExc_BufferError, "pyl buffer is read only" );
+			view->obj = nullptr;
+			return -1;
+		}
+
+		// The view holds a reference to us, which keeps the data alive
+		view->obj = self;
+		Py_INCREF( self );
+		view->buf = pBuf->pData;
+		view->len = pBuf->nLen;
+		view->readonly = pBuf->bWritable ? 0 : 1;
+		view->itemsize = pBuf->nItemSize;
+		view->format = ( flags & PyBUF_FORMAT ) ? (char *) pBuf->szFormat : nullptr;
+		view->ndim = 1;
+		view->shape = ( flags & PyBUF_ND ) ? &pBuf->nCount : nullptr;
+		view->strides = ( ( flags & PyBUF_STRIDES ) == PyBUF_STRIDES ) ? &pBuf->nItemSize : nullptr;
+		view->suboffsets = nullptr;
+		view->internal = nullptr;
+		return 0;
+	}
+
+	// Created once, readied whenever a buffer is made
+	static PyTypeObject * _get_buffer_type()
+	{
+		static PyBufferProcs s_BufferProcs = { (getbufferproc) _PyBuffer_getbuffer, nullptr };
+		static PyTypeObject s_TypeObject = []()
+		{
+			PyTypeObject typeObj;
+			memset( &typeObj, 0, sizeof( PyTypeObject ) );
+			typeObj.ob_base = PyVarObject_HEAD_INIT( NULL, 0 )
+			typeObj.tp_name = "pyl.Buffer";
+			typeObj.tp_doc = "Exports memory owned by C++";
+			typeObj.tp_basicsize = sizeof( _PyBuffer );
+			typeObj.tp_flags = Py_TPFLAGS_DEFAULT;
+			typeObj.tp_dealloc = (destructor) _PyBuffer_dealloc;
+			typeObj.tp_as_buffer = &s_BufferProcs;
+			return typeObj;
+		}();
+
+		if ( PyType_Ready( &s_TypeObject ) < 0 )
+			return nullptr;
+		return &s_TypeObject;
+	}
+
+	Object _alloc_buffer( std::unique_ptr<_BufferOwner> upOwner, void * pData, size_t uSize, bool bWritable, const char * szFormat, size_t uItemSize )
+	{
+		PyTypeObject * pTypeObj = _get_buffer_type();
+		if ( pTypeObj == nullptr )
+			throw runtime_error( "Error readying pyl buffer type" );
+
+		_PyBuffer * pBuf = PyObject_New( _PyBuffer, pTypeObj );
+		if ( pBuf == nullptr )
+			throw runtime_error( "Error creating pyl buffer" );
+
+		// Empty containers may not have any memory, but the view needs somewhere to point
+		static char s_chEmpty( 0 );
+		pBuf->pOwner = upOwner.release();
+		pBuf->pData = pData ? pData : &s_chEmpty;
+		pBuf->nLen = (Py_ssize_t) uSize;
+		pBuf->nItemSize = (Py_ssize_t) uItemSize;
+		pBuf->nCount = (Py_ssize_t) ( uSize / uItemSize );
+		pBuf->szFormat = szFormat;
+		pBuf->bWritable = bWritable;
+		Object obBuf = Object::steal( (PyObject *) pBuf );
+		_tally_conversion( 2, 0 );
+
+		// Once the memoryview has its own reference, ours can go
+		PyObject * pView = PyMemoryView_FromObject( obBuf.get() );
+		if ( pView == nullptr )
+		{
+			PyErr_Clear();
+			throw runtime_error( "Error creating memoryview of pyl buffer" );
+		}
+		return Object::steal( pView );
+	}
+
+	Object alloc_buffer( std::vector<char>&& vData, bool bWritable )
+	{
+		void * pData = vData.data();
+		size_t uSize = vData.size();
+		return _alloc_buffer( std::unique_ptr<_BufferOwner>( new _TypedBufferOwner<std::vector<char>>( std::move( vData ) ) ),
+							  pData, uSize, bWritable, "B", 1 );
+	}
+
+	Object alloc_buffer( std::string&& strData, bool bWritable )
+	{
+		// Short strings keep their characters inside the string object, so
+		// the data has to be found after the string has moved into its owner
+		_TypedBufferOwner<std::string> * pOwner = new _TypedBufferOwner<std::string>( std::move( strData ) );
+		std::unique_ptr<_BufferOwner> upOwner( pOwner );
+		return _alloc_buffer( std::move( upOwner ), &pOwner->tData[0], pOwner->tData.size(), bWritable, "B", 1 );
+	}
+
+	Object alloc_buffer( std::unique_ptr<uint8_t[]> upData, size_t uSize, bool bWritable )
+	{
+		void * pData = upData.get();
+		return _alloc_buffer( std::unique_ptr<_BufferOwner>( new _TypedBufferOwner<std::unique_ptr<uint8_t[]>>( std::move( upData ) ) ),
+							  pData, uSize, bWritable, "B", 1 );
+	}
+
+	// Unmaps a file once python is done with it
+	struct _MappedFile : public _BufferOwner
+	{
+		void * pData { nullptr };  /*!< The start of the mapping, if there is one*/
+		size_t uSize { 0 };        /*!< Its size in bytes*/
+#ifdef _WIN32
+		HANDLE hFile { INVALID_HANDLE_VALUE };
+		HANDLE hMapping { nullptr };
+
+		~_MappedFile()
+		{
+			if ( pData )
+				UnmapViewOfFile( pData );
+			if ( hMapping )
+				CloseHandle( hMapping );
+			if ( hFile != INVALID_HANDLE_VALUE )
+				CloseHandle( hFile );
+		}
+#else
+		~_MappedFile()
+		{
+			if ( pData )
+				munmap( pData, uSize );
+		}
+#endif
+	};
+
+	Object map_file( const std::string& strPath, MapMode eMode )
+	{
+		std::unique_ptr<_MappedFile> upMap( new _MappedFile );
+		const bool bWritable = eMode != MapMode::Read;
+
+		// Empty files can't be mapped, but there's nothing to map anyway
+#ifdef _WIN32
+		DWORD dwAccess = eMode == MapMode::ReadWrite ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+		upMap->hFile = CreateFileA( strPath.c_str(), dwAccess, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+		if ( upMap->hFile == INVALID_HANDLE_VALUE )
+			throw runtime_error( "Error opening file " + strPath + " to map" );
+
+		LARGE_INTEGER liSize;
+		if ( !GetFileSizeEx( upMap->hFile, &liSize ) )
+			throw runtime_error( "Error getting size of file " + strPath );
+		upMap->uSize = (size_t) liSize.QuadPart;
+
+		if ( upMap->uSize > 0 )
+		{
+			DWORD dwProtect = eMode == MapMode::Read ? PAGE_READONLY : eMode == MapMode::ReadWrite ? PAGE_READWRITE : PAGE_WRITECOPY;
+			DWORD dwMapAccess = eMode == MapMode::Read ? FILE_MAP_READ : eMode == MapMode::ReadWrite ? FILE_MAP_WRITE : FILE_MAP_COPY;
+			upMap->hMapping = CreateFileMappingA( upMap->hFile, nullptr, dwProtect, 0, 0, nullptr );
+			if ( upMap->hMapping == nullptr )
+				throw runtime_error( "Error mapping file " + strPath );
+			upMap->pData = MapViewOfFile( upMap->hMapping, dwMapAccess, 0, 0, 0 );
+			if ( upMap->pData == nullptr )
+				throw runtime_error( "Error mapping file " + strPath );
+		}
+#else
+		int fd = open( strPath.c_str(), eMode == MapMode::ReadWrite ? O_RDWR : O_RDONLY );
+		if ( fd < 0 )
+			throw runtime_error( "Error opening file " + strPath + " to map" );
+
+		// The mapping keeps the file open, so we don't need the descriptor once it's made
+		struct stat st;
+		if ( fstat( fd, &st ) != 0 )
+		{
+			close( fd );
+			throw runtime_error( "Error getting size of file " + strPath );
+		}
+		upMap->uSize = (size_t) st.st_size;
+
+		if ( upMap->uSize > 0 )
+		{
+			int nProt = bWritable ? PROT_READ | PROT_WRITE : PROT_READ;
+			int nFlags = eMode == MapMode::CopyOnWrite ? MAP_PRIVATE : MAP_SHARED;
+			void * pData = mmap( nullptr, upMap->uSize, nProt, nFlags, fd, 0 );
+			if ( pData == MAP_FAILED )
+			{
+				close( fd );
+				throw runtime_error( "Error mapping file " + strPath );
+			}
+			upMap->pData = pData;
+		}
+		close( fd );
+#endif
+
+		void * pData = upMap->pData;
+		size_t uSize = upMap->uSize;
+		return _alloc_buffer( std::move( upMap ), pData, uSize, bWritable, "B", 1 );
+	}
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "pyliaison.h"
+
+#include <cstring>
+
+namespace pyl
+{
+	// Owns the memory behind a buffer we've handed to python,
+	// and is deleted once python has no more references to it
+	struct _BufferOwner
+	{
+		virtual ~_BufferOwner() {}
+	};
+
+	template <typename T>
+	struct _TypedBufferOwner : public _BufferOwner
+	{
+		T tData;
+		_TypedBufferOwner( T&& t ) : tData( std::move( t ) ) {}
+	};
+
+	// The struct module format python uses for items of type T
+	template <typename T>
+	constexpr const char * _buffer_format()
+	{
+		static_assert( std::is_arithmetic<T>::value, "Only arithmetic types can be the items of a buffer" );
+		if constexpr ( std::is_same<T, bool>::value )
+			return "?";
+		else if constexpr ( std::is_same<T, float>::value )
+			return "f";
+		else if constexpr ( std::is_same<T, double>::value )
+			return "d";
+		else if constexpr ( sizeof( T ) == 1 )
+			return std::is_signed<T>::value ? "b" : "B";
+		else if constexpr ( sizeof( T ) == 2 )
+			return std::is_signed<T>::value ? "h" : "H";
+		else if constexpr ( sizeof( T ) == 4 )
+			return std::is_signed<T>::value ? "i" : "I";
+		else
+			return std::is_signed<T>::value ? "q" : "Q";
+	}
+
+	// Used internally to wrap memory kept alive by upOwner in a memoryview
+	Object _alloc_buffer( std::unique_ptr<_BufferOwner> upOwner, void * pData, size_t uSize, bool bWritable, const char * szFormat, size_t uItemSize );
+
+	/*! alloc_buffer
+	\brief Hand a block of bytes to python without copying it
+
+	\param[in] vData The bytes, which python takes ownership of
+	\param[in] bWritable Whether python can write to them
+	\param[out] obView A memoryview of the bytes
+
+	The bytes are freed once the memoryview (and anything else python made from it)
+	is gone. Like everything else that makes python objects, call this with the GIL*/
+	Object alloc_buffer( std::vector<char>&& vData, bool bWritable = false );
+
+	/*! alloc_buffer \brief Hand a string's bytes to python without copying them (see above)*/
+	Object alloc_buffer( std::string&& strData, bool bWritable = false );
+
+	/*! alloc_buffer \brief Hand uSize bytes to python without copying them (see above)*/
+	Object alloc_buffer( std::unique_ptr<uint8_t[]> upData, size_t uSize, bool bWritable = false );
+
+	/*! MapMode \brief How map_file maps a file*/
+	enum class MapMode
+	{
+		Read,        /*!< Read only*/
+		ReadWrite,   /*!< Writes go to the file*/
+		CopyOnWrite  /*!< Writes are private to the mapping, the file is untouched*/
+	};
+
+	/*! map_file
+	\brief Map a file into memory and hand it to python
+
+	\param[in] strPath The file to map
+	\param[in] eMode Whether the mapping can be written to, and where writes go
+	\param[out] obView A memoryview of the file's bytes
+
+	Pages are read in as they're touched, so nothing is copied up front. The file
+	stays mapped until the memoryview (and anything made from it) is gone. Use a
+	pyl::Span to look at the same bytes from C++. Throws a pyl::runtime_error if the
+	file can't be opened or mapped*/
+	Object map_file( const std::string& strPath, MapMode eMode = MapMode::Read );
+
+	/*! alloc_buffer
+	\brief Hand a vector of numbers to python without copying it
+
+	The memoryview has one item per element, formatted the way the struct
+	module (and numpy) expect, so it can be indexed or cast directly*/
+	template <typename T>
+	Object alloc_buffer( std::vector<T>&& vData, bool bWritable = false )
+	{
+		// Get the data before the vector moves into its owner, the pointer stays good
+		void * pData = vData.data();
+		size_t uSize = vData.size() * sizeof( T );
+		return _alloc_buffer( std::unique_ptr<_BufferOwner>( new _TypedBufferOwner<std::vector<T>>( std::move( vData ) ) ),
+							  pData, uSize, bWritable, _buffer_format<T>(), sizeof( T ) );
+	}
+
+	/********************************************//*!
+	pyl::Span
+	\brief A view of contiguous items owned by someone else
+
+	Python objects with a buffer (bytes, memoryviews, array.array, numpy arrays and
+	whatever map_file and alloc_buffer return) can be converted to a span without
+	copying. The span points into the object's memory, so it's only valid for as long
+	as the object is alive (and, for things like bytearrays, isn't resized.) A span of
+	non const T can only be made from a writable buffer.
+	***********************************************/
+	template <typename T>
+	class Span
+	{
+		T * m_pData;     /*!< The first item*/
+		size_t m_uSize;  /*!< The number of items*/
+	public:
+		Span() : m_pData( nullptr ), m_uSize( 0 ) {}
+		Span( T * pData, size_t uSize ) : m_pData( pData ), m_uSize( uSize ) {}
+
+		T * data() const { return m_pData; }
+		size_t size() const { return m_uSize; }
+		bool empty() const { return m_uSize == 0; }
+		T& operator[]( size_t i ) const { return m_pData[i]; }
+		T * begin() const { return m_pData; }
+		T * end() const { return m_pData + m_uSize; }
+	};
+
+	// Whether buffer items with this format and size can be viewed as T
+	template <typename T>
+	bool _buffer_format_matches( const char * szFormat, Py_ssize_t nItemSize )
+	{
+		if ( nItemSize != sizeof( T ) )
+			return false;
+
+		// No format means bytes, and native byte order and alignment is all we do
+		if ( szFormat == nullptr )
+			szFormat = "B";
+		if ( szFormat[0] == '@' )
+			szFormat++;
+		if ( szFormat[0] == '\0' || szFormat[1] != '\0' )
+			return false;
+
+		// Bytes can be viewed as any one byte type, otherwise the kind has to match
+		const char cFormat = szFormat[0];
+		if constexpr ( std::is_same<T, bool>::value )
+			return cFormat == '?';
+		else if constexpr ( std::is_floating_point<T>::value )
+			return cFormat == _buffer_format<T>()[0];
+		else if constexpr ( sizeof( T ) == 1 )
+			return cFormat == 'b' || cFormat == 'B' || cFormat == 'c';
+		else if constexpr ( std::is_signed<T>::value )
+			return strchr( "hilqn", cFormat ) != nullptr;
+		else
+			return strchr( "HILQN", cFormat ) != nullptr;
+	}
+
+	/*! convert \brief View the buffer of a PyObject as a pyl::Span
+	Works if the object has a C contiguous buffer whose items are T (see pyl::Span)*/
+	template <typename T>
+	bool convert( PyObject * obj, Span<T>& span )
+	{
+		if ( !PyObject_CheckBuffer( obj ) )
+			return false;
+
+		int nFlags = PyBUF_FORMAT | PyBUF_C_CONTIGUOUS;
+		if ( !std::is_const<T>::value )
+			nFlags |= PyBUF_WRITABLE;
+
+		Py_buffer view;
+		if ( PyObject_GetBuffer( obj, &view, nFlags ) < 0 )
+		{
+			PyErr_Clear();
+			return false;
+		}
+
+		// The memory belongs to the object, not the view, so it's fine to let the view go
+		bool bMatches = _buffer_format_matches<typename std::remove_const<T>::type>( view.format, view.itemsize );
+		if ( bMatches )
+			span = Span<T>( (T *) view.buf, size_t( view.len / view.itemsize ) );
+		PyBuffer_Release( &view );
+		return bMatches;
+	}
+}
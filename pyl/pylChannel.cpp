@@ -0,0 +1,241 @@
+/*      This program is free software; you can redistribute it and/or modify
+*      it under the terms of the GNU General Public License as published by
+*      the Free Software Foundation; either version 3 of the License, or
+*      (at your option) any later version.
+*
+*      This program is distributed in the hope that it will be useful,
+*      but WITHOUT ANY WARRANTY; without even the implied warranty of
+*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*      GNU General Public License for more details.
+*
+*      You should have received a copy of the GNU General Public License
+*      along with this program; if not, write to the Free Software
+*      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+*      MA 02110-1301, USA.
+*
+*      Author:
+*      John Joseph
+*
+*/
+
+
+#include "pylChannel.h"
+#include "pylGIL.h"
+
+namespace pyl
+{
+	void _ChannelBase::notify()
+	{
+		// The push that called us was sequentially consistent, as is the consumer's
+		// count of waiters, so either it saw our item or we see it waiting
+		if ( m_nWaiting.load() > 0 )
+		{
+			std::lock_guard<std::mutex> lg( m_muWait );
+			m_cvWait.notify_all();
+		}
+	}
+
+	void _ChannelBase::Wait( double dTimeout )
+	{
+		std::unique_lock<std::mutex> lk( m_muWait );
+		m_nWaiting++;
+
+		auto fnReady = [this]() { return Empty() == false || IsClosed(); };
+		if ( dTimeout < 0 )
+			m_cvWait.wait( lk, fnReady );
+		else
+			m_cvWait.wait_for( lk, std::chrono::duration<double>( dTimeout ), fnReady );
+		m_nWaiting--;
+	}
+
+	void _ChannelBase::notifyRoom()
+	{
+		// Pairs with the sequentially consistent count and check in WaitForRoom,
+		// so either the producer sees the cells we freed or we see it waiting
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		if ( m_nWaitingForRoom.load() > 0 )
+		{
+			std::lock_guard<std::mutex> lg( m_muWait );
+			m_cvRoom.notify_all();
+		}
+	}
+
+	void _ChannelBase::WaitForRoom()
+	{
+		std::unique_lock<std::mutex> lk( m_muWait );
+		m_nWaitingForRoom++;
+		m_cvRoom.wait( lk, [this]() { return Full() == false || IsClosed(); } );
+		m_nWaitingForRoom--;
+	}
+
+	void _ChannelBase::Close()
+	{
+		m_bClosed.store( true );
+		std::lock_guard<std::mutex> lg( m_muWait );
+		m_cvWait.notify_all();
+		m_cvRoom.notify_all();
+	}
+
+	// The python object consumers pop from
+	struct _PyChannel
+	{
+		PyObject_HEAD
+		std::shared_ptr<_ChannelBase> * pspChannel; /*!< Owned, deleted on dealloc*/
+	};
+
+	static void _PyChannel_dealloc( PyObject * self )
+	{
+		_PyChannel * pChan = (_PyChannel *) self;
+		delete pChan->pspChannel;
+		pChan->pspChannel = nullptr;
+		Py_TYPE( self )->tp_free( self );
+	}
+
+	// Claim up to uMax items and copy them into a buffer of just their size. Claimed
+	// items have to be copied out to free their cells, so if we can't get the buffer
+	// they're dropped (and the buffer comes back null with a nonzero count)
+	static std::unique_ptr<char[]> _channel_take( _ChannelBase& channel, size_t uMax, size_t& uCount )
+	{
+		size_t uPos( 0 );
+		uCount = channel.Claim( uMax, uPos );
+		if ( uCount == 0 )
+			return nullptr;
+
+		std::unique_ptr<char[]> upItems( new ( std::nothrow ) char[uCount * channel.uItemSize] );
+		channel.CopyOut( uPos, uCount, upItems.get() );
+		return upItems;
+	}
+
+	// Pop up to uMax items, waiting dTimeout seconds (forever if negative)
+	// for some to show up. Returns None once the channel is closed and empty
+	static PyObject * _channel_pop( _ChannelBase& channel, size_t uMax, double dTimeout )
+	{
+		size_t uCount( 0 );
+		std::unique_ptr<char[]> upItems = _channel_take( channel, uMax, uCount );
+		if ( uCount == 0 && uMax > 0 && dTimeout != 0 )
+		{
+			// Items may still be on their way in, or another consumer may beat us to them,
+			// so keep waiting until we get something, time out, or there's nothing left
+			GILRelease gil( "pyl::Channel" );
+			auto tpDeadline = std::chrono::steady_clock::now() + std::chrono::duration<double>( std::max( dTimeout, 0. ) );
+			do
+			{
+				double dRemaining = std::chrono::duration<double>( tpDeadline - std::chrono::steady_clock::now() ).count();
+				channel.Wait( dTimeout < 0 ? -1 : std::max( dRemaining, 0. ) );
+				upItems = _channel_take( channel, uMax, uCount );
+			} while ( uCount == 0 && !( channel.IsClosed() && channel.Empty() ) &&
+					  ( dTimeout < 0 || std::chrono::steady_clock::now() < tpDeadline ) );
+		}
+
+		if ( uCount == 0 && channel.IsClosed() && channel.Empty() )
+		{
+			Py_INCREF( Py_None );
+			return Py_None;
+		}
+
+		if ( uCount > 0 && upItems == nullptr )
+			return PyErr_NoMemory();
+
+		void * pData = upItems.get();
+		size_t uSize = uCount * channel.uItemSize;
+		try
+		{
+			return alloc_pyobject( _alloc_buffer( std::unique_ptr<_BufferOwner>( new _TypedBufferOwner<std::unique_ptr<char[]>>( std::move( upItems ) ) ),
+												  pData, uSize, false, channel.szFormat, channel.uFormatSize ) );
+		}
+		catch ( std::exception& e )
+		{
+			PyErr_SetString( PyExc_RuntimeError, e.what() );
+			return nullptr;
+		}
+	}
+
+	static PyObject * _PyChannel_pop( PyObject * self, PyObject * args, PyObject * kwargs )
+	{
+		_ChannelBase& channel = **( (_PyChannel *) self )->pspChannel;
+		static const char * s_arKeywords[] = { "max_items", "timeout", nullptr };
+		Py_ssize_t nMax = (Py_ssize_t) channel.Capacity();
+		PyObject * pTimeout = Py_None;
+		if ( !PyArg_ParseTupleAndKeywords( args, kwargs, "|nO", (char **) s_arKeywords, &nMax, &pTimeout ) )
+			return nullptr;
+		if ( nMax < 0 )
+		{
+			PyErr_SetString( PyExc_ValueError, "max_items can't be negative" );
+			return nullptr;
+		}
+
+		double dTimeout( -1 );
+		if ( pTimeout != Py_None )
+		{
+			dTimeout = PyFloat_AsDouble( pTimeout );
+			if ( dTimeout == -1 && PyErr_Occurred() )
+				return nullptr;
+			dTimeout = std::max( dTimeout, 0. );
+		}
+
+		return _channel_pop( channel, (size_t) nMax, dTimeout );
+	}
+
+	static PyObject * _PyChannel_close( PyObject * self, PyObject * )
+	{
+		( *( (_PyChannel *) self )->pspChannel )->Close();
+		Py_INCREF( Py_None );
+		return Py_None;
+	}
+
+	// Iterating pops as much as we can each time, until we're closed and drained
+	static PyObject * _PyChannel_iternext( PyObject * self )
+	{
+		_ChannelBase& channel = **( (_PyChannel *) self )->pspChannel;
+		PyObject * pBatch = _channel_pop( channel, channel.Capacity(), -1 );
+		if ( pBatch == Py_None )
+		{
+			Py_DECREF( pBatch );
+			return nullptr;
+		}
+		return pBatch;
+	}
+
+	// Created once, readied whenever a channel object is made
+	static PyTypeObject * _get_channel_type()
+	{
+		static PyMethodDef s_arMethods[] = {
+			{ "pop", (PyCFunction) (void (*)( void )) _PyChannel_pop, METH_VARARGS | METH_KEYWORDS,
+			  "pop(max_items, timeout=None) -> memoryview of up to max_items, or None once closed and drained" },
+			{ "close", (PyCFunction) _PyChannel_close, METH_NOARGS, "Stop taking items" },
+			{ nullptr, nullptr, 0, nullptr }
+		};
+		static PyTypeObject s_TypeObject = []()
+		{
+			PyTypeObject typeObj;
+			memset( &typeObj, 0, sizeof( PyTypeObject ) );
+			typeObj.ob_base = PyVarObject_HEAD_INIT( NULL, 0 )
+			typeObj.tp_name = "pyl.Channel";
+			typeObj.tp_doc = "Pops batches of items pushed from C++";
+			typeObj.tp_basicsize = sizeof( _PyChannel );
+			typeObj.tp_flags = Py_TPFLAGS_DEFAULT;
+			typeObj.tp_dealloc = (destructor) _PyChannel_dealloc;
+			typeObj.tp_iter = PyObject_SelfIter;
+			typeObj.tp_iternext = (iternextfunc) _PyChannel_iternext;
+			typeObj.tp_methods = s_arMethods;
+			return typeObj;
+		}();
+
+		if ( PyType_Ready( &s_TypeObject ) < 0 )
+			return nullptr;
+		return &s_TypeObject;
+	}
+
+	Object _make_channel_object( std::shared_ptr<_ChannelBase> spChannel )
+	{
+		PyTypeObject * pTypeObj = _get_channel_type();
+		if ( pTypeObj == nullptr )
+			throw runtime_error( "Error readying pyl channel type" );
+
+		_PyChannel * pChan = PyObject_New( _PyChannel, pTypeObj );
+		if ( pChan == nullptr )
+			throw runtime_error( "Error creating pyl channel" );
+		pChan->pspChannel = new std::shared_ptr<_ChannelBase>( std::move( spChannel ) );
+		return Object::steal( (PyObject *) pChan );
+	}
+}
@@ -0,0 +1,258 @@
+#pragma once
+
+#include "pylBuffer.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace pyl
+{
+	// The part of a channel python sees, which doesn't care about the item type
+	class _ChannelBase
+	{
+		std::mutex m_muWait;                 /*!< Only taken to sleep and to wake sleepers*/
+		std::condition_variable m_cvWait;    /*!< Consumers sleep on this*/
+		std::condition_variable m_cvRoom;    /*!< Producers sleep on this while we're full*/
+		std::atomic<int> m_nWaiting { 0 };   /*!< Consumers sleeping (or about to)*/
+		std::atomic<int> m_nWaitingForRoom { 0 }; /*!< Producers sleeping (or about to)*/
+		std::atomic<bool> m_bClosed { false };
+
+	protected:
+		// Wake any sleeping consumers, if there are any
+		void notify();
+
+		// Wake any producers waiting for room, if there are any
+		void notifyRoom();
+
+	public:
+		const size_t uItemSize;        /*!< The size of each item*/
+		const char * const szFormat;   /*!< The buffer format of each item*/
+		const size_t uFormatSize;      /*!< The size of each formatted item (sizeof T, or 1 for bytes)*/
+
+		_ChannelBase( size_t itemSize, const char * format, size_t formatSize ) :
+			uItemSize( itemSize ), szFormat( format ), uFormatSize( formatSize ) {}
+		virtual ~_ChannelBase() {}
+
+		// Claim up to uMax items that are ready, returning how many we got and where they start.
+		// Nothing can be pushed into their cells until they're handed to CopyOut
+		virtual size_t Claim( size_t uMax, size_t& uPos ) = 0;
+
+		// Copy claimed items into pDst (or drop them, if it's null) and free their cells
+		virtual void CopyOut( size_t uPos, size_t uCount, char * pDst ) = 0;
+
+		// Whether nothing has been pushed (even partway) that hasn't been popped
+		virtual bool Empty() const = 0;
+
+		// Whether the next push would find no room
+		virtual bool Full() const = 0;
+
+		// The most items the channel can hold
+		virtual size_t Capacity() const = 0;
+
+		// Wait (up to dTimeout seconds, or forever if it's negative) for items or for the channel to close
+		void Wait( double dTimeout );
+
+		// Wait for room to push, or for the channel to close
+		void WaitForRoom();
+
+		void Close();
+		bool IsClosed() const { return m_bClosed.load(); }
+	};
+
+	// Used internally to make the python object consumers pop from
+	Object _make_channel_object( std::shared_ptr<_ChannelBase> spChannel );
+
+	/********************************************//*!
+	pyl::Channel
+	\brief Hands items from C++ threads to python in batches
+	\tparam T The item type, which is copied as raw memory
+
+	Items go into a fixed size lock free ring (safe for any number of producers
+	and consumers), so C++ threads can push without the GIL and without taking a
+	lock. When the ring is full, Push sleeps until a consumer makes room (or the
+	channel closes) and TryPush gives up. Python gets at the channel through the
+	object from GetPyObject, which has a pop( max_items, timeout = None ) method
+	returning up to max_items as a memoryview; numbers keep their type, anything
+	else comes out as bytes (see the struct module.) pop waits for items with the
+	GIL released, returns an empty view if it times out and None once the channel
+	is closed and drained. Iterating the object pops until then.
+
+	Channels are handles; copies share the same ring, which lives until the last
+	copy and the last python object are gone.
+	***********************************************/
+	template <typename T>
+	class Channel
+	{
+		static_assert( std::is_trivially_copyable<T>::value, "Channel items are copied as raw memory" );
+
+		// A bounded ring where each cell's sequence number says whose turn it is
+		class _Ring : public _ChannelBase
+		{
+			struct Cell
+			{
+				std::atomic<size_t> uSeq;
+				T tVal;
+			};
+
+			std::unique_ptr<Cell[]> m_upCells;
+			size_t m_uMask;
+			alignas( 64 ) std::atomic<size_t> m_uPushPos;
+			alignas( 64 ) std::atomic<size_t> m_uPopPos;
+
+			static const char * format()
+			{
+				if constexpr ( std::is_arithmetic<T>::value )
+					return _buffer_format<T>();
+				else
+					return "B";
+			}
+
+		public:
+			_Ring( size_t uCapacity ) :
+				_ChannelBase( sizeof( T ), format(), std::is_arithmetic<T>::value ? sizeof( T ) : 1 ),
+				m_uPushPos( 0 ),
+				m_uPopPos( 0 )
+			{
+				// Round the capacity up to a power of two so positions wrap with a mask
+				size_t uSize( 2 );
+				while ( uSize < uCapacity )
+					uSize <<= 1;
+				m_upCells.reset( new Cell[uSize] );
+				m_uMask = uSize - 1;
+				for ( size_t i = 0; i < uSize; i++ )
+					m_upCells[i].uSeq.store( i, std::memory_order_relaxed );
+			}
+
+			bool TryPush( const T& tVal )
+			{
+				Cell * pCell( nullptr );
+				size_t uPos = m_uPushPos.load( std::memory_order_relaxed );
+				for ( ;; )
+				{
+					pCell = &m_upCells[uPos & m_uMask];
+					size_t uSeq = pCell->uSeq.load( std::memory_order_acquire );
+					intptr_t nDiff = (intptr_t) uSeq - (intptr_t) uPos;
+					if ( nDiff == 0 )
+					{
+						// This is sequentially consistent so that either a consumer about to
+						// sleep sees we're not empty, or notify sees that it's waiting
+						if ( m_uPushPos.compare_exchange_weak( uPos, uPos + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+							break;
+					}
+					// The consumer hasn't gotten this far yet, we're full
+					else if ( nDiff < 0 )
+						return false;
+					else
+						uPos = m_uPushPos.load( std::memory_order_relaxed );
+				}
+
+				pCell->tVal = tVal;
+				pCell->uSeq.store( uPos + 1, std::memory_order_release );
+				notify();
+				return true;
+			}
+
+			// Claim every item that's ready (up to uMax) at once
+			size_t Claim( size_t uMax, size_t& uPosOut ) override
+			{
+				size_t uPos = m_uPopPos.load( std::memory_order_relaxed );
+				for ( ;; )
+				{
+					// Producers can't touch a published cell until it's popped, so these stay ready
+					size_t uCount( 0 );
+					while ( uCount < uMax && m_upCells[( uPos + uCount ) & m_uMask].uSeq.load( std::memory_order_acquire ) == uPos + uCount + 1 )
+						uCount++;
+
+					if ( uCount == 0 )
+					{
+						// Either we're empty, or another consumer got here first
+						size_t uNow = m_uPopPos.load( std::memory_order_relaxed );
+						if ( uNow == uPos )
+							return 0;
+						uPos = uNow;
+					}
+					else if ( m_uPopPos.compare_exchange_weak( uPos, uPos + uCount, std::memory_order_relaxed ) )
+					{
+						uPosOut = uPos;
+						return uCount;
+					}
+				}
+			}
+
+			void CopyOut( size_t uPos, size_t uCount, char * pDst ) override
+			{
+				for ( size_t i = 0; i < uCount; i++ )
+				{
+					Cell& cell = m_upCells[( uPos + i ) & m_uMask];
+					if ( pDst )
+						memcpy( pDst + i * sizeof( T ), &cell.tVal, sizeof( T ) );
+					cell.uSeq.store( uPos + i + m_uMask + 1, std::memory_order_release );
+				}
+				notifyRoom();
+			}
+
+			bool Empty() const override
+			{
+				return m_uPushPos.load() == m_uPopPos.load();
+			}
+
+			// This is sequentially consistent so that either a producer about to
+			// sleep sees the room, or notifyRoom sees that it's waiting
+			bool Full() const override
+			{
+				size_t uPos = m_uPushPos.load();
+				return (intptr_t) m_upCells[uPos & m_uMask].uSeq.load() - (intptr_t) uPos < 0;
+			}
+
+			size_t Capacity() const override
+			{
+				return m_uMask + 1;
+			}
+		};
+
+		std::shared_ptr<_Ring> m_spRing;
+
+	public:
+		/*! Channel \brief Make a channel holding at least uCapacity items (rounded up to a power of two)*/
+		Channel( size_t uCapacity ) :
+			m_spRing( std::make_shared<_Ring>( uCapacity ) )
+		{}
+
+		/*! TryPush \brief Push an item if there's room, without blocking. Doesn't need the GIL*/
+		bool TryPush( const T& tVal )
+		{
+			return m_spRing->IsClosed() == false && m_spRing->TryPush( tVal );
+		}
+
+		/*! Push \brief Push an item, sleeping until there's room. Returns false if the channel is closed*/
+		bool Push( const T& tVal )
+		{
+			while ( m_spRing->IsClosed() == false )
+			{
+				if ( m_spRing->TryPush( tVal ) )
+					return true;
+				m_spRing->WaitForRoom();
+			}
+			return false;
+		}
+
+		/*! Close \brief Stop taking items; consumers get what's left, then None*/
+		void Close()
+		{
+			m_spRing->Close();
+		}
+
+		/*! Capacity \brief The most items the channel can hold*/
+		size_t Capacity() const
+		{
+			return m_spRing->Capacity();
+		}
+
+		/*! GetPyObject \brief Make a python object that pops from this channel (needs the GIL)*/
+		Object GetPyObject() const
+		{
+			return _make_channel_object( m_spRing );
+		}
+	};
+}
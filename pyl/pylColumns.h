@@ -0,0 +1,138 @@
+#pragma once
+
+#include "pylBuffer.h"
+#include "pylRecord.h"
+
+namespace pyl
+{
+	/********************************************//*!
+	pyl::Columns
+	\brief Converts a vector of records to and from a dict of columns
+	\tparam R A struct described with PYL_RECORD (or PYL_STRUCT)
+
+	Python sees a dict with one entry per field. Numeric fields become writable,
+	typed memoryviews with one item per record (which numpy and friends can use as
+	is); any other field becomes a list. Going the other way, numeric columns can be
+	anything with a buffer of the right type (or any sequence, which is slower) and
+	every column needs the same length.
+	***********************************************/
+	template <typename R>
+	struct Columns
+	{
+		static_assert( record<R>::value, "Describe the record with PYL_RECORD first" );
+
+		std::vector<R> vRecords;  /*!< The records, one per row*/
+
+		Columns() {}
+		Columns( std::vector<R> v ) : vRecords( std::move( v ) ) {}
+	};
+
+	// Gather field I of every record into one column
+	template <size_t I, typename R>
+	PyObject * _alloc_column( const std::vector<R>& vRecords )
+	{
+		using T = _record_field_t<I, R>;
+		if constexpr ( std::is_arithmetic<T>::value )
+		{
+			// Not a vector, since std::vector<bool> doesn't keep its bools contiguous
+			std::unique_ptr<T[]> upCol( new T[vRecords.size()] );
+			for ( size_t i = 0; i < vRecords.size(); i++ )
+				upCol[i] = std::get<I>( record<R>::tie( vRecords[i] ) );
+
+			void * pData = upCol.get();
+			size_t uSize = vRecords.size() * sizeof( T );
+			return alloc_pyobject( _alloc_buffer( std::unique_ptr<_BufferOwner>( new _TypedBufferOwner<std::unique_ptr<T[]>>( std::move( upCol ) ) ),
+												  pData, uSize, true, _buffer_format<T>(), sizeof( T ) ) );
+		}
+		else
+		{
+			std::vector<T> vCol;
+			vCol.reserve( vRecords.size() );
+			for ( const R& r : vRecords )
+				vCol.push_back( std::get<I>( record<R>::tie( r ) ) );
+			return alloc_pyobject( vCol );
+		}
+	}
+
+	template <size_t I, typename R>
+	bool _add_column( PyObject * pDict, const std::vector<R>& vRecords )
+	{
+		unique_ptr upCol( _alloc_column<I>( vRecords ) );
+		return upCol && PyDict_SetItemString( pDict, record_field_names<R>()[I].c_str(), upCol.get() ) == 0;
+	}
+
+	template <typename R, size_t... Is>
+	PyObject * _alloc_columns( const std::vector<R>& vRecords, std::index_sequence<Is...> )
+	{
+		unique_ptr upDict( PyDict_New() );
+		if ( !upDict || !( _add_column<Is>( upDict.get(), vRecords ) && ... ) )
+			return nullptr;
+		return upDict.release();
+	}
+
+	/*! alloc_pyobject \brief Creates a dict of columns from pyl::Columns (see above)*/
+	template <typename R>
+	PyObject * alloc_pyobject( const Columns<R>& columns )
+	{
+		return _alloc_columns( columns.vRecords, std::make_index_sequence<_record_size<R>()>() );
+	}
+
+	// Scatter column I into field I of every record. The first column sizes the records
+	template <size_t I, typename R>
+	bool _convert_column( PyObject * pDict, std::vector<R>& vRecords )
+	{
+		using T = _record_field_t<I, R>;
+		PyObject * pCol = PyDict_GetItemString( pDict, record_field_names<R>()[I].c_str() );
+		if ( pCol == nullptr )
+			return false;
+
+		// Buffers of the right type can be read in place
+		if constexpr ( std::is_arithmetic<T>::value )
+		{
+			Span<const T> spCol;
+			if ( convert( pCol, spCol ) )
+			{
+				if ( I == 0 )
+					vRecords.resize( spCol.size() );
+				else if ( spCol.size() != vRecords.size() )
+					return false;
+				for ( size_t i = 0; i < spCol.size(); i++ )
+					std::get<I>( record<R>::tie( vRecords[i] ) ) = spCol[i];
+				return true;
+			}
+		}
+
+		std::vector<T> vCol;
+		if ( !convert( pCol, vCol ) )
+			return false;
+		if ( I == 0 )
+			vRecords.resize( vCol.size() );
+		else if ( vCol.size() != vRecords.size() )
+			return false;
+		for ( size_t i = 0; i < vCol.size(); i++ )
+			std::get<I>( record<R>::tie( vRecords[i] ) ) = std::move( vCol[i] );
+		return true;
+	}
+
+	template <typename R, size_t... Is>
+	bool _convert_columns( PyObject * pDict, std::vector<R>& vRecords, std::index_sequence<Is...> )
+	{
+		// Folding over && converts the columns in order, stopping at the first that fails
+		return ( _convert_column<Is>( pDict, vRecords ) && ... );
+	}
+
+	/*! convert \brief Convert a dict of columns to pyl::Columns (see above)*/
+	template <typename R>
+	bool convert( PyObject * obj, Columns<R>& columns )
+	{
+		if ( !PyDict_Check( obj ) )
+			return false;
+
+		std::vector<R> vRecords;
+		if ( !_convert_columns( obj, vRecords, std::make_index_sequence<_record_size<R>()>() ) )
+			return false;
+
+		columns.vRecords = std::move( vRecords );
+		return true;
+	}
+}
@@ -0,0 +1,368 @@
+/*      This program is free software; you can redistribute it and/or modify
+*      it under the terms of the GNU General Public License as published by
+*      the Free Software Foundation; either version 3 of the License, or
+*      (at your option) any later version.
+*
+*      This program is distributed in the hope that it will be useful,
+*      but WITHOUT ANY WARRANTY; without even the implied warranty of
+*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*      GNU General Public License for more details.
+*
+*      You should have received a copy of the GNU General Public License
+*      along with this program; if not, write to the Free Software
+*      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+*      MA 02110-1301, USA.
+*
+*      Author:
+*      John Joseph
+*
+*/
+
+
+#include "pylGIL.h"
+
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace pyl
+{
+	// GIL counters are kept per thread and call site. Like the call statistics,
+	// each thread only ever writes to its own counters, and the atomics let us read them from elsewhere
+	struct _GILCounters
+	{
+		std::atomic<uint64_t> uAcquires { 0 };
+		std::atomic<uint64_t> uWaitTotalNs { 0 };
+		std::atomic<uint64_t> uHoldTotalNs { 0 };
+		std::array<std::atomic<uint64_t>, 32> arWait {};
+		std::array<std::atomic<uint64_t>, 32> arHold {};
+	};
+
+	struct _GILThread
+	{
+		uint64_t uIndex;                                       /*!< Unique to this thread, never reused*/
+		std::string strName;                                   /*!< Guarded by _s_muGILStats*/
+		std::deque<_GILCounters> dqCounters;                   /*!< Indexed by site ID, grows on demand*/
+		std::unordered_map<const char *, size_t> mapSiteIDs;   /*!< Site IDs we've already looked up*/
+		bool bHolding { false };                               /*!< Whether a hold we know about is in progress*/
+		size_t uHoldSite { 0 };                                /*!< The site that started it*/
+		std::chrono::steady_clock::time_point tHoldStart;      /*!< And when*/
+		_GILThread();
+		~_GILThread();
+	};
+
+	// Guards everything but the counters themselves, which only their thread writes to
+	static std::mutex _s_muGILStats;
+	static std::vector<std::string> _s_vGILSites;                            /*!< Name of each site ID*/
+	static std::unordered_map<std::string, size_t> _s_mapGILSiteIDs;         /*!< Site ID of each name*/
+	static std::set<_GILThread *> _s_setGILThreads;                          /*!< Live threads*/
+	static std::map<std::string, GILStats> _s_mapGILRetired;                 /*!< Stats of threads that have exited, summed by site*/
+	static std::map<std::pair<uint64_t, std::string>, GILStats> _s_mapGILBaseline; /*!< Stats when last reset*/
+	static uint64_t _s_uNextGILThread( 0 );
+
+	// Threads that have exited share one row per site, so the stats don't grow with them
+	static const uint64_t c_uRetiredGILThread = std::numeric_limits<uint64_t>::max();
+	static const char * const c_szRetiredGILThread = "exited threads";
+
+	static thread_local _GILThread _s_tlGILThread;
+
+	// Get the stats out of a thread's counters (must hold _s_muGILStats)
+	static GILStats _read_gil_counters( const _GILThread& thread, size_t uSite )
+	{
+		const _GILCounters& counters = thread.dqCounters[uSite];
+		GILStats stats { thread.strName, _s_vGILSites[uSite], 0, 0, 0, {}, {} };
+		stats.uAcquires = counters.uAcquires.load( std::memory_order_relaxed );
+		stats.uWaitTotalNs = counters.uWaitTotalNs.load( std::memory_order_relaxed );
+		stats.uHoldTotalNs = counters.uHoldTotalNs.load( std::memory_order_relaxed );
+		for ( size_t b = 0; b < stats.arWait.size(); b++ )
+		{
+			stats.arWait[b] = counters.arWait[b].load( std::memory_order_relaxed );
+			stats.arHold[b] = counters.arHold[b].load( std::memory_order_relaxed );
+		}
+		return stats;
+	}
+
+	_GILThread::_GILThread()
+	{
+		std::lock_guard<std::mutex> lg( _s_muGILStats );
+		uIndex = _s_uNextGILThread++;
+		strName = "thread " + std::to_string( uIndex );
+		_s_setGILThreads.insert( this );
+	}
+
+	static void _add_gil_stats( GILStats& to, const GILStats& from )
+	{
+		to.uAcquires += from.uAcquires;
+		to.uWaitTotalNs += from.uWaitTotalNs;
+		to.uHoldTotalNs += from.uHoldTotalNs;
+		for ( size_t b = 0; b < to.arWait.size(); b++ )
+		{
+			to.arWait[b] += from.arWait[b];
+			to.arHold[b] += from.arHold[b];
+		}
+	}
+
+	// Add an exited thread's stats for a site to the row they're kept in
+	static void _retire_gil_stats( GILStats& row, const std::string& strSite, const GILStats& stats )
+	{
+		row.strThread = c_szRetiredGILThread;
+		row.strSite = strSite;
+		_add_gil_stats( row, stats );
+	}
+
+	// Add our stats (and the baseline they're reported against) to the exited threads' rows
+	_GILThread::~_GILThread()
+	{
+		std::lock_guard<std::mutex> lg( _s_muGILStats );
+		_s_setGILThreads.erase( this );
+		for ( size_t uSite = 0; uSite < dqCounters.size(); uSite++ )
+		{
+			const std::string& strSite = _s_vGILSites[uSite];
+			_retire_gil_stats( _s_mapGILRetired[strSite], strSite, _read_gil_counters( *this, uSite ) );
+
+			auto itBase = _s_mapGILBaseline.find( { uIndex, strSite } );
+			if ( itBase != _s_mapGILBaseline.end() )
+			{
+				_retire_gil_stats( _s_mapGILBaseline[{ c_uRetiredGILThread, strSite }], strSite, itBase->second );
+				_s_mapGILBaseline.erase( itBase );
+			}
+		}
+	}
+
+#ifdef PYL_GIL_STATS
+	// Only the owning thread writes, so there's no need for an atomic increment
+	static inline void _bump_gil( std::atomic<uint64_t>& counter, uint64_t uAmount )
+	{
+		counter.store( counter.load( std::memory_order_relaxed ) + uAmount, std::memory_order_relaxed );
+	}
+
+	// Bucket by the highest set bit
+	static inline size_t _gil_bucket( uint64_t uNs )
+	{
+		size_t uBucket( 0 );
+		for ( uint64_t uRem = uNs >> 1; uRem && uBucket < 31; uRem >>= 1 )
+			uBucket++;
+		return uBucket;
+	}
+
+	static inline uint64_t _ns_since( std::chrono::steady_clock::time_point tStart )
+	{
+		return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - tStart ).count();
+	}
+
+	// Get the counters for a site on this thread, registering it if we've never seen it
+	static _GILCounters& _get_gil_counters( _GILThread& thread, const char * szSite, size_t& uSite )
+	{
+		auto itSite = thread.mapSiteIDs.find( szSite );
+		if ( itSite != thread.mapSiteIDs.end() )
+			uSite = itSite->second;
+		else
+		{
+			std::lock_guard<std::mutex> lg( _s_muGILStats );
+			auto paInsert = _s_mapGILSiteIDs.emplace( szSite, _s_vGILSites.size() );
+			if ( paInsert.second )
+				_s_vGILSites.push_back( szSite );
+			uSite = paInsert.first->second;
+			thread.mapSiteIDs[szSite] = uSite;
+			while ( uSite >= thread.dqCounters.size() )
+				thread.dqCounters.emplace_back();
+		}
+		return thread.dqCounters[uSite];
+	}
+
+	// Record a wait for the GIL at some site, which starts a hold charged to that site
+	static void _gil_acquired( const char * szSite, std::chrono::steady_clock::time_point tWaitStart )
+	{
+		_GILThread& thread = _s_tlGILThread;
+		thread.tHoldStart = std::chrono::steady_clock::now();
+		uint64_t uWaitNs = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>( thread.tHoldStart - tWaitStart ).count();
+
+		_GILCounters& counters = _get_gil_counters( thread, szSite, thread.uHoldSite );
+		_bump_gil( counters.uAcquires, 1 );
+		_bump_gil( counters.uWaitTotalNs, uWaitNs );
+		_bump_gil( counters.arWait[_gil_bucket( uWaitNs )], 1 );
+		thread.bHolding = true;
+	}
+
+	// Record the end of whatever hold is in progress (if we saw it start)
+	static void _gil_releasing()
+	{
+		_GILThread& thread = _s_tlGILThread;
+		if ( thread.bHolding == false )
+			return;
+
+		uint64_t uHoldNs = _ns_since( thread.tHoldStart );
+		_GILCounters& counters = thread.dqCounters[thread.uHoldSite];
+		_bump_gil( counters.uHoldTotalNs, uHoldNs );
+		_bump_gil( counters.arHold[_gil_bucket( uHoldNs )], 1 );
+		thread.bHolding = false;
+	}
+#endif // PYL_GIL_STATS
+
+	GILGuard::GILGuard( const char * szSite /*= "unnamed"*/ ) :
+		m_bOuter( PyGILState_Check() == 0 )
+	{
+#ifdef PYL_GIL_STATS
+		auto tStart = std::chrono::steady_clock::now();
+		m_State = PyGILState_Ensure();
+		if ( m_bOuter )
+			_gil_acquired( szSite, tStart );
+#else
+		(void) szSite;
+		m_State = PyGILState_Ensure();
+#endif
+	}
+
+	GILGuard::~GILGuard()
+	{
+#ifdef PYL_GIL_STATS
+		if ( m_bOuter )
+			_gil_releasing();
+#endif
+		PyGILState_Release( m_State );
+	}
+
+	GILRelease::GILRelease( const char * szSite /*= "unnamed"*/ ) :
+		m_szSite( szSite )
+	{
+#ifdef PYL_GIL_STATS
+		_gil_releasing();
+#endif
+		m_pState = PyEval_SaveThread();
+	}
+
+	GILRelease::~GILRelease()
+	{
+#ifdef PYL_GIL_STATS
+		auto tStart = std::chrono::steady_clock::now();
+		PyEval_RestoreThread( m_pState );
+		_gil_acquired( m_szSite, tStart );
+#else
+		PyEval_RestoreThread( m_pState );
+#endif
+	}
+
+	// Interpolate within the bucket the percentile falls in
+	static double _histogram_percentile( const std::array<uint64_t, 32>& arHist, double p )
+	{
+		uint64_t uTotal( 0 );
+		for ( uint64_t uCount : arHist )
+			uTotal += uCount;
+		if ( uTotal == 0 )
+			return 0;
+
+		const double dRank = std::min( std::max( p, 0. ), 100. ) / 100. * uTotal;
+		uint64_t uSeen( 0 );
+		for ( size_t b = 0; b < arHist.size(); b++ )
+		{
+			if ( arHist[b] && uSeen + arHist[b] >= dRank )
+			{
+				double dLow = b ? double( uint64_t( 1 ) << b ) : 0.;
+				double dHigh = double( uint64_t( 1 ) << ( b + 1 ) );
+				return dLow + ( dHigh - dLow ) * ( dRank - uSeen ) / arHist[b];
+			}
+			uSeen += arHist[b];
+		}
+		return double( uint64_t( 1 ) << arHist.size() );
+	}
+
+	double GILStats::WaitPercentile( double p ) const
+	{
+		return _histogram_percentile( arWait, p );
+	}
+
+	double GILStats::HoldPercentile( double p ) const
+	{
+		return _histogram_percentile( arHold, p );
+	}
+
+	// Get every thread's stats, keyed by thread index (must hold _s_muGILStats)
+	static std::vector<std::pair<uint64_t, GILStats>> _sum_gil_stats()
+	{
+		std::vector<std::pair<uint64_t, GILStats>> vStats;
+		for ( const auto& paRetired : _s_mapGILRetired )
+			vStats.emplace_back( c_uRetiredGILThread, paRetired.second );
+		for ( const _GILThread * pThread : _s_setGILThreads )
+			for ( size_t uSite = 0; uSite < pThread->dqCounters.size(); uSite++ )
+				vStats.emplace_back( pThread->uIndex, _read_gil_counters( *pThread, uSite ) );
+
+		// In the order the threads first took the GIL, with those that have exited last
+		std::sort( vStats.begin(), vStats.end(), []( const std::pair<uint64_t, GILStats>& a, const std::pair<uint64_t, GILStats>& b ) {
+			return a.first != b.first ? a.first < b.first : a.second.strSite < b.second.strSite;
+		} );
+		return vStats;
+	}
+
+	std::vector<GILStats> get_gil_stats()
+	{
+		std::lock_guard<std::mutex> lg( _s_muGILStats );
+		std::vector<GILStats> vRet;
+		for ( auto& paStats : _sum_gil_stats() )
+		{
+			GILStats& stats = paStats.second;
+			auto itBase = _s_mapGILBaseline.find( { paStats.first, stats.strSite } );
+			if ( itBase != _s_mapGILBaseline.end() )
+			{
+				const GILStats& base = itBase->second;
+				stats.uAcquires -= base.uAcquires;
+				stats.uWaitTotalNs -= base.uWaitTotalNs;
+				stats.uHoldTotalNs -= base.uHoldTotalNs;
+				for ( size_t b = 0; b < stats.arWait.size(); b++ )
+				{
+					stats.arWait[b] -= base.arWait[b];
+					stats.arHold[b] -= base.arHold[b];
+				}
+			}
+
+			if ( stats.uAcquires || stats.uHoldTotalNs )
+				vRet.push_back( std::move( stats ) );
+		}
+		return vRet;
+	}
+
+	// Rather than zero counters that other threads are writing to, remember where we are now
+	void reset_gil_stats()
+	{
+		std::lock_guard<std::mutex> lg( _s_muGILStats );
+		_s_mapGILBaseline.clear();
+		for ( auto& paStats : _sum_gil_stats() )
+			_s_mapGILBaseline[{ paStats.first, paStats.second.strSite }] = paStats.second;
+	}
+
+	void name_gil_thread( std::string strName )
+	{
+		_GILThread& thread = _s_tlGILThread;
+		std::lock_guard<std::mutex> lg( _s_muGILStats );
+		thread.strName = strName;
+	}
+
+	std::string get_gil_report()
+	{
+		std::vector<GILStats> vStats = get_gil_stats();
+		uint64_t uTotalHoldNs( 0 );
+		for ( const GILStats& stats : vStats )
+			uTotalHoldNs += stats.uHoldTotalNs;
+
+		// Times are in microseconds
+		std::ostringstream out;
+		out << std::fixed << std::setprecision( 1 );
+		out << std::left << std::setw( 16 ) << "thread" << std::right
+			<< std::setw( 10 ) << "acquires"
+			<< std::setw( 10 ) << "wait p50" << std::setw( 10 ) << "p90" << std::setw( 10 ) << "p99"
+			<< std::setw( 10 ) << "hold p50" << std::setw( 10 ) << "p90" << std::setw( 10 ) << "p99"
+			<< std::setw( 8 ) << "held %" << "  site\n";
+		for ( const GILStats& stats : vStats )
+		{
+			out << std::left << std::setw( 16 ) << stats.strThread << std::right
+				<< std::setw( 10 ) << stats.uAcquires
+				<< std::setw( 10 ) << stats.WaitPercentile( 50 ) / 1000 << std::setw( 10 ) << stats.WaitPercentile( 90 ) / 1000 << std::setw( 10 ) << stats.WaitPercentile( 99 ) / 1000
+				<< std::setw( 10 ) << stats.HoldPercentile( 50 ) / 1000 << std::setw( 10 ) << stats.HoldPercentile( 90 ) / 1000 << std::setw( 10 ) << stats.HoldPercentile( 99 ) / 1000
+				<< std::setw( 8 ) << ( uTotalHoldNs ? 100. * stats.uHoldTotalNs / uTotalHoldNs : 0. ) << "  " << stats.strSite << "\n";
+		}
+		return out.str();
+	}
+}
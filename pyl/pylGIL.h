@@ -0,0 +1,96 @@
+#pragma once
+
+#include "pyliaison.h"
+
+// Names the call site of a GIL guard by file and line
+#define _PYL_STRINGIFY( x ) #x
+#define _PYL_TOSTRING( x ) _PYL_STRINGIFY( x )
+#define PYL_GIL_SITE __FILE__ ":" _PYL_TOSTRING( __LINE__ )
+
+namespace pyl
+{
+	/********************************************//*!
+	pyl::GILGuard
+	\brief Holds the GIL for as long as it's alive
+
+	Use this to call into python from a thread other than the one that started
+	the interpreter. Guards can be nested; only the outermost one on a thread
+	acquires and releases the GIL.
+
+	When pyliaison is built with PYL_GIL_STATS, the time spent waiting for the GIL
+	and the time it was held afterward are recorded for this thread and call site.
+	The site should be a string literal, like the one PYL_GIL_SITE gives you.
+	***********************************************/
+	class GILGuard
+	{
+		PyGILState_STATE m_State; /*!< What PyGILState_Ensure gave us*/
+		bool m_bOuter;            /*!< Whether we actually acquired the GIL*/
+	public:
+		GILGuard( const char * szSite = "unnamed" );
+		~GILGuard();
+		GILGuard( const GILGuard& ) = delete;
+		GILGuard& operator=( const GILGuard& ) = delete;
+	};
+
+	/********************************************//*!
+	pyl::GILRelease
+	\brief Lets other threads run python for as long as it's alive
+
+	Use this around long running C++ code (or blocking calls) made while holding
+	the GIL, including in the thread that started the interpreter. When pyliaison
+	is built with PYL_GIL_STATS, the time spent getting the GIL back is recorded
+	as a wait at this call site.
+	***********************************************/
+	class GILRelease
+	{
+		PyThreadState * m_pState; /*!< Our thread state, while it's saved*/
+		const char * m_szSite;    /*!< Where we'll get the GIL back*/
+	public:
+		GILRelease( const char * szSite = "unnamed" );
+		~GILRelease();
+		GILRelease( const GILRelease& ) = delete;
+		GILRelease& operator=( const GILRelease& ) = delete;
+	};
+
+	/*! GILStats
+	\brief How long one thread waited for and held the GIL at one call site
+
+	Histogram bucket i counts the waits or holds taking [2^i, 2^(i+1)) ns. A hold
+	is charged to the site that acquired the GIL, and ends when the guard goes
+	away or a GILRelease lets it go*/
+	struct GILStats
+	{
+		std::string strThread;            /*!< The thread's name (see name_gil_thread)*/
+		std::string strSite;              /*!< The call site given to the guard*/
+		uint64_t uAcquires;               /*!< Number of times the GIL was acquired here*/
+		uint64_t uWaitTotalNs;            /*!< Cumulative time spent waiting for the GIL*/
+		uint64_t uHoldTotalNs;            /*!< Cumulative time spent holding the GIL*/
+		std::array<uint64_t, 32> arWait;  /*!< Wait time histogram*/
+		std::array<uint64_t, 32> arHold;  /*!< Hold time histogram*/
+
+		/*! WaitPercentile \brief Estimate the pth percentile (0-100) wait time, in ns*/
+		double WaitPercentile( double p ) const;
+
+		/*! HoldPercentile \brief Estimate the pth percentile (0-100) hold time, in ns*/
+		double HoldPercentile( double p ) const;
+	};
+
+	/*! get_gil_stats \brief Get the GIL statistics of every thread and call site
+	Threads that have exited are summed into one row per site, from a thread called
+	"exited threads". Returns nothing if pyliaison wasn't built with PYL_GIL_STATS*/
+	std::vector<GILStats> get_gil_stats();
+
+	/*! reset_gil_stats \brief Start collecting GIL statistics from scratch*/
+	void reset_gil_stats();
+
+	/*! name_gil_thread \brief Name the calling thread in the GIL statistics
+	Threads are called "thread N", in the order they first took the GIL, until they're named*/
+	void name_gil_thread( std::string strName );
+
+	/*! get_gil_report
+	\brief Format the GIL statistics as a table
+
+	Each row is a thread and call site, with the number of acquisitions, the p50, p90
+	and p99 wait and hold times (in microseconds) and its share of the time the GIL was held*/
+	std::string get_gil_report();
+}
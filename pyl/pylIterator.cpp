@@ -0,0 +1,122 @@
+/*      This program is free software; you can redistribute it and/or modify
+*      it under the terms of the GNU General Public License as published by
+*      the Free Software Foundation; either version 3 of the License, or
+*      (at your option) any later version.
+*
+*      This program is distributed in the hope that it will be useful,
+*      but WITHOUT ANY WARRANTY; without even the implied warranty of
+*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*      GNU General Public License for more details.
+*
+*      You should have received a copy of the GNU General Public License
+*      along with this program; if not, write to the Free Software
+*      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+*      MA 02110-1301, USA.
+*
+*      Author:
+*      John Joseph
+*
+*/
+
+
+#include "pylIterator.h"
+
+namespace pyl
+{
+	// The python object backing make_iterator
+	struct _PyIterator
+	{
+		PyObject_HEAD
+		_IteratorSource * pSource; /*!< Owned, deleted on dealloc*/
+		size_t uChunk;             /*!< Items generated at a time*/
+		size_t uCount;             /*!< Items in the current chunk*/
+		size_t uPos;               /*!< Items of it we've handed out*/
+	};
+
+	static void _PyIterator_dealloc( PyObject * self )
+	{
+		_PyIterator * pIter = (_PyIterator *) self;
+		delete pIter->pSource;
+		pIter->pSource = nullptr;
+		Py_TYPE( self )->tp_free( self );
+	}
+
+	static PyObject * _PyIterator_iternext( PyObject * self )
+	{
+		_PyIterator * pIter = (_PyIterator *) self;
+		if ( pIter->pSource == nullptr )
+			return nullptr;
+
+		if ( pIter->uPos == pIter->uCount )
+		{
+			pIter->uPos = 0;
+			try
+			{
+				// Chunks are generated without the GIL, single items with it
+				if ( pIter->uChunk > 1 )
+				{
+					GILRelease gil( "pyl::make_iterator" );
+					pIter->uCount = pIter->pSource->Fill( pIter->uChunk );
+				}
+				else
+					pIter->uCount = pIter->pSource->Fill( 1 );
+			}
+			catch ( std::exception& e )
+			{
+				pIter->uCount = 0;
+				PyErr_SetString( PyExc_RuntimeError, e.what() );
+				return nullptr;
+			}
+
+			// Once we run out we're done for good (returning null without an error stops iteration)
+			if ( pIter->uCount == 0 )
+			{
+				delete pIter->pSource;
+				pIter->pSource = nullptr;
+				return nullptr;
+			}
+		}
+
+		return pIter->pSource->Alloc( pIter->uPos++ );
+	}
+
+	// Created once, readied whenever an iterator is made
+	static PyTypeObject * _get_iterator_type()
+	{
+		static PyTypeObject s_TypeObject = []()
+		{
+			PyTypeObject typeObj;
+			memset( &typeObj, 0, sizeof( PyTypeObject ) );
+			typeObj.ob_base = PyVarObject_HEAD_INIT( NULL, 0 )
+			typeObj.tp_name = "pyl.Iterator";
+			typeObj.tp_doc = "Iterates over the items of a C++ generator";
+			typeObj.tp_basicsize = sizeof( _PyIterator );
+			typeObj.tp_flags = Py_TPFLAGS_DEFAULT;
+			typeObj.tp_dealloc = (destructor) _PyIterator_dealloc;
+			typeObj.tp_iter = PyObject_SelfIter;
+			typeObj.tp_iternext = (iternextfunc) _PyIterator_iternext;
+			return typeObj;
+		}();
+
+		if ( PyType_Ready( &s_TypeObject ) < 0 )
+			return nullptr;
+		return &s_TypeObject;
+	}
+
+	Object _make_iterator( std::unique_ptr<_IteratorSource> upSource, size_t uChunk )
+	{
+		PyTypeObject * pTypeObj = _get_iterator_type();
+		if ( pTypeObj == nullptr )
+			throw runtime_error( "Error readying pyl iterator type" );
+
+		_PyIterator * pIter = PyObject_New( _PyIterator, pTypeObj );
+		if ( pIter == nullptr )
+			throw runtime_error( "Error creating pyl iterator" );
+
+		pIter->pSource = upSource.release();
+		pIter->uChunk = std::max<size_t>( 1, uChunk );
+		pIter->uCount = 0;
+		pIter->uPos = 0;
+		return Object::steal( (PyObject *) pIter );
+	}
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "pylGIL.h"
+
+#include <algorithm>
+#include <optional>
+
+namespace pyl
+{
+	/********************************************//*!
+	pyl::Iterable
+	\brief Iterates a python iterable (like a generator) from C++
+	\tparam T The C++ type each item is converted to
+
+	Items are pulled from python uChunk at a time, each chunk under a single
+	GILGuard, and handed out from C++ afterward; the body of a range-for over
+	this runs without touching the interpreter until the next chunk is needed,
+	so it can be used from any thread. Like any python iterator this can only
+	be iterated once.
+
+	Throws a pyl::runtime_error if the iterable raises or an item can't be converted.
+	***********************************************/
+	template <typename T>
+	class Iterable
+	{
+		Object m_obIter;          /*!< The python iterator*/
+		size_t m_uChunk;          /*!< Items pulled per chunk*/
+		std::vector<T> m_vChunk;  /*!< The current chunk*/
+		size_t m_uPos;            /*!< Our position in it*/
+		bool m_bExhausted;        /*!< Whether the python iterator has run dry*/
+
+		// Pull the next chunk out of python. Items may hold python objects,
+		// so the old chunk only goes once we've got the GIL
+		void refill()
+		{
+			GILGuard gil( "pyl::Iterable" );
+			m_vChunk.clear();
+			m_uPos = 0;
+
+			while ( m_bExhausted == false && m_vChunk.size() < m_uChunk )
+			{
+				unique_ptr upItem( PyIter_Next( m_obIter.get() ) );
+				if ( !upItem )
+				{
+					m_bExhausted = true;
+					if ( PyErr_Occurred() )
+					{
+						clear_error();
+						throw runtime_error( "Error iterating python object" );
+					}
+				}
+				else
+				{
+					m_vChunk.emplace_back();
+					if ( !_convert_scoped( upItem.get(), m_vChunk.back() ) )
+					{
+						clear_error();
+						throw runtime_error( "Error converting python iterator item" );
+					}
+				}
+			}
+		}
+
+	public:
+		/*! Iterable
+		\brief Start iterating a python object
+
+		\param[in] obIterable Anything python can iterate over
+		\param[in] uChunk The number of items to pull from python at a time*/
+		Iterable( const Object& obIterable, size_t uChunk = 1 ) :
+			m_uChunk( std::max<size_t>( 1, uChunk ) ),
+			m_uPos( 0 ),
+			m_bExhausted( false )
+		{
+			GILGuard gil( "pyl::Iterable" );
+			PyObject * pIter = PyObject_GetIter( obIterable.get() );
+			if ( pIter == nullptr )
+			{
+				clear_error();
+				throw runtime_error( "Error getting python iterator" );
+			}
+			m_obIter = Object::steal( pIter );
+			m_vChunk.reserve( m_uChunk );
+		}
+
+		// We may not be holding the GIL when we're done, and items may hold python objects
+		~Iterable()
+		{
+			GILGuard gil( "pyl::Iterable" );
+			m_vChunk.clear();
+			m_obIter.reset();
+		}
+
+		Iterable( const Iterable& ) = delete;
+		Iterable& operator=( const Iterable& ) = delete;
+
+		// Single pass iterator, which all refers to the same chunk
+		class iterator
+		{
+			Iterable * m_pOwner; /*!< Null at the end*/
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = T;
+			using difference_type = std::ptrdiff_t;
+			using pointer = T *;
+			using reference = T&;
+
+			iterator( Iterable * pOwner ) : m_pOwner( pOwner ) {}
+			T& operator*() const { return m_pOwner->m_vChunk[m_pOwner->m_uPos]; }
+			T * operator->() const { return &**this; }
+			iterator& operator++()
+			{
+				if ( ++m_pOwner->m_uPos == m_pOwner->m_vChunk.size() )
+				{
+					// We're done once python has nothing left to give
+					if ( m_pOwner->m_bExhausted == false )
+						m_pOwner->refill();
+					if ( m_pOwner->m_uPos == m_pOwner->m_vChunk.size() )
+						m_pOwner = nullptr;
+				}
+				return *this;
+			}
+			bool operator==( const iterator& other ) const { return m_pOwner == other.m_pOwner; }
+			bool operator!=( const iterator& other ) const { return m_pOwner != other.m_pOwner; }
+		};
+
+		/*! begin \brief Pull the first chunk and start iterating*/
+		iterator begin()
+		{
+			if ( m_uPos >= m_vChunk.size() && !m_bExhausted )
+				refill();
+			return iterator( m_uPos < m_vChunk.size() ? this : nullptr );
+		}
+
+		/*! end \brief The iterator we reach when python runs out of items*/
+		iterator end()
+		{
+			return iterator( nullptr );
+		}
+	};
+
+	/*! iterate
+	\brief Iterate a python iterable from C++, i.e for ( int i : pyl::iterate<int>( obGen ) )
+
+	\param[in] obIterable Anything python can iterate over
+	\param[in] uChunk The number of items to pull from python at a time*/
+	template <typename T>
+	Iterable<T> iterate( const Object& obIterable, size_t uChunk = 1 )
+	{
+		return Iterable<T>( obIterable, uChunk );
+	}
+
+	// A C++ generator whose items are handed to python by a pyl iterator object
+	struct _IteratorSource
+	{
+		virtual ~_IteratorSource() {}
+
+		// Fill our chunk with up to uMax items, returning how many we got
+		virtual size_t Fill( size_t uMax ) = 0;
+
+		// Allocate a python object for item i of the chunk
+		virtual PyObject * Alloc( size_t i ) = 0;
+	};
+
+	template <typename T>
+	struct _TypedIteratorSource : public _IteratorSource
+	{
+		std::function<std::optional<T>()> fnNext;
+		std::vector<T> vChunk;
+		bool bExhausted { false };
+
+		_TypedIteratorSource( std::function<std::optional<T>()> fn ) : fnNext( fn ) {}
+
+		size_t Fill( size_t uMax ) override
+		{
+			vChunk.clear();
+			while ( bExhausted == false && vChunk.size() < uMax )
+			{
+				std::optional<T> optItem = fnNext();
+				if ( optItem )
+					vChunk.push_back( std::move( *optItem ) );
+				else
+					bExhausted = true;
+			}
+			return vChunk.size();
+		}
+
+		PyObject * Alloc( size_t i ) override
+		{
+			return _alloc_scoped( vChunk[i] );
+		}
+	};
+
+	// Used internally to wrap an iterator source in a python iterator object
+	Object _make_iterator( std::unique_ptr<_IteratorSource> upSource, size_t uChunk );
+
+	/*! make_iterator
+	\brief Expose a C++ generator to python as an iterator
+
+	\param[in] fnNext Returns the next item, or nothing once it's done
+	\param[in] uChunk The number of items to generate at a time
+	\param[out] obIter A python iterator yielding the generator's items
+
+	With a chunk size of 1 fnNext is called with the GIL held whenever python asks
+	for an item. With a larger chunk it's called up to uChunk times in a row with
+	the GIL released, so other threads can run python while it works, and its items
+	are handed out one at a time afterward. In that case fnNext must not touch python.
+	Exceptions thrown by fnNext are raised in python as a RuntimeError.*/
+	template <typename T>
+	Object make_iterator( std::function<std::optional<T>()> fnNext, size_t uChunk = 1 )
+	{
+		return _make_iterator( std::unique_ptr<_IteratorSource>( new _TypedIteratorSource<T>( fnNext ) ), uChunk );
+	}
+}
@@ -0,0 +1,331 @@
+/*      This program is free software; you can redistribute it and/or modify
+*      it under the terms of the GNU General Public License as published by
+*      the Free Software Foundation; either version 3 of the License, or
+*      (at your option) any later version.
+*
+*      This program is distributed in the hope that it will be useful,
+*      but WITHOUT ANY WARRANTY; without even the implied warranty of
+*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*      GNU General Public License for more details.
+*
+*      You should have received a copy of the GNU General Public License
+*      along with this program; if not, write to the Free Software
+*      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+*      MA 02110-1301, USA.
+*
+*      Author:
+*      John Joseph
+*
+*/
+
+
+#include "pylProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+#include <frameobject.h>
+
+namespace pyl
+{
+	// The running profiler, only touched while holding the GIL
+	static Profiler * _s_pActiveProfiler = nullptr;
+
+	Profiler::Profiler() :
+		m_bRunning( false ),
+		m_uTicks( 0 ),
+		m_uCalleeTicks( 0 ),
+		m_uSeenTicks( 0 ),
+		m_uSeenCalleeTicks( 0 )
+#ifdef PYL_PROFILE_CALLEES
+		, m_pCallee( nullptr )
+#endif
+	{}
+
+	Profiler::~Profiler()
+	{
+		Stop();
+	}
+
+	bool Profiler::Start( int nIntervalUs /*= 1000*/ )
+	{
+		if ( _s_pActiveProfiler || !Py_IsInitialized() )
+			return false;
+
+		// Seed our stack with whatever python is already running
+		m_vStack.clear();
+		std::vector<PyObject *> vCode;
+		for ( PyFrameObject * pFrame = PyEval_GetFrame(); pFrame; )
+		{
+			// PyFrame_GetCode and PyFrame_GetBack give us new references,
+			// but the frames and their code are alive for as long as they're on the stack
+			PyCodeObject * pCode = PyFrame_GetCode( pFrame );
+			vCode.push_back( (PyObject *) pCode );
+			Py_DECREF( pCode );
+
+			PyFrameObject * pBack = PyFrame_GetBack( pFrame );
+			Py_XDECREF( pBack );
+			pFrame = pBack;
+		}
+		std::for_each( vCode.rbegin(), vCode.rend(), [this]( PyObject * pCode ) { pushCode( pCode ); } );
+
+		// Start ticking
+		m_uTicks = m_uCalleeTicks = 0;
+		m_uSeenTicks = m_uSeenCalleeTicks = 0;
+#ifdef PYL_PROFILE_CALLEES
+		// The profiled thread outlives the sampler, since Stop joins it
+		m_pCallee = &_t_nProfileCallee;
+#endif
+		m_bRunning = true;
+		m_thSampler = std::thread( [this, nIntervalUs]()
+		{
+			const std::chrono::microseconds tInterval( std::max( nIntervalUs, 1 ) );
+			while ( m_bRunning.load( std::memory_order_relaxed ) )
+			{
+				std::this_thread::sleep_for( tInterval );
+#ifdef PYL_PROFILE_CALLEES
+				if ( m_pCallee->load( std::memory_order_relaxed ) > 0 )
+					m_uCalleeTicks.fetch_add( 1, std::memory_order_relaxed );
+#endif
+				m_uTicks.fetch_add( 1, std::memory_order_release );
+			}
+		} );
+
+		_s_pActiveProfiler = this;
+#ifdef PYL_PROFILE_CALLEES
+		_g_bProfiling = true;
+#endif
+		PyEval_SetProfile( profileCallback, nullptr );
+
+		return true;
+	}
+
+	void Profiler::Stop()
+	{
+		if ( !IsRunning() )
+			return;
+
+		if ( Py_IsInitialized() )
+			PyEval_SetProfile( nullptr, nullptr );
+#ifdef PYL_PROFILE_CALLEES
+		_g_bProfiling = false;
+#endif
+		_s_pActiveProfiler = nullptr;
+
+		m_bRunning = false;
+		m_thSampler.join();
+		m_vStack.clear();
+	}
+
+	bool Profiler::IsRunning() const
+	{
+		return m_thSampler.joinable();
+	}
+
+	void Profiler::Clear()
+	{
+		m_mapSamples.clear();
+	}
+
+	std::string Profiler::GetCollapsedStacks() const
+	{
+		// Sort the stacks so that the output is stable
+		std::vector<std::pair<std::string, uint64_t>> vSamples( m_mapSamples.begin(), m_mapSamples.end() );
+		std::sort( vSamples.begin(), vSamples.end() );
+
+		std::string strOut;
+		for ( const auto& sample : vSamples )
+			strOut += sample.first + " " + std::to_string( sample.second ) + "\n";
+		return strOut;
+	}
+
+	bool Profiler::WriteCollapsedStacks( std::string strFileName ) const
+	{
+		std::ofstream out( strFileName );
+		if ( !out.good() )
+			return false;
+
+		out << GetCollapsedStacks();
+		return out.good();
+	}
+
+	uint64_t Profiler::GetSampleCount() const
+	{
+		uint64_t uCount( 0 );
+		for ( const auto& sample : m_mapSamples )
+			uCount += sample.second;
+		return uCount;
+	}
+
+	// Called by the interpreter on every call and return, we charge
+	// any ticks that have elapsed since the last event to our stack
+	// (which is what was running until now) before updating it
+	/*static*/ int Profiler::profileCallback( PyObject *, PyFrameObject * pFrame, int nWhat, PyObject * pArg )
+	{
+		Profiler * pProfiler = _s_pActiveProfiler;
+		if ( pProfiler == nullptr )
+			return 0;
+
+		uint64_t uTicks = pProfiler->m_uTicks.load( std::memory_order_acquire );
+		if ( uTicks != pProfiler->m_uSeenTicks )
+		{
+			uint64_t uCalleeTicks = pProfiler->m_uCalleeTicks.load( std::memory_order_relaxed );
+			pProfiler->sample( uTicks - pProfiler->m_uSeenTicks, uCalleeTicks - pProfiler->m_uSeenCalleeTicks );
+			pProfiler->m_uSeenTicks = uTicks;
+			pProfiler->m_uSeenCalleeTicks = uCalleeTicks;
+		}
+
+		std::vector<Frame>& vStack = pProfiler->m_vStack;
+		switch ( nWhat )
+		{
+			case PyTrace_CALL:
+			{
+				PyCodeObject * pCode = PyFrame_GetCode( pFrame );
+				pProfiler->pushCode( (PyObject *) pCode );
+				Py_DECREF( pCode );
+				break;
+			}
+			case PyTrace_C_CALL:
+				pProfiler->pushFunction( pArg );
+				break;
+			// If we started profiling partway through something
+			// we may see returns for calls we never saw being made
+			case PyTrace_RETURN:
+				if ( !vStack.empty() && vStack.back().bCode )
+					vStack.pop_back();
+				break;
+			case PyTrace_C_RETURN:
+			case PyTrace_C_EXCEPTION:
+				if ( !vStack.empty() && !vStack.back().bCode )
+					vStack.pop_back();
+				break;
+		}
+
+		return 0;
+	}
+
+	void Profiler::pushCode( PyObject * pCode )
+	{
+		m_vStack.push_back( { pCode, pCode, true, false } );
+	}
+
+	void Profiler::pushFunction( PyObject * pFunc )
+	{
+		// Key C functions by their method def, since bound methods are created for every call
+		PyMethodDef * pMethodDef = nullptr;
+		if ( PyCFunction_Check( pFunc ) )
+			pMethodDef = ( (PyCFunctionObject *) pFunc )->m_ml;
+		else if ( PyObject_TypeCheck( pFunc, &PyMethodDescr_Type ) )
+			pMethodDef = ( (PyMethodDescrObject *) pFunc )->d_method;
+
+		if ( pMethodDef )
+			m_vStack.push_back( { pMethodDef, pFunc, false, _get_binding_name( pMethodDef->ml_meth ) != nullptr } );
+		else
+			m_vStack.push_back( { Py_TYPE( pFunc ), pFunc, false, false } );
+	}
+
+	// Charge ticks to the current stack, splitting the time spent in pyl bindings
+	void Profiler::sample( uint64_t uTicks, uint64_t uCalleeTicks )
+	{
+		std::string strStack;
+		for ( const Frame& frame : m_vStack )
+		{
+			if ( !strStack.empty() )
+				strStack += ';';
+			strStack += getName( frame );
+		}
+
+		if ( strStack.empty() )
+			strStack = "[idle]";
+
+		// Bindings are only split if they mark their time in the callee
+#ifdef PYL_PROFILE_CALLEES
+		const bool bSplit = !m_vStack.empty() && m_vStack.back().bBinding;
+#else
+		const bool bSplit = false;
+#endif
+		if ( !bSplit )
+		{
+			m_mapSamples[strStack] += uTicks;
+			return;
+		}
+
+		// Callee ticks may have elapsed while python code called from the callee was running,
+		// in which case they've already been charged to that code
+		uCalleeTicks = std::min( uCalleeTicks, uTicks );
+		if ( uCalleeTicks )
+			m_mapSamples[strStack + ";[C++]"] += uCalleeTicks;
+		if ( uTicks > uCalleeTicks )
+			m_mapSamples[strStack + ";[conversion]"] += uTicks - uCalleeTicks;
+	}
+
+	// Names are cached on first use; we hold on to code objects
+	// we've named so their addresses can't be reused by other code
+	const std::string& Profiler::getName( const Frame& frame )
+	{
+		auto it = m_mapNames.find( frame.pKey );
+		if ( it != m_mapNames.end() )
+			return it->second;
+
+		// Get a string attribute of some object (without disturbing any error that's set)
+		auto getStr = []( PyObject * pObj, const char * szAttr ) -> std::string
+		{
+			PyObject *pType, *pValue, *pTrace;
+			PyErr_Fetch( &pType, &pValue, &pTrace );
+			std::string strRet;
+			unique_ptr upAttr( PyObject_GetAttrString( pObj, szAttr ) );
+			if ( upAttr && PyUnicode_Check( upAttr.get() ) )
+				strRet = PyUnicode_AsUTF8( upAttr.get() );
+			else if ( upAttr && PyLong_Check( upAttr.get() ) )
+				strRet = std::to_string( PyLong_AsLong( upAttr.get() ) );
+			PyErr_Clear();
+			PyErr_Restore( pType, pValue, pTrace );
+			return strRet;
+		};
+
+		std::string strName;
+		if ( frame.bCode )
+		{
+			// function (file.py:line)
+			std::string strFunc = getStr( frame.pObj, "co_qualname" );
+			std::string strFile = getStr( frame.pObj, "co_filename" );
+			strFile = strFile.substr( strFile.find_last_of( "/\\" ) + 1 );
+			strName = ( strFunc.empty() ? getStr( frame.pObj, "co_name" ) : strFunc ) + " (" + strFile + ":" + getStr( frame.pObj, "co_firstlineno" ) + ")";
+			m_liCodeRefs.emplace_back( frame.pObj );
+		}
+		else if ( frame.pKey == Py_TYPE( frame.pObj ) )
+		{
+			strName = Py_TYPE( frame.pObj )->tp_name;
+		}
+		else
+		{
+			// Bindings get their registered names, other C functions
+			// are qualified by their module or the type they're bound to
+			const PyMethodDef * pMethodDef = (const PyMethodDef *) frame.pKey;
+			if ( const std::string * pBindingName = _get_binding_name( pMethodDef->ml_meth ) )
+			{
+				strName = *pBindingName + " [pyl]";
+			}
+			else
+			{
+				std::string strOwner;
+				if ( PyCFunction_Check( frame.pObj ) )
+				{
+					PyObject * pSelf = PyCFunction_GET_SELF( frame.pObj );
+					if ( pSelf && !PyModule_Check( pSelf ) )
+						strOwner = Py_TYPE( pSelf )->tp_name;
+					else
+						strOwner = getStr( frame.pObj, "__module__" );
+				}
+				else
+					strOwner = ( (PyMethodDescrObject *) frame.pObj )->d_common.d_type->tp_name;
+				strName = ( strOwner.empty() ? "" : strOwner + "." ) + pMethodDef->ml_name;
+			}
+		}
+
+		// Semicolons separate frames in collapsed stacks
+		std::replace( strName.begin(), strName.end(), ';', ',' );
+		return m_mapNames[frame.pKey] = strName;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "pyliaison.h"
+
+#include <thread>
+#include <unordered_map>
+
+namespace pyl
+{
+	/********************************************//*!
+	pyl::Profiler
+	\brief A sampling profiler for python code and the pyl bindings it calls
+
+	A background thread ticks at a fixed interval, and every tick is charged to
+	whatever the profiled thread was running when it elapsed. Python functions
+	show up by name, file and line, and calls into pyl bindings are tagged with
+	the binding's name (module.function or module.Class.method). If pyliaison is
+	built with PYL_PROFILE_CALLEES, time in bindings is also split into the time
+	spent converting arguments and return values and the time spent in the C++
+	callee itself (which costs every binding call a little, profiling or not.)
+
+	The results are written as collapsed stacks, one "frame;frame;frame count"
+	line per unique stack, which flamegraph.pl and speedscope can read directly.
+
+	Python profile hooks are per thread, so Start should be called from the thread
+	that will be running the code you want to profile (while holding the GIL.)
+	Only one profiler can run at a time.
+	***********************************************/
+	class Profiler
+	{
+	public:
+		Profiler();
+		~Profiler();
+		Profiler( const Profiler& ) = delete;
+		Profiler& operator=( const Profiler& ) = delete;
+
+		/*! Start
+		\brief Start sampling the calling thread
+
+		\param[in] nIntervalUs The sampling interval, in microseconds
+
+		Returns false if this or another profiler is already running*/
+		bool Start( int nIntervalUs = 1000 );
+
+		/*! Stop \brief Stop sampling, keeping the samples collected so far*/
+		void Stop();
+
+		/*! IsRunning \brief Whether this profiler is currently sampling*/
+		bool IsRunning() const;
+
+		/*! Clear \brief Throw away the samples collected so far*/
+		void Clear();
+
+		/*! GetCollapsedStacks \brief Get the samples in the collapsed stack format*/
+		std::string GetCollapsedStacks() const;
+
+		/*! WriteCollapsedStacks \brief Write the samples in the collapsed stack format to a file*/
+		bool WriteCollapsedStacks( std::string strFileName ) const;
+
+		/*! GetSampleCount \brief Get the total number of samples taken*/
+		uint64_t GetSampleCount() const;
+
+	private:
+		// What's running on the profiled thread, as we've seen it through profile events
+		struct Frame
+		{
+			const void * pKey;   /*!< Code object or PyMethodDef, used to cache the name*/
+			PyObject * pObj;     /*!< Borrowed code or function object, alive while it's on the stack*/
+			bool bCode;          /*!< Whether this is a python function (otherwise it's a C function)*/
+			bool bBinding;       /*!< Whether this is a pyl binding*/
+		};
+
+		std::vector<Frame> m_vStack;                                 /*!< Our shadow of the profiled thread's stack*/
+		std::unordered_map<const void *, std::string> m_mapNames;    /*!< Frame names, keyed by Frame::pKey*/
+		std::list<Object> m_liCodeRefs;                              /*!< Keeps named code objects from being reused*/
+		std::unordered_map<std::string, uint64_t> m_mapSamples;      /*!< Sample counts for each collapsed stack*/
+
+		std::thread m_thSampler;                                     /*!< Ticks at the sampling interval*/
+		std::atomic<bool> m_bRunning;                                /*!< Whether the sampler should keep ticking*/
+		std::atomic<uint64_t> m_uTicks;                              /*!< Ticks since we started*/
+		std::atomic<uint64_t> m_uCalleeTicks;                        /*!< Ticks that elapsed while in a C++ callee*/
+		uint64_t m_uSeenTicks;                                       /*!< Ticks that have been charged to a stack*/
+		uint64_t m_uSeenCalleeTicks;                                 /*!< Callee ticks that have been charged to a stack*/
+#ifdef PYL_PROFILE_CALLEES
+		std::atomic<int> * m_pCallee;                                /*!< The profiled thread's callee depth*/
+#endif
+
+		static int profileCallback( PyObject * pObj, PyFrameObject * pFrame, int nWhat, PyObject * pArg );
+		void pushFunction( PyObject * pFunc );
+		void pushCode( PyObject * pCode );
+		void sample( uint64_t uTicks, uint64_t uCalleeTicks );
+		const std::string& getName( const Frame& frame );
+	};
+}
@@ -0,0 +1,74 @@
+/*      This program is free software; you can redistribute it and/or modify
+*      it under the terms of the GNU General Public License as published by
+*      the Free Software Foundation; either version 3 of the License, or
+*      (at your option) any later version.
+*
+*      This program is distributed in the hope that it will be useful,
+*      but WITHOUT ANY WARRANTY; without even the implied warranty of
+*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*      GNU General Public License for more details.
+*
+*      You should have received a copy of the GNU General Public License
+*      along with this program; if not, write to the Free Software
+*      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+*      MA 02110-1301, USA.
+*
+*      Author:
+*      John Joseph
+*
+*/
+
+
+#include "pylRecord.h"
+
+#include <cctype>
+
+namespace pyl
+{
+	// The names come from stringifying the macro arguments, i.e "uID, dPrice, nQuantity"
+	std::vector<std::string> _split_field_names( const char * szNames )
+	{
+		std::vector<std::string> vNames( 1 );
+		for ( const char * pC = szNames; *pC; pC++ )
+		{
+			if ( *pC == ',' )
+				vNames.emplace_back();
+			else if ( !isspace( (unsigned char) *pC ) )
+				vNames.back().push_back( *pC );
+		}
+		return vNames;
+	}
+
+	_StructSequenceType::_StructSequenceType( const char * szName, const std::vector<std::string>& vFields ) :
+		m_strName( std::string( "pyl." ) + szName ),
+		m_pTypeObj( nullptr ),
+		m_uGeneration( 0 )
+	{
+		// The field names are static, so these pointers stay good
+		for ( const std::string& strField : vFields )
+			m_ntFields.push_back( { (char *) strField.c_str(), nullptr } );
+	}
+
+	PyTypeObject * _StructSequenceType::Get()
+	{
+		// A type made by an interpreter that's since been finalized is long gone
+		if ( m_pTypeObj && m_uGeneration == _interpreter_generation() )
+			return m_pTypeObj;
+
+		PyStructSequence_Desc desc;
+		desc.name = (char *) m_strName.c_str();
+		desc.doc = nullptr;
+		desc.fields = (PyStructSequence_Field *) m_ntFields.data();
+		desc.n_in_sequence = (int) m_ntFields.size();
+
+		// Our reference keeps the type around until the interpreter goes
+		m_pTypeObj = PyStructSequence_NewType( &desc );
+		if ( m_pTypeObj == nullptr )
+		{
+			PyErr_Clear();
+			throw runtime_error( "Error creating struct sequence type " + m_strName );
+		}
+		m_uGeneration = _interpreter_generation();
+		return m_pTypeObj;
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "pyliaison.h"
+
+#include <tuple>
+
+/*! PYL_RECORD
+\brief Describe the fields of a struct, so that pyl can work with it field by field
+
+Use this at global scope, listing every data member of the struct in the order they're
+declared, i.e PYL_RECORD( Trade, uID, dPrice, nQuantity ). The struct can't have base
+classes, and its members have to be public (they're unpacked with a structured binding.)*/
+#define PYL_RECORD( R, ... )                                                                    \
+	template <> struct pyl::record<R>                                                           \
+	{                                                                                           \
+		static constexpr bool value = true;                                                     \
+		static auto tie( R& _pyl_r ) { auto& [__VA_ARGS__] = _pyl_r; return std::tie( __VA_ARGS__ ); }             \
+		static auto tie( const R& _pyl_r ) { const auto& [__VA_ARGS__] = _pyl_r; return std::tie( __VA_ARGS__ ); } \
+		static const char * names() { return #__VA_ARGS__; }                                   \
+		static const char * type_name() { return #R; }                                          \
+	};
+
+/*! PYL_STRUCT
+\brief Describe a struct and make it convert to and from a python struct sequence
+
+Takes the same arguments as PYL_RECORD (which it includes). The struct becomes an
+instance of a struct sequence type named after it (a tuple whose items can also be
+read by name, like os.stat_result), and converts back from any tuple with one item
+per field, which includes named tuples. Use it in place of PYL_RECORD, not as well.*/
+#define PYL_STRUCT( S, ... )                                                                    \
+	PYL_RECORD( S, __VA_ARGS__ )                                                                \
+	template <> struct pyl::converter<S> : pyl::_struct_sequence<S> {};
+
+namespace pyl
+{
+	// Specialized by PYL_RECORD
+	template <typename R>
+	struct record
+	{
+		static constexpr bool value = false;
+	};
+
+	// Used internally to split the stringified field list of a record
+	std::vector<std::string> _split_field_names( const char * szNames );
+
+	/*! record_field_names \brief The names of a record's fields, in order*/
+	template <typename R>
+	const std::vector<std::string>& record_field_names()
+	{
+		static_assert( record<R>::value, "Describe the record with PYL_RECORD first" );
+		static const std::vector<std::string> s_vNames = _split_field_names( record<R>::names() );
+		return s_vNames;
+	}
+
+	// The number of fields in record R
+	template <typename R>
+	constexpr size_t _record_size()
+	{
+		return std::tuple_size<decltype( record<R>::tie( std::declval<R&>() ) )>::value;
+	}
+
+	// The type of field I of record R
+	template <size_t I, typename R>
+	using _record_field_t = typename std::decay<typename std::tuple_element<I, decltype( record<R>::tie( std::declval<R&>() ) )>::type>::type;
+
+	// The struct sequence type for a record, made once per interpreter
+	class _StructSequenceType
+	{
+		std::string m_strName;                                   /*!< The type's qualified name*/
+		std::basic_string<PyStructSequence_Field> m_ntFields;   /*!< Null terminated, python keeps pointers into this*/
+		PyTypeObject * m_pTypeObj;                               /*!< The type, owned by the interpreter it was made in*/
+		size_t m_uGeneration;                                    /*!< Which interpreter that was*/
+
+	public:
+		_StructSequenceType( const char * szName, const std::vector<std::string>& vFields );
+
+		// Get the type, making it if this interpreter doesn't have it yet. Throws if that fails
+		PyTypeObject * Get();
+	};
+
+	/*! struct_sequence_type \brief The python type a PYL_STRUCT struct converts to
+	Made the first time it's needed (in each interpreter), and never rebuilt after that*/
+	template <typename S>
+	PyTypeObject * struct_sequence_type()
+	{
+		static _StructSequenceType s_Type( record<S>::type_name(), record_field_names<S>() );
+		return s_Type.Get();
+	}
+
+	/********************************************//*!
+	pyl::_struct_sequence
+	\brief The pyl::converter specialization made by PYL_STRUCT
+	\tparam S A struct described with PYL_STRUCT
+
+	Both directions go straight to slots by index, with no lookups by name.
+	***********************************************/
+	template <typename S>
+	struct _struct_sequence
+	{
+		template <size_t I>
+		static bool _set_item( PyObject * pSeq, const S& val )
+		{
+			PyObject * pItem = alloc_pyobject( std::get<I>( record<S>::tie( val ) ) );
+			if ( pItem == nullptr )
+				return false;
+			PyStructSequence_SET_ITEM( pSeq, I, pItem );
+			return true;
+		}
+
+		template <size_t... Is>
+		static bool _set_items( PyObject * pSeq, const S& val, std::index_sequence<Is...> )
+		{
+			// Slots we don't get to stay null, which the struct sequence knows to skip
+			return ( _set_item<Is>( pSeq, val ) && ... );
+		}
+
+		template <size_t... Is>
+		static bool _get_items( PyObject * obj, S& val, std::index_sequence<Is...> )
+		{
+			return ( convert( PyTuple_GET_ITEM( obj, Is ), std::get<Is>( record<S>::tie( val ) ) ) && ... );
+		}
+
+		static bool from_python( PyObject * obj, S& val )
+		{
+			// Struct sequences and named tuples are both tuples underneath
+			if ( !PyTuple_Check( obj ) || PyTuple_GET_SIZE( obj ) != (Py_ssize_t) _record_size<S>() )
+				return false;
+			return _get_items( obj, val, std::make_index_sequence<_record_size<S>()>() );
+		}
+
+		static PyObject * to_python( const S& val )
+		{
+			unique_ptr upSeq( PyStructSequence_New( struct_sequence_type<S>() ) );
+			if ( !upSeq || !_set_items( upSeq.get(), val, std::make_index_sequence<_record_size<S>()>() ) )
+				return nullptr;
+			_tally_conversion( 1, 0 );
+			return upSeq.release();
+		}
+	};
+}
@@ -0,0 +1,198 @@
+/*      This program is free software; you can redistribute it and/or modify
+*      it under the terms of the GNU General Public License as published by
+*      the Free Software Foundation; either version 3 of the License, or
+*      (at your option) any later version.
+*
+*      This program is distributed in the hope that it will be useful,
+*      but WITHOUT ANY WARRANTY; without even the implied warranty of
+*      MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*      GNU General Public License for more details.
+*
+*      You should have received a copy of the GNU General Public License
+*      along with this program; if not, write to the Free Software
+*      Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+*      MA 02110-1301, USA.
+*
+*      Author:
+*      John Joseph
+*
+*/
+
+
+#include "pylScriptWatcher.h"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <climits>
+#endif
+
+namespace pyl
+{
+	// Get the directory part of a resolved path
+	static std::string _get_dir( const std::string& strPath )
+	{
+		size_t last_slash( strPath.rfind( '/' ) );
+		return last_slash == std::string::npos ? "." : strPath.substr( 0, last_slash );
+	}
+
+	std::shared_ptr<Object> ScriptWatcher::Script::GetModule() const
+	{
+		return std::atomic_load( &m_spModule );
+	}
+
+	const std::string& ScriptWatcher::Script::GetPath() const
+	{
+		return m_strPath;
+	}
+
+#ifdef __linux__
+
+	ScriptWatcher::ScriptWatcher() :
+		m_fdNotify( inotify_init1( IN_NONBLOCK | IN_CLOEXEC ) )
+	{
+		if ( m_fdNotify < 0 )
+			throw pyl::runtime_error( "Error creating inotify instance for script watcher" );
+	}
+
+	ScriptWatcher::~ScriptWatcher()
+	{
+		close( m_fdNotify );
+	}
+
+	ScriptWatcher::ScriptPtr ScriptWatcher::Watch( std::string strScript )
+	{
+		// Load the script (this may throw), then see if we've already got it
+		Object obModule( strScript );
+		std::string strPath = _resolve_script_path( strScript );
+		auto itScript = m_mapScripts.find( strPath );
+		if ( itScript != m_mapScripts.end() )
+			return itScript->second;
+
+		// We watch the script's directory rather than the file itself,
+		// because most editors save by replacing the file
+		std::string strDir = _get_dir( strPath );
+		int wd = inotify_add_watch( m_fdNotify, strDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ATTRIB );
+		if ( wd < 0 )
+			throw pyl::runtime_error( "Error watching script directory " + strDir );
+		m_mapWatchDirs[wd] = strDir;
+
+		ScriptPtr spScript = std::make_shared<Script>();
+		spScript->m_strPath = strPath;
+		spScript->m_spModule = std::make_shared<Object>( std::move( obModule ) );
+		m_mapScripts[strPath] = spScript;
+		return spScript;
+	}
+
+	bool ScriptWatcher::Unwatch( const ScriptPtr& spScript )
+	{
+		if ( !spScript || m_mapScripts.erase( spScript->m_strPath ) == 0 )
+			return false;
+
+		// Stop watching the directory if nothing else lives there
+		std::string strDir = _get_dir( spScript->m_strPath );
+		for ( const auto& itScript : m_mapScripts )
+			if ( _get_dir( itScript.first ) == strDir )
+				return true;
+
+		unwatchDir( strDir );
+		return true;
+	}
+
+	void ScriptWatcher::unwatchDir( const std::string& strDir )
+	{
+		for ( auto itDir = m_mapWatchDirs.begin(); itDir != m_mapWatchDirs.end(); ++itDir )
+		{
+			if ( itDir->second == strDir )
+			{
+				inotify_rm_watch( m_fdNotify, itDir->first );
+				m_mapWatchDirs.erase( itDir );
+				return;
+			}
+		}
+	}
+
+	int ScriptWatcher::Update()
+	{
+		// Drain every pending event, collecting the scripts that changed
+		std::set<std::string> setChanged;
+		alignas( struct inotify_event ) char buf[4096];
+		for ( ssize_t len = read( m_fdNotify, buf, sizeof( buf ) ); len > 0; len = read( m_fdNotify, buf, sizeof( buf ) ) )
+		{
+			for ( char * pEvent = buf; pEvent < buf + len; )
+			{
+				const struct inotify_event * pNotify = (const struct inotify_event *) pEvent;
+				pEvent += sizeof( struct inotify_event ) + pNotify->len;
+
+				auto itDir = m_mapWatchDirs.find( pNotify->wd );
+				if ( itDir == m_mapWatchDirs.end() || pNotify->len == 0 )
+					continue;
+
+				std::string strPath = itDir->second + '/' + pNotify->name;
+				if ( m_mapScripts.count( strPath ) )
+					setChanged.insert( strPath );
+			}
+		}
+
+		// Reload each of them once, swapping in the new module
+		int nReloaded( 0 );
+		for ( const std::string& strPath : setChanged )
+		{
+			Object obModule;
+			if ( _refresh_script( strPath, obModule ) )
+			{
+				std::atomic_store( &m_mapScripts[strPath]->m_spModule, std::make_shared<Object>( std::move( obModule ) ) );
+				++nReloaded;
+			}
+		}
+
+		return nReloaded;
+	}
+
+#else
+
+	// Without inotify we just look at every script's modification time
+
+	ScriptWatcher::ScriptWatcher() {}
+
+	ScriptWatcher::~ScriptWatcher() {}
+
+	ScriptWatcher::ScriptPtr ScriptWatcher::Watch( std::string strScript )
+	{
+		Object obModule( strScript );
+		std::string strPath = _resolve_script_path( strScript );
+		auto itScript = m_mapScripts.find( strPath );
+		if ( itScript != m_mapScripts.end() )
+			return itScript->second;
+
+		ScriptPtr spScript = std::make_shared<Script>();
+		spScript->m_strPath = strPath;
+		spScript->m_spModule = std::make_shared<Object>( std::move( obModule ) );
+		m_mapScripts[strPath] = spScript;
+		return spScript;
+	}
+
+	bool ScriptWatcher::Unwatch( const ScriptPtr& spScript )
+	{
+		return spScript && m_mapScripts.erase( spScript->m_strPath ) > 0;
+	}
+
+	int ScriptWatcher::Update()
+	{
+		int nReloaded( 0 );
+		for ( auto& itScript : m_mapScripts )
+		{
+			Object obModule;
+			if ( _refresh_script( itScript.first, obModule ) )
+			{
+				std::atomic_store( &itScript.second->m_spModule, std::make_shared<Object>( std::move( obModule ) ) );
+				++nReloaded;
+			}
+		}
+
+		return nReloaded;
+	}
+
+#endif // __linux__
+}
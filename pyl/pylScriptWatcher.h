@@ -0,0 +1,75 @@
+#pragma once
+
+#include "pyliaison.h"
+
+namespace pyl
+{
+	/********************************************//*!
+	pyl::ScriptWatcher
+	\brief Reloads scripts loaded via pyl::Object when their files change
+
+	Scripts are watched with inotify on Linux (elsewhere their modification
+	times are checked) and any that have changed are reloaded via importlib.reload
+	when Update is called. Changes are batched per call to Update, so a burst
+	of saves between two calls causes a single reload. Like the rest of pyl,
+	this should be driven from the thread that owns the interpreter.
+	***********************************************/
+	class ScriptWatcher
+	{
+	public:
+		/*! Script
+		\brief A watched script
+
+		The module held by a script is swapped atomically when the script is reloaded,
+		so hold on to the Script and get its module when you need it rather than
+		holding on to the module itself.*/
+		class Script
+		{
+			friend class ScriptWatcher;
+			std::string m_strPath;              /*!< Resolved path to the script file*/
+			std::shared_ptr<Object> m_spModule; /*!< The current script module*/
+
+		public:
+			/*! GetModule \brief Get the current script module*/
+			std::shared_ptr<Object> GetModule() const;
+
+			/*! GetPath \brief Get the resolved path to the script file*/
+			const std::string& GetPath() const;
+		};
+		using ScriptPtr = std::shared_ptr<Script>;
+
+		ScriptWatcher();
+		~ScriptWatcher();
+		ScriptWatcher( const ScriptWatcher& ) = delete;
+		ScriptWatcher& operator=( const ScriptWatcher& ) = delete;
+
+		/*! Watch
+		\brief Load a script and start watching it for changes
+
+		\param[in] strScript The path to the script, as you'd give to pyl::Object (with or without ".py")
+		\param[out] spScript The watched script (the same one if it's already being watched)
+
+		Throws a pyl::runtime_error if the script can't be loaded*/
+		ScriptPtr Watch( std::string strScript );
+
+		/*! Unwatch \brief Stop watching a script, returns false if it wasn't being watched*/
+		bool Unwatch( const ScriptPtr& spScript );
+
+		/*! Update
+		\brief Reload any scripts that have changed since the last update
+
+		\param[out] nReloaded The number of scripts that were reloaded
+
+		Call this once per tick; each changed script is reloaded once no matter
+		how many times it was saved since the last call*/
+		int Update();
+
+	private:
+		std::map<std::string, ScriptPtr> m_mapScripts; /*!< Watched scripts keyed by resolved path*/
+#ifdef __linux__
+		int m_fdNotify;                                /*!< The inotify instance*/
+		std::map<int, std::string> m_mapWatchDirs;     /*!< Watched directories keyed by watch descriptor*/
+		void unwatchDir( const std::string& strDir );
+#endif
+	};
+}
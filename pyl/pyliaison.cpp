@@ -19,7 +19,21 @@
 */
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+
+#include <sys/stat.h>
+
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
 
 #include <Python.h>
 #include <structmember.h>
@@ -30,19 +44,57 @@ namespace pyl
 {
 	// ----------------- Engine -----------------
 
+#ifdef PYL_CALL_STATS
+	// Defined with the call statistics below
+	static PyObject * _init_pyl_stats_module();
+#endif
+
+	// Defined with pyl::Object below, released on finalize
+	static void _clear_script_cache();
+	static void _clear_module_cache();
+
 	static bool _s_bIsInitialized = false;
+	static size_t _s_uInterpreterGeneration = 0;
 	void initialize()
+	{
+		initialize( InitOptions() );
+	}
+
+	void initialize( const InitOptions& options )
 	{
 		if ( _s_bIsInitialized == false )
 		{
 			// Finalize any previous stuff
 			finalize();
 
+			// Our allocator has to go in before python allocates anything, so
+			// it can only be installed before the first interpreter is started
+			static bool s_bStartedOnce = false;
+			if ( options.bPoolAllocator || options.uMemoryCap )
+			{
+				if ( !_is_allocator_installed() && ( s_bStartedOnce || !_install_allocator() ) )
+					throw runtime_error( "Error installing allocator, it must be requested before the interpreter is first started" );
+			}
+			_configure_allocator( options.bPoolAllocator, options.uMemoryCap );
+			s_bStartedOnce = true;
+
 			ModuleDef::InitAllModules();
 
-			// Startup python
+#ifdef PYL_CALL_STATS
+			// Call statistics can be read from python via pyl_stats
+			// (the inittab outlives the interpreter, so only add it once)
+			static bool s_bStatsModuleAdded = false;
+			if ( !s_bStatsModuleAdded )
+				s_bStatsModuleAdded = PyImport_AppendInittab( "pyl_stats", _init_pyl_stats_module ) == 0;
+#endif
+
+			// Startup python (anything made from here on belongs to the new interpreter)
+			_s_uInterpreterGeneration++;
 			Py_Initialize();
 			_s_bIsInitialized = true;
+
+			// Modules created from here on out are imported via our finder
+			ModuleDef::InstallModuleFinder();
 		}
 	}
 
@@ -50,6 +102,10 @@ namespace pyl
 	{
 		if ( _s_bIsInitialized )
 		{
+			// Drop any module references we're holding on to
+			_clear_script_cache();
+			_clear_module_cache();
+
 			Py_Finalize();
 			_s_bIsInitialized = false;
 		}
@@ -60,6 +116,11 @@ namespace pyl
 		return _s_bIsInitialized;
 	}
 
+	size_t _interpreter_generation()
+	{
+		return _s_uInterpreterGeneration;
+	}
+
 
 	// ----------------- Utility -----------------
 
@@ -114,470 +175,1556 @@ namespace pyl
 		return ret;
 	}
 
-	bool is_py_int(PyObject *obj)
+	// ----------------- Call statistics -----------------
+
+	// Call counters are kept per thread, so recording a call never contends with another thread.
+	// Each thread only ever writes to its own counters; the atomics let us read them from elsewhere
+	struct _CallCounters
 	{
-		return PyLong_Check(obj);
-	}
+		std::atomic<uint64_t> uCalls { 0 };
+		std::atomic<uint64_t> uTotalNs { 0 };
+		std::array<std::atomic<uint64_t>, 32> arLatency {};
+	};
 
-	bool is_py_float(PyObject *obj)
+	struct _ThreadCallCounters
 	{
-		return PyFloat_Check(obj);
-	}
+		std::deque<_CallCounters> dqCounters; /*!< Indexed by call ID, grows on demand*/
+		_ThreadCallCounters();
+		~_ThreadCallCounters();
+	};
 
-	void _add_tuple_var(PyObject * pTup, Py_ssize_t i, PyObject *pobj)
+	// Guards everything but the counters themselves, which only their thread writes to
+	static std::mutex _s_muCallStats;
+	static std::vector<std::string> _s_vCallNames;        /*!< Name of each call ID*/
+	static std::set<_ThreadCallCounters *> _s_setThreads; /*!< Counters of live threads*/
+	static std::vector<CallStats> _s_vCallTotals;         /*!< Totals from threads that have exited*/
+	static std::vector<CallStats> _s_vCallBaseline;       /*!< Totals when stats were last reset*/
+
+	static thread_local _ThreadCallCounters _s_tlCallCounters;
+
+	_ThreadCallCounters::_ThreadCallCounters()
 	{
-		PyTuple_SetItem(pTup, i, pobj);
+		std::lock_guard<std::mutex> lg( _s_muCallStats );
+		_s_setThreads.insert( this );
 	}
 
-	void _add_tuple_vars(PyObject * pTup, PyObject *arg)
+	// Fold our counts into the totals on the way out
+	_ThreadCallCounters::~_ThreadCallCounters()
 	{
-		_add_tuple_var(pTup, PyTuple_Size(pTup) - 1, arg);
+		std::lock_guard<std::mutex> lg( _s_muCallStats );
+		_s_setThreads.erase( this );
+		for ( size_t uID = 0; uID < dqCounters.size() && uID < _s_vCallTotals.size(); uID++ )
+		{
+			const _CallCounters& counters = dqCounters[uID];
+			CallStats& total = _s_vCallTotals[uID];
+			total.uCalls += counters.uCalls.load( std::memory_order_relaxed );
+			total.uTotalNs += counters.uTotalNs.load( std::memory_order_relaxed );
+			for ( size_t b = 0; b < total.arLatency.size(); b++ )
+				total.arLatency[b] += counters.arLatency[b].load( std::memory_order_relaxed );
+		}
 	}
 
-	// ------------ Conversion functions ------------
+	// Only the owning thread writes, so there's no need for an atomic increment
+	static inline void _bump( std::atomic<uint64_t>& counter, uint64_t uAmount )
+	{
+		counter.store( counter.load( std::memory_order_relaxed ) + uAmount, std::memory_order_relaxed );
+	}
 
-	bool convert( PyObject *obj, std::string &val )
+	static void _record_call( size_t uID, uint64_t uNs )
 	{
-		// if bytes or bytearray to PyBytes_AsString
-		if ( PyBytes_Check( obj ) )
-		{
-			val = PyBytes_AsString( obj );
-			return true;
-		}
-		else if ( PyByteArray_Check( obj ) )
+		std::deque<_CallCounters>& dqCounters = _s_tlCallCounters.dqCounters;
+		if ( uID >= dqCounters.size() )
 		{
-			val = PyBytes_AsString( obj );
-			return true;
-		}
-		// We can do a unicode conversion as well
-		else if ( PyUnicode_Check( obj ) )
-		{
-			val = PyUnicode_AsUTF8( obj );
-			return true;
+			std::lock_guard<std::mutex> lg( _s_muCallStats );
+			while ( uID >= dqCounters.size() )
+				dqCounters.emplace_back();
 		}
-		return false;
+
+		// Bucket by the highest set bit
+		size_t uBucket( 0 );
+		for ( uint64_t uRem = uNs >> 1; uRem && uBucket < 31; uRem >>= 1 )
+			uBucket++;
+
+		_CallCounters& counters = dqCounters[uID];
+		_bump( counters.uCalls, 1 );
+		_bump( counters.uTotalNs, uNs );
+		_bump( counters.arLatency[uBucket], 1 );
 	}
 
-	bool convert( PyObject *obj, std::wstring &val )
+	_PyFunc _instrument_call( _PyFunc pFn, std::string strName )
 	{
-		if ( PyUnicode_Check( obj ) )
+		size_t uID( 0 );
 		{
-			Py_ssize_t size( 0 );
-			val = PyUnicode_AsWideCharString( obj, &size );
-			return true;
+			std::lock_guard<std::mutex> lg( _s_muCallStats );
+			uID = _s_vCallNames.size();
+			_s_vCallNames.push_back( strName );
+			_s_vCallTotals.push_back( { strName, 0, 0, {} } );
+			_s_vCallBaseline.push_back( { strName, 0, 0, {} } );
 		}
-		// If a bytes string, decode to utf16 and recurse, free our utf python string
-		else if ( PyBytes_Check( obj ) || PyByteArray_Check( obj ) )
+
+		return [pFn, uID]( PyObject * s, PyObject * a )
 		{
-			PyObject * unicodeString = PyUnicode_Decode( PyBytes_AsString( obj ), PyBytes_Size( obj ), "utf8", nullptr );
-			bool bRet = convert( unicodeString, val );
-			Py_XDECREF( unicodeString );
-			return bRet;
-		}
-		return false;
+			auto tStart = std::chrono::steady_clock::now();
+			PyObject * pRet = pFn( s, a );
+			auto tElapsed = std::chrono::steady_clock::now() - tStart;
+			_record_call( uID, (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>( tElapsed ).count() );
+			return pRet;
+		};
 	}
 
-	bool convert( PyObject *obj, std::vector<char> &val )
+	// Sum the counters of every thread (must hold _s_muCallStats)
+	static std::vector<CallStats> _sum_call_stats()
 	{
-		if ( PyBytes_Check( obj ) )
+		std::vector<CallStats> vStats = _s_vCallTotals;
+		for ( const _ThreadCallCounters * pThread : _s_setThreads )
 		{
-			val.resize( PyBytes_Size( obj ) );
-			memcpy( val.data(), PyBytes_AsString( obj ), val.size() );
-			return true;
+			for ( size_t uID = 0; uID < pThread->dqCounters.size() && uID < vStats.size(); uID++ )
+			{
+				const _CallCounters& counters = pThread->dqCounters[uID];
+				vStats[uID].uCalls += counters.uCalls.load( std::memory_order_relaxed );
+				vStats[uID].uTotalNs += counters.uTotalNs.load( std::memory_order_relaxed );
+				for ( size_t b = 0; b < counters.arLatency.size(); b++ )
+					vStats[uID].arLatency[b] += counters.arLatency[b].load( std::memory_order_relaxed );
+			}
 		}
-		else if ( PyByteArray_Check( obj ) )
+		return vStats;
+	}
+
+	std::vector<CallStats> get_call_stats()
+	{
+		std::lock_guard<std::mutex> lg( _s_muCallStats );
+		std::vector<CallStats> vStats = _sum_call_stats();
+		for ( size_t uID = 0; uID < vStats.size(); uID++ )
 		{
-			val.resize( PyByteArray_Size( obj ) );
-			memcpy( val.data(), PyByteArray_AsString( obj ), val.size() );
-			return true;
+			const CallStats& base = _s_vCallBaseline[uID];
+			vStats[uID].uCalls -= base.uCalls;
+			vStats[uID].uTotalNs -= base.uTotalNs;
+			for ( size_t b = 0; b < base.arLatency.size(); b++ )
+				vStats[uID].arLatency[b] -= base.arLatency[b];
 		}
-		return false;
+		return vStats;
 	}
 
-	bool convert( PyObject *obj, bool &value )
+	// Rather than zero counters that other threads are writing to, remember where we are now
+	void reset_call_stats()
 	{
-		if ( obj == Py_False )
-			value = false;
-		else if ( obj == Py_True )
-			value = true;
-		else
-			return false;
-		return true;
+		std::lock_guard<std::mutex> lg( _s_muCallStats );
+		_s_vCallBaseline = _sum_call_stats();
 	}
 
-	// These single character conversions aren't the most
-	// efficient, but I don't think they come up often
-	// Convert to string and get first character
-	bool convert( PyObject *obj, char &value )
+#ifdef PYL_CALL_STATS
+	// pyl_stats.snapshot() returns { name : { 'calls' : n, 'total_ns' : t, 'latency' : [...] } }
+	static PyObject * _pyl_stats_snapshot( PyObject *, PyObject * )
 	{
-		std::string strContainer;
-		if ( convert( obj, strContainer ) )
+		unique_ptr upDict( PyDict_New() );
+		if ( !upDict )
+			return nullptr;
+
+		for ( const CallStats& stats : get_call_stats() )
 		{
-			value = strContainer[0];
-			return true;
+			unique_ptr upLatency( PyList_New( stats.arLatency.size() ) );
+			if ( !upLatency )
+				return nullptr;
+			for ( size_t b = 0; b < stats.arLatency.size(); b++ )
+				PyList_SET_ITEM( upLatency.get(), b, PyLong_FromUnsignedLongLong( stats.arLatency[b] ) );
+
+			unique_ptr upStats( Py_BuildValue( "{s:K,s:K,s:O}", "calls", stats.uCalls, "total_ns", stats.uTotalNs, "latency", upLatency.get() ) );
+			if ( !upStats || PyDict_SetItemString( upDict.get(), stats.strName.c_str(), upStats.get() ) < 0 )
+				return nullptr;
 		}
-		return false;
+
+		return upDict.release();
 	}
-	bool convert( PyObject *obj, wchar_t &value )
+
+	static PyObject * _pyl_stats_reset( PyObject *, PyObject * )
 	{
-		std::wstring strContainer;
-		if ( convert( obj, strContainer ) )
+		reset_call_stats();
+		Py_INCREF( Py_None );
+		return Py_None;
+	}
+
+	static PyObject * _init_pyl_stats_module()
+	{
+		static PyMethodDef s_arMethods[] = {
+			{ "snapshot", _pyl_stats_snapshot, METH_NOARGS, "Get the call statistics of every exposed function" },
+			{ "reset", _pyl_stats_reset, METH_NOARGS, "Start collecting call statistics from scratch" },
+			{ nullptr, nullptr, 0, nullptr }
+		};
+		static PyModuleDef s_ModDef = {
+			PyModuleDef_HEAD_INIT, "pyl_stats", "Call statistics of functions exposed by pyliaison", -1, s_arMethods,
+			nullptr, nullptr, nullptr, nullptr
+		};
+		return PyModule_Create( &s_ModDef );
+	}
+#endif // PYL_CALL_STATS
+
+	// ----------------- Binding registry -----------------
+
+#ifdef PYL_PROFILE_CALLEES
+	std::atomic<bool> _g_bProfiling( false );
+	thread_local std::atomic<int> _t_nProfileCallee( 0 );
+#endif
+
+	// Bindings are registered as modules are declared, before the profiler can look at them
+	static std::unordered_map<PyCFunction, std::string> _s_mapBindingNames;
+
+	void _register_binding( PyCFunction fnPtr, const std::string& strName )
+	{
+		_s_mapBindingNames[fnPtr] = strName;
+	}
+
+	const std::string * _get_binding_name( PyCFunction fnPtr )
+	{
+		auto it = _s_mapBindingNames.find( fnPtr );
+		return it == _s_mapBindingNames.end() ? nullptr : &it->second;
+	}
+
+	// ----------------- Conversion statistics -----------------
+
+#ifdef PYL_CONVERSION_STATS
+
+	thread_local _ConversionTally _t_ConversionTally { 0, 0, 0 };
+
+	// Like call counters, these are per thread and only written by their thread
+	struct _ConversionCounters
+	{
+		std::atomic<uint64_t> uCalls { 0 };
+		std::atomic<uint64_t> uObjects { 0 };
+		std::atomic<uint64_t> uBytes { 0 };
+		std::atomic<uint64_t> uTotalNs { 0 };
+	};
+
+	struct _ThreadConversionCounters
+	{
+		std::deque<_ConversionCounters> dqCounters; /*!< Indexed by conversion ID, grows on demand*/
+		_ThreadConversionCounters();
+		~_ThreadConversionCounters();
+	};
+
+	// Guards everything but the counters themselves
+	static std::mutex _s_muConversionStats;
+	static std::vector<ConversionStat> _s_vConversionTotals;   /*!< Named by ID, with totals from threads that have exited*/
+	static std::vector<ConversionStat> _s_vConversionBaseline; /*!< Totals when stats were last reset*/
+	static std::set<_ThreadConversionCounters *> _s_setConversionThreads;
+
+	static thread_local _ThreadConversionCounters _s_tlConversionCounters;
+
+	static void _add_conversion_counters( ConversionStat& stat, const _ConversionCounters& counters )
+	{
+		stat.uCalls += counters.uCalls.load( std::memory_order_relaxed );
+		stat.uObjects += counters.uObjects.load( std::memory_order_relaxed );
+		stat.uBytes += counters.uBytes.load( std::memory_order_relaxed );
+		stat.uTotalNs += counters.uTotalNs.load( std::memory_order_relaxed );
+	}
+
+	static void _subtract_conversion_stats( std::vector<ConversionStat>& vStats, const std::vector<ConversionStat>& vBase )
+	{
+		for ( size_t uID = 0; uID < vStats.size() && uID < vBase.size(); uID++ )
 		{
-			value = strContainer[0];
-			return true;
+			vStats[uID].uCalls -= vBase[uID].uCalls;
+			vStats[uID].uObjects -= vBase[uID].uObjects;
+			vStats[uID].uBytes -= vBase[uID].uBytes;
+			vStats[uID].uTotalNs -= vBase[uID].uTotalNs;
 		}
-		return false;
 	}
 
-	bool convert( PyObject *obj, double &val )
+	// Leave out the types that haven't been converted
+	static std::vector<ConversionStat> _used_conversion_stats( std::vector<ConversionStat> vStats )
+	{
+		vStats.erase( std::remove_if( vStats.begin(), vStats.end(), []( const ConversionStat& stat ) { return stat.uCalls == 0; } ), vStats.end() );
+		return vStats;
+	}
+
+	_ThreadConversionCounters::_ThreadConversionCounters()
+	{
+		std::lock_guard<std::mutex> lg( _s_muConversionStats );
+		_s_setConversionThreads.insert( this );
+	}
+
+	_ThreadConversionCounters::~_ThreadConversionCounters()
 	{
-		return _generic_convert<double>( obj, is_py_float, PyFloat_AsDouble, val );
+		std::lock_guard<std::mutex> lg( _s_muConversionStats );
+		_s_setConversionThreads.erase( this );
+		for ( size_t uID = 0; uID < dqCounters.size() && uID < _s_vConversionTotals.size(); uID++ )
+			_add_conversion_counters( _s_vConversionTotals[uID], dqCounters[uID] );
 	}
 
-	// There are no 32 bit floats in python, so
-	// try converting from either double or int
-	bool convert( PyObject *obj, float &val )
+	// Demangled names spell out every default template argument,
+	// which makes something like a std::map<int, std::string> hard to read
+	static std::string _tidy_type_name( std::string strType )
 	{
-		double d( 0 );
-		if ( convert( obj, d ) )
+		for ( const std::string strString : { "std::__cxx11::basic_string<char, std::char_traits<char>, std::allocator<char> >",
+											  "std::basic_string<char, std::char_traits<char>, std::allocator<char> >" } )
 		{
-			val = (float) d;
-			return true;
+			for ( size_t uPos = strType.find( strString ); uPos != std::string::npos; uPos = strType.find( strString ) )
+				strType.replace( uPos, strString.size(), "std::string" );
 		}
-		int i( 0 );
-		if ( convert( obj, i ) )
+
+		for ( const std::string strDefault : { ", std::allocator<", ", std::less<", ", std::hash<", ", std::equal_to<", ", std::char_traits<" } )
 		{
-			val = (float) i;
-			return true;
+			for ( size_t uPos = strType.find( strDefault ); uPos != std::string::npos; uPos = strType.find( strDefault ) )
+			{
+				// Find the matching close bracket
+				size_t uEnd = uPos + strDefault.size();
+				for ( int nDepth = 1; uEnd < strType.size() && nDepth > 0; uEnd++ )
+					nDepth += strType[uEnd] == '<' ? 1 : strType[uEnd] == '>' ? -1 : 0;
+				strType.erase( uPos, uEnd - uPos );
+
+				// Lose the space between what were nested closing brackets
+				if ( strType.compare( uPos, 2, " >" ) == 0 )
+					strType.erase( uPos, 1 );
+			}
 		}
-		return false;
+
+		return strType;
 	}
 
-	// Convert some python object to a pyl::Object
-	// If the client knows what to do, let 'em deal with it
-	bool convert(PyObject * obj, pyl::Object& pyObj)
+	size_t _register_conversion( const std::type_info& tiType, bool bAlloc )
 	{
-		pyObj = pyl::Object(obj);
-		// I noticed that the incref is needed... not sure why?
-		if (PyObject * pObj = pyObj.get())
+		std::string strType = tiType.name();
+#ifdef __GNUG__
+		int nStatus( 0 );
+		if ( char * szDemangled = abi::__cxa_demangle( tiType.name(), nullptr, nullptr, &nStatus ) )
 		{
-			Py_INCREF(pObj);
-			return true;
+			strType = _tidy_type_name( szDemangled );
+			free( szDemangled );
 		}
-		return false;
+#endif
+
+		std::lock_guard<std::mutex> lg( _s_muConversionStats );
+		_s_vConversionTotals.push_back( { strType, bAlloc, 0, 0, 0, 0 } );
+		_s_vConversionBaseline.push_back( { strType, bAlloc, 0, 0, 0, 0 } );
+		return _s_vConversionTotals.size() - 1;
 	}
 
-	// ------------------ PyObject allocators --------------------
+	// Only the outermost scope on a thread counts anything
+	_ConversionScope::_ConversionScope( size_t uID ) :
+		uID( uID )
+	{
+		if ( _t_ConversionTally.nDepth++ == 0 )
+		{
+			uObjects = _t_ConversionTally.uObjects;
+			uBytes = _t_ConversionTally.uBytes;
+			tStart = std::chrono::steady_clock::now();
+		}
+	}
 
-	PyObject *alloc_pyobject( const std::string &str )
+	_ConversionScope::~_ConversionScope()
 	{
-		return PyBytes_FromString( str.c_str() );
+		if ( --_t_ConversionTally.nDepth > 0 )
+			return;
+
+		auto tElapsed = std::chrono::steady_clock::now() - tStart;
+
+		std::deque<_ConversionCounters>& dqCounters = _s_tlConversionCounters.dqCounters;
+		if ( uID >= dqCounters.size() )
+		{
+			std::lock_guard<std::mutex> lg( _s_muConversionStats );
+			while ( uID >= dqCounters.size() )
+				dqCounters.emplace_back();
+		}
+
+		// Only this thread writes these, so there's no need for an atomic increment
+		auto bump = []( std::atomic<uint64_t>& counter, uint64_t uAmount )
+		{
+			counter.store( counter.load( std::memory_order_relaxed ) + uAmount, std::memory_order_relaxed );
+		};
+		_ConversionCounters& counters = dqCounters[uID];
+		bump( counters.uCalls, 1 );
+		bump( counters.uObjects, _t_ConversionTally.uObjects - uObjects );
+		bump( counters.uBytes, _t_ConversionTally.uBytes - uBytes );
+		bump( counters.uTotalNs, (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>( tElapsed ).count() );
 	}
 
-	PyObject *alloc_pyobject( const std::vector<char> &val, size_t sz )
+	// Sum the counters of every thread (must hold _s_muConversionStats)
+	static std::vector<ConversionStat> _sum_conversion_stats()
 	{
-		return PyByteArray_FromStringAndSize( val.data(), sz );
+		std::vector<ConversionStat> vStats = _s_vConversionTotals;
+		for ( const _ThreadConversionCounters * pThread : _s_setConversionThreads )
+			for ( size_t uID = 0; uID < pThread->dqCounters.size() && uID < vStats.size(); uID++ )
+				_add_conversion_counters( vStats[uID], pThread->dqCounters[uID] );
+		return vStats;
 	}
 
-	PyObject *alloc_pyobject( const std::vector<char> &val )
+	// Get the counters of the calling thread
+	static std::vector<ConversionStat> _thread_conversion_stats()
 	{
-		return alloc_pyobject( val, val.size() );
+		std::lock_guard<std::mutex> lg( _s_muConversionStats );
+		std::vector<ConversionStat> vStats = _s_vConversionTotals;
+		for ( ConversionStat& stat : vStats )
+			stat.uCalls = stat.uObjects = stat.uBytes = stat.uTotalNs = 0;
+		const std::deque<_ConversionCounters>& dqCounters = _s_tlConversionCounters.dqCounters;
+		for ( size_t uID = 0; uID < dqCounters.size() && uID < vStats.size(); uID++ )
+			_add_conversion_counters( vStats[uID], dqCounters[uID] );
+		return vStats;
 	}
 
-	PyObject *alloc_pyobject( const char *cstr )
+	std::vector<ConversionStat> get_conversion_stats()
 	{
-		return PyBytes_FromString( cstr );
+		std::lock_guard<std::mutex> lg( _s_muConversionStats );
+		std::vector<ConversionStat> vStats = _sum_conversion_stats();
+		_subtract_conversion_stats( vStats, _s_vConversionBaseline );
+		return _used_conversion_stats( vStats );
 	}
 
-	PyObject *alloc_pyobject( const char c )
+	void reset_conversion_stats()
 	{
-		return PyBytes_FromFormat( "%c", c );
+		std::lock_guard<std::mutex> lg( _s_muConversionStats );
+		_s_vConversionBaseline = _sum_conversion_stats();
 	}
 
-	PyObject *alloc_pyobject( bool value )
+	ConversionStats::ConversionStats() :
+		m_vStart( _thread_conversion_stats() )
+	{}
+
+	std::vector<ConversionStat> ConversionStats::Get() const
 	{
-		return PyBool_FromLong( value );
+		std::vector<ConversionStat> vStats = _thread_conversion_stats();
+		_subtract_conversion_stats( vStats, m_vStart );
+		return _used_conversion_stats( vStats );
 	}
 
-	PyObject *alloc_pyobject( double num )
+#else
+
+	std::vector<ConversionStat> get_conversion_stats()
 	{
-		return PyFloat_FromDouble( num );
+		return {};
 	}
 
-	PyObject *alloc_pyobject( float num )
+	void reset_conversion_stats()
 	{
-		return PyFloat_FromDouble((double)num);
 	}
 
-	// -------------- Generic Py Class stuff ----------------
+	ConversionStats::ConversionStats()
+	{}
 
-	const /*static*/ char * _GenericPyClass::c_ptr_name = "c_ptr";
-	int _GenericPyClass::SetCapsuleAttr( PyObject * pCapsule )
+	std::vector<ConversionStat> ConversionStats::Get() const
 	{
-		return PyObject_SetAttrString( ( PyObject * )this, _GenericPyClass::c_ptr_name, pCapsule );
+		return {};
 	}
-	
-	// -------------- Exposed Class Definition ----------------
 
-	_ExposedClassDef::_ExposedClassDef()
+#endif
+
+	bool is_py_int(PyObject *obj)
 	{
-		// See unprepare, but this just resets the type object
-		UnPrepare();
+		return PyLong_Check(obj);
 	}
 
-
-	// Constructor for exposed classes, sets up type object
-	_ExposedClassDef::_ExposedClassDef( std::string strClassName ) :
-		_ExposedClassDef()
+	bool is_py_float(PyObject *obj)
 	{
-		m_strClassName = strClassName;
+		return PyFloat_Check(obj);
 	}
 
-	// Prepare the exposed class definition
-	// This must take place when the _ExposedClassDef will no longer move in memory
-	void _ExposedClassDef::Prepare()
+	void _add_tuple_var(PyObject * pTup, Py_ssize_t i, PyObject *pobj)
 	{
-		// Add a member called c_ptr 
-		AddMember( _GenericPyClass::c_ptr_name, T_OBJECT_EX, offsetof( _GenericPyClass, pCapsule ), 0, "pointer to the underlying c object" );
+		PyTuple_SetItem(pTup, i, pobj);
+	}
 
-		// Assigning pointers (this is why the memory can't move)
-		m_TypeObject.tp_name = m_strClassName.c_str();
-		m_TypeObject.tp_members = (PyMemberDef *) m_ntMemberDefs.data();
-		m_TypeObject.tp_methods = (PyMethodDef *) m_ntMethodDefs.data();
+	void _add_tuple_vars(PyObject * pTup, PyObject *arg)
+	{
+		_add_tuple_var(pTup, PyTuple_Size(pTup) - 1, arg);
 	}
 
-	void _ExposedClassDef::UnPrepare()
+	// ------------ Conversion functions ------------
+
+	bool convert( PyObject *obj, std::string &val )
 	{
-		// Initialize m_TypeObject
-		memset( &m_TypeObject, 0, sizeof( PyTypeObject ) );
-		m_TypeObject.ob_base = PyVarObject_HEAD_INIT( NULL, 0 )
+		// bytearrays can't be viewed safely, since they can be resized
+		if ( PyByteArray_Check( obj ) )
+		{
+			val.assign( PyByteArray_AS_STRING( obj ), PyByteArray_GET_SIZE( obj ) );
+			_tally_conversion( 0, val.size() );
+			return true;
+		}
 
-		// Assign constructor to PyClsInitFunc, leave new generic
-		m_TypeObject.tp_init = (initproc) _PyClsInitFunc;
-		m_TypeObject.tp_new = PyType_GenericNew;
-		// m_TypeObject.tp_repr = ; // TODO
+		// Everything else is a copy of the view (which knows its length, so embedded NULs survive)
+		std::string_view svVal;
+		if ( convert( obj, svVal ) )
+		{
+			val.assign( svVal.data(), svVal.size() );
+			_tally_conversion( 0, val.size() );
+			return true;
+		}
+		return false;
+	}
 
-		// This type object is a base type for any class that
-		// gets exposed - it must at least have space for _GenericPyClass
-		m_TypeObject.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
-		m_TypeObject.tp_basicsize = sizeof( _GenericPyClass );
+	bool convert( PyObject *obj, std::string_view &val )
+	{
+		if ( PyBytes_Check( obj ) )
+		{
+			val = std::string_view( PyBytes_AS_STRING( obj ), PyBytes_GET_SIZE( obj ) );
+			return true;
+		}
+		// We can do a unicode conversion as well
+		else if ( PyUnicode_Check( obj ) )
+		{
+			// This fails for strings that can't be encoded (i.e lone surrogates)
+			Py_ssize_t size( 0 );
+			const char * szVal = PyUnicode_AsUTF8AndSize( obj, &size );
+			if ( szVal == nullptr )
+			{
+				PyErr_Clear();
+				return false;
+			}
+			val = std::string_view( szVal, size );
+			return true;
+		}
+		return false;
 	}
 
-	// Returns true if pointers assigned in Prepare are not null
-	bool _ExposedClassDef::IsPrepared() const
+	// Widen each character of pSrc into val. Straight loops like
+	// these vectorize, and become memcpys when the sizes match
+	template <typename CharT, typename SrcT>
+	static void _widen_chars( const SrcT * pSrc, Py_ssize_t nLen, std::basic_string<CharT>& val )
 	{
-		return (bool) ( m_TypeObject.tp_name && m_TypeObject.tp_members && m_TypeObject.tp_methods );
+		val.resize( nLen );
+		CharT * pDst = &val[0];
+		for ( Py_ssize_t i = 0; i < nLen; i++ )
+			pDst[i] = (CharT) pSrc[i];
 	}
 
-	// Add a method to our null terminated method definition buffer
-	bool _ExposedClassDef::AddMethod( std::string strMethodName, PyCFunction fnPtr, int flags, std::string docs )
+	// Code points outside the BMP become surrogate pairs in UTF-16
+	template <typename CharT>
+	static void _encode_utf16( const Py_UCS4 * pSrc, Py_ssize_t nLen, std::basic_string<CharT>& val )
 	{
-		if ( strMethodName.empty() )
+		val.clear();
+		val.reserve( nLen );
+		for ( Py_ssize_t i = 0; i < nLen; i++ )
 		{
-			throw std::runtime_error( "Error adding method " + strMethodName );
+			Py_UCS4 c = pSrc[i];
+			if ( c < 0x10000 )
+				val.push_back( (CharT) c );
+			else
+			{
+				c -= 0x10000;
+				val.push_back( (CharT) ( 0xD800 | ( c >> 10 ) ) );
+				val.push_back( (CharT) ( 0xDC00 | ( c & 0x3FF ) ) );
+			}
+		}
+	}
+
+	// Copy the code points of a unicode object into a string of at least
+	// 16 bit characters. Python stores each string with the narrowest
+	// character that fits all of its code points (so ASCII is one byte
+	// each), and we copy from that directly
+	template <typename CharT>
+	static bool _convert_unicode( PyObject * obj, std::basic_string<CharT>& val )
+	{
+		static_assert( sizeof( CharT ) >= 2, "Unicode strings need characters of at least 16 bits" );
+#if PY_VERSION_HEX < 0x030C0000
+		if ( PyUnicode_READY( obj ) < 0 )
+		{
+			PyErr_Clear();
 			return false;
 		}
+#endif
+
+		Py_ssize_t nLen = PyUnicode_GET_LENGTH( obj );
+		const void * pData = PyUnicode_DATA( obj );
+		switch ( PyUnicode_KIND( obj ) )
+		{
+			case PyUnicode_1BYTE_KIND:
+				_widen_chars( (const Py_UCS1 *) pData, nLen, val );
+				break;
+			case PyUnicode_2BYTE_KIND:
+				_widen_chars( (const Py_UCS2 *) pData, nLen, val );
+				break;
+			default:
+				if ( sizeof( CharT ) >= 4 )
+					_widen_chars( (const Py_UCS4 *) pData, nLen, val );
+				else
+					_encode_utf16( (const Py_UCS4 *) pData, nLen, val );
+				break;
+		}
+		_tally_conversion( 0, val.size() * sizeof( CharT ) );
+		return true;
+	}
+
+	// Decode UTF-8 into a string of at least 16 bit characters
+	template <typename CharT>
+	static bool _convert_utf8( const char * pData, Py_ssize_t nLen, std::basic_string<CharT>& val )
+	{
+		// Pure ASCII needs no decoding. Or every byte together rather than
+		// stopping at the first high bit, so that the loop vectorizes
+		unsigned char uBits( 0 );
+		for ( Py_ssize_t i = 0; i < nLen; i++ )
+			uBits |= (unsigned char) pData[i];
+		if ( uBits < 0x80 )
+		{
+			_widen_chars( (const unsigned char *) pData, nLen, val );
+			_tally_conversion( 0, val.size() * sizeof( CharT ) );
+			return true;
+		}
+
+		// Otherwise let python decode it
+		unique_ptr upStr( PyUnicode_DecodeUTF8( pData, nLen, nullptr ) );
+		if ( !upStr )
+		{
+			PyErr_Clear();
+			return false;
+		}
+		_tally_conversion( 1, 0 );
+		return _convert_unicode( upStr.get(), val );
+	}
+
+	template <typename CharT>
+	static bool _convert_wide( PyObject * obj, std::basic_string<CharT>& val )
+	{
+		if ( PyUnicode_Check( obj ) )
+			return _convert_unicode( obj, val );
+		else if ( PyBytes_Check( obj ) )
+			return _convert_utf8( PyBytes_AS_STRING( obj ), PyBytes_GET_SIZE( obj ), val );
+		else if ( PyByteArray_Check( obj ) )
+			return _convert_utf8( PyByteArray_AS_STRING( obj ), PyByteArray_GET_SIZE( obj ), val );
+		return false;
+	}
+
+	bool convert( PyObject *obj, std::wstring &val )
+	{
+		return _convert_wide( obj, val );
+	}
+
+	bool convert( PyObject *obj, std::u16string &val )
+	{
+		return _convert_wide( obj, val );
+	}
+
+	bool convert( PyObject *obj, std::vector<char> &val )
+	{
+		if ( PyBytes_Check( obj ) )
+		{
+			val.resize( PyBytes_Size( obj ) );
+			memcpy( val.data(), PyBytes_AsString( obj ), val.size() );
+			_tally_conversion( 0, val.size() );
+			return true;
+		}
+		else if ( PyByteArray_Check( obj ) )
+		{
+			val.resize( PyByteArray_Size( obj ) );
+			memcpy( val.data(), PyByteArray_AsString( obj ), val.size() );
+			_tally_conversion( 0, val.size() );
+			return true;
+		}
+		else if ( PyObject_CheckBuffer( obj ) )
+		{
+			Py_buffer view;
+			if ( PyObject_GetBuffer( obj, &view, PyBUF_CONTIG_RO ) < 0 )
+			{
+				PyErr_Clear();
+				return false;
+			}
+			val.resize( view.len );
+			memcpy( val.data(), view.buf, val.size() );
+			PyBuffer_Release( &view );
+			_tally_conversion( 0, val.size() );
+			return true;
+		}
+		return false;
+	}
+
+	// These single character conversions aren't the most
+	// efficient, but I don't think they come up often
+	// Convert to string and get first character
+	bool convert( PyObject *obj, char &value )
+	{
+		std::string strContainer;
+		if ( convert( obj, strContainer ) )
+		{
+			value = strContainer[0];
+			return true;
+		}
+		return false;
+	}
+	bool convert( PyObject *obj, wchar_t &value )
+	{
+		std::wstring strContainer;
+		if ( convert( obj, strContainer ) )
+		{
+			value = strContainer[0];
+			return true;
+		}
+		return false;
+	}
+
+	// Convert some python object to a pyl::Object
+	// If the client knows what to do, let 'em deal with it
+	bool convert(PyObject * obj, pyl::Object& pyObj)
+	{
+		// The Object takes its own reference to obj
+		if ( obj == nullptr )
+			return false;
+		pyObj = pyl::Object( obj );
+		return true;
+	}
+
+	// ------------------ PyObject allocators --------------------
+
+	PyObject *alloc_pyobject( const Object& obj )
+	{
+		PyObject * pObj = obj.get();
+		Py_XINCREF( pObj );
+		return pObj;
+	}
+
+	PyObject *alloc_pyobject( const ObjectRef& obj )
+	{
+		PyObject * pObj = obj.get();
+		Py_XINCREF( pObj );
+		return pObj;
+	}
+
+	PyObject *alloc_pyobject( const std::string &str )
+	{
+		return alloc_pyobject( std::string_view( str ) );
+	}
+
+	PyObject *alloc_pyobject( std::string_view str )
+	{
+		_tally_conversion( 1, str.size() );
+		return PyBytes_FromStringAndSize( str.data(), str.size() );
+	}
+
+	PyObject *alloc_pyobject( const std::wstring &str )
+	{
+		_tally_conversion( 1, str.size() * sizeof( wchar_t ) );
+		return PyUnicode_FromWideChar( str.data(), str.size() );
+	}
+
+	PyObject *alloc_pyobject( const std::u16string &str )
+	{
+		_tally_conversion( 1, str.size() * sizeof( char16_t ) );
+
+		// Without surrogates each character is a code point, and python can narrow them
+		// itself. Don't stop at the first surrogate, so that the loop vectorizes
+		bool bSurrogates( false );
+		for ( char16_t c : str )
+			bSurrogates |= ( c >= 0xD800 && c < 0xE000 );
+		if ( !bSurrogates )
+			return PyUnicode_FromKindAndData( PyUnicode_2BYTE_KIND, str.data(), str.size() );
+
+		// Otherwise decode it, in our byte order (which keeps any byte order mark)
+		int nByteOrder( PY_LITTLE_ENDIAN ? -1 : 1 );
+		return PyUnicode_DecodeUTF16( (const char *) str.data(), str.size() * sizeof( char16_t ), nullptr, &nByteOrder );
+	}
+
+	PyObject *alloc_pyobject( const std::vector<char> &val, size_t sz )
+	{
+		_tally_conversion( 1, sz );
+		return PyByteArray_FromStringAndSize( val.data(), sz );
+	}
+
+	PyObject *alloc_pyobject( const std::vector<char> &val )
+	{
+		return alloc_pyobject( val, val.size() );
+	}
+
+	PyObject *alloc_pyobject( const char *cstr )
+	{
+		_tally_conversion( 1, strlen( cstr ) );
+		return PyBytes_FromString( cstr );
+	}
+
+	PyObject *alloc_pyobject( const char c )
+	{
+		_tally_conversion( 1, 1 );
+		return PyBytes_FromFormat( "%c", c );
+	}
+
+	// -------------- Generic Py Class stuff ----------------
+
+	const /*static*/ char * _GenericPyClass::c_ptr_name = "c_ptr";
+	int _GenericPyClass::SetCapsuleAttr( PyObject * pCapsule )
+	{
+		return PyObject_SetAttrString( ( PyObject * )this, _GenericPyClass::c_ptr_name, pCapsule );
+	}
+	
+	// -------------- Exposed Class Definition ----------------
+
+	_ExposedClassDef::_ExposedClassDef()
+	{
+		// See unprepare, but this just resets the type object
+		UnPrepare();
+	}
+
+
+	// Constructor for exposed classes, sets up type object
+	_ExposedClassDef::_ExposedClassDef( std::string strClassName ) :
+		_ExposedClassDef()
+	{
+		m_strClassName = strClassName;
+	}
+
+	// Prepare the exposed class definition
+	// This must take place when the _ExposedClassDef will no longer move in memory
+	void _ExposedClassDef::Prepare()
+	{
+		// Add a member called c_ptr (unless we've been prepared before)
+		if ( m_setUsedMemberNames.count( _GenericPyClass::c_ptr_name ) == 0 )
+			AddMember( _GenericPyClass::c_ptr_name, T_OBJECT_EX, offsetof( _GenericPyClass, pCapsule ), 0, "pointer to the underlying c object" );
+
+		// Assigning pointers (this is why the memory can't move)
+		m_TypeObject.tp_name = m_strClassName.c_str();
+		m_TypeObject.tp_members = (PyMemberDef *) m_ntMemberDefs.data();
+		m_TypeObject.tp_methods = (PyMethodDef *) m_ntMethodDefs.data();
+	}
+
+	void _ExposedClassDef::UnPrepare()
+	{
+		// Initialize m_TypeObject
+		memset( &m_TypeObject, 0, sizeof( PyTypeObject ) );
+		m_TypeObject.ob_base = PyVarObject_HEAD_INIT( NULL, 0 )
+
+		// Assign constructor to PyClsInitFunc, leave new generic
+		m_TypeObject.tp_init = (initproc) _PyClsInitFunc;
+		m_TypeObject.tp_new = PyType_GenericNew;
+		m_TypeObject.tp_dealloc = (destructor) _PyClsDeallocFunc;
+		// m_TypeObject.tp_repr = ; // TODO
+
+		// This type object is a base type for any class that
+		// gets exposed - it must at least have space for _GenericPyClass
+		m_TypeObject.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE;
+		m_TypeObject.tp_basicsize = sizeof( _GenericPyClass );
+	}
+
+	// Prepare the class if needed and ready its type object
+	PyTypeObject * _ExposedClassDef::Ready()
+	{
+		if ( IsPrepared() == false )
+			Prepare();
+
+		if ( PyType_Ready( &m_TypeObject ) < 0 )
+			return nullptr;
+
+		return &m_TypeObject;
+	}
+
+	// Returns true if pointers assigned in Prepare are not null
+	bool _ExposedClassDef::IsPrepared() const
+	{
+		return (bool) ( m_TypeObject.tp_name && m_TypeObject.tp_members && m_TypeObject.tp_methods );
+	}
+
+	// Add a method to our null terminated method definition buffer
+	bool _ExposedClassDef::AddMethod( std::string strMethodName, PyCFunction fnPtr, int flags, std::string docs )
+	{
+		if ( strMethodName.empty() )
+		{
+			throw std::runtime_error( "Error adding method " + strMethodName );
+			return false;
+		}
+
+		auto paInsert = m_setUsedMethodNames.insert( strMethodName );
+		if ( paInsert.second == false )
+		{
+			throw std::runtime_error( "Error: Attempting to overwrite exisiting exposed python function" );
+			return false;
+		}
+
+		const char * pName = paInsert.first->c_str();
+		const char * pDocs = docs.empty() ? nullptr : m_liMethodDocs.insert( m_liMethodDocs.end(), docs )->c_str();
+		m_ntMethodDefs.push_back( { pName, fnPtr, flags, pDocs } );
+		return true;
+	}
+
+	// Add a member to our null terminated method definition buffer
+	bool _ExposedClassDef::AddMember( std::string strMemberName, int type, int offset, int flags, std::string docs )
+	{
+		if ( strMemberName.empty() )
+		{
+			throw std::runtime_error( "Error adding member " + strMemberName );
+			return false;
+		}
+
+		auto paInsert = m_setUsedMemberNames.insert( strMemberName );
+		if ( paInsert.second == false )
+		{
+			throw std::runtime_error( "Error: Attempting to overwrite exisiting exposed python function" );
+			return false;
+		}
+
+		char * pName = (char *) paInsert.first->c_str();
+		char * pDocs = (char *) ( docs.empty() ? nullptr : m_liMemberDocs.insert( m_liMemberDocs.end(), docs )->c_str() );
+
+		m_ntMemberDefs.push_back( { pName, type, offset, flags, pDocs } );
+		return true;
+	}
+
+	PyTypeObject * _ExposedClassDef::GetTypeObject() const
+	{
+		return (PyTypeObject *) &m_TypeObject;
+	}
+
+	const char * _ExposedClassDef::GetName() const
+	{
+		return m_strClassName.c_str();
+	}
+
+	bool _ExposedClassDef::SetName( std::string strName )
+	{
+		// We can't do this if we're been prepared
+		if ( IsPrepared() )
+			return false;
+
+		m_strClassName = strName;
+		return true;
+	}
+
+
+	// ------------------- pyl::Object ---------------------
+
+	void _PyObjectDeleter::operator()( PyObject * pObj )
+	{
+		// Objects that outlive their interpreter (i.e a pyl::Object declared in the
+		// same scope as pyl::finalize) have nothing to release, even once another starts
+		if ( Py_IsInitialized() && uGeneration == _interpreter_generation() )
+			Py_XDECREF( pObj );
+	}
+
+	Object::Object() {}
+
+	Object::Object( PyObject *obj )
+	{
+		if ( obj == nullptr )
+			throw pyl::runtime_error( "Error: Null object used to construct pyl Object" );
+
+		Py_INCREF( obj );
+		m_upPyObject.reset( obj );
+	}
+
+	Object::Object( const Object& other ) :
+		Object()
+	{
+		*this = other;
+	}
+
+	Object& Object::operator=( const Object& other )
+	{
+		// Take the new reference before dropping ours, in case they're the same
+		PyObject * pObj = other.get();
+		Py_XINCREF( pObj );
+		m_upPyObject.reset( pObj );
+		return *this;
+	}
+
+	Object::Object( const ObjectRef& ref ) :
+		Object()
+	{
+		PyObject * pObj = ref.get();
+		Py_XINCREF( pObj );
+		m_upPyObject.reset( pObj );
+	}
+
+	// Modules retrieved via GetModule, keyed by name. Importing a module
+	// takes the import lock and looks in sys.modules, so we hang on to them
+	static std::unordered_map<std::string, unique_ptr> _s_mapModules;
+
+	// The main module gets its own slot, since it's used so often
+	static unique_ptr _s_upMainModule;
+
+	static void _clear_module_cache()
+	{
+		_s_mapModules.clear();
+		_s_upMainModule.reset();
+	}
+
+	// Returns a borrowed reference to a cached module, importing it if needed. A cached
+	// module that's no longer the one in sys.modules (because it was removed or replaced,
+	// i.e to reload it) is imported again; the lookup is still cheaper than an import
+	static PyObject * _get_cached_module( const std::string& strModName )
+	{
+		auto itModule = _s_mapModules.find( strModName );
+		if ( itModule != _s_mapModules.end() )
+		{
+			if ( PyDict_GetItemString( PyImport_GetModuleDict(), strModName.c_str() ) == itModule->second.get() )
+				return itModule->second.get();
+			_s_mapModules.erase( itModule );
+		}
+
+		PyObject * pModule = PyImport_ImportModule( strModName.c_str() );
+		if ( pModule == nullptr )
+			return nullptr;
+
+		_s_mapModules[strModName].reset( pModule );
+		return pModule;
+	}
+
+	// Returns a borrowed reference to the main module
+	static PyObject * _get_main_module()
+	{
+		if ( !_s_upMainModule )
+			_s_upMainModule.reset( PyImport_ImportModule( "__main__" ) );
+		return _s_upMainModule.get();
+	}
+
+	// A script loaded via Object( script_path ), keyed by its resolved path
+	struct _ScriptEntry
+	{
+		std::string strModName;   // The name the script was imported as
+		long long llModified;     // Modification time when last (re)loaded
+		unique_ptr upModule;      // Our reference to the module
+	};
+	static std::map<std::string, _ScriptEntry> _s_mapScripts;
+
+	// Script directories we've already made sure are on sys.path
+	static std::set<std::string> _s_setScriptDirs;
+
+	static void _clear_script_cache()
+	{
+		_s_mapScripts.clear();
+		_s_setScriptDirs.clear();
+	}
+
+	// Get an absolute, canonical path, or the input if it can't be resolved
+	std::string _resolve_path( const std::string& strPath )
+	{
+#if _WIN32
+		char buf[_MAX_PATH];
+		if ( _fullpath( buf, strPath.c_str(), _MAX_PATH ) )
+		{
+			std::string strRet( buf );
+			std::replace( strRet.begin(), strRet.end(), '\\', '/' );
+			return strRet;
+		}
+#else
+		char buf[PATH_MAX];
+		if ( realpath( strPath.c_str(), buf ) )
+			return buf;
+#endif
+		return strPath;
+	}
+
+	std::string _resolve_script_path( const std::string& strScript )
+	{
+		// Scripts are imported by module name, so "script" means "script.py"
+		if ( strScript.size() > 3 && strScript.rfind( ".py" ) == strScript.size() - 3 )
+			return _resolve_path( strScript );
+		return _resolve_path( strScript + ".py" );
+	}
+
+	// Get a file's modification time (in ns where we can), false if it doesn't exist
+	static bool _get_mtime( const std::string& strPath, long long& llModified )
+	{
+#if _WIN32
+		struct _stat64 st;
+		if ( _stat64( strPath.c_str(), &st ) != 0 )
+			return false;
+		llModified = (long long) st.st_mtime * 1000000000LL;
+#else
+		struct stat st;
+		if ( stat( strPath.c_str(), &st ) != 0 )
+			return false;
+		llModified = (long long) st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+#endif
+		return true;
+	}
+
+	// Make sure a script directory is on sys.path - we only
+	// have to look at sys.path the first time we see the directory
+	static bool _add_script_dir( const std::string& strDir )
+	{
+		if ( _s_setScriptDirs.count( strDir ) )
+			return true;
+
+		// Borrowed reference
+		PyObject * pPath = PySys_GetObject( "path" );
+		if ( pPath == nullptr || !PyList_Check( pPath ) )
+			return false;
+
+		unique_ptr upDir( PyUnicode_FromString( strDir.c_str() ) );
+		int nContains = PySequence_Contains( pPath, upDir.get() );
+		if ( nContains < 0 || ( nContains == 0 && PyList_Append( pPath, upDir.get() ) < 0 ) )
+			return false;
+
+		_s_setScriptDirs.insert( strDir );
+		return true;
+	}
+
+	// Reload a cached script via importlib.reload, keeping the old module if that fails
+	static bool _reload_script( _ScriptEntry& script )
+	{
+		PyObject * pImportLib = _get_cached_module( "importlib" );
+		PyObject * pReloaded = pImportLib ? PyObject_CallMethod( pImportLib, "reload", "O", script.upModule.get() ) : nullptr;
+		if ( pReloaded == nullptr )
+		{
+			print_error();
+			return false;
+		}
+
+		// If the module is in our module cache, it should see the reload as well
+		auto itModule = _s_mapModules.find( script.strModName );
+		if ( itModule != _s_mapModules.end() )
+		{
+			Py_INCREF( pReloaded );
+			itModule->second.reset( pReloaded );
+		}
+
+		script.upModule.reset( pReloaded );
+		return true;
+	}
+
+	// Reload a previously loaded script if its file has changed
+	bool _refresh_script( const std::string& strScript, Object& obModule )
+	{
+		auto itScript = _s_mapScripts.find( _resolve_script_path( strScript ) );
+		if ( itScript == _s_mapScripts.end() )
+			return false;
+
+		_ScriptEntry& script = itScript->second;
+		long long llModified( 0 );
+		if ( !_get_mtime( itScript->first, llModified ) || llModified == script.llModified )
+			return false;
+
+		script.llModified = llModified;
+		if ( !_reload_script( script ) )
+			return false;
+
+		obModule = Object( script.upModule.get() );
+		return true;
+	}
+
+	// Construct object from script
+	Object::Object( std::string script_path )
+	{
+		// Get the directory path and file name
+		std::replace( script_path.begin(), script_path.end(), '\\', '/' );
+		std::string base_path( "." ), file_path;
+		size_t last_slash( script_path.rfind( "/" ) );
+		if ( last_slash != std::string::npos )
+		{
+			if ( last_slash >= script_path.size() - 2 )
+				throw runtime_error( "Invalid script path" );
+			base_path = script_path.substr( 0, last_slash );
+			file_path = script_path.substr( last_slash + 1 );
+		}
+		else
+			file_path = script_path;
+
+		// Remove .py extension, if it exists
+		if ( file_path.size() > 3 && file_path.rfind( ".py" ) == file_path.size() - 3 )
+			file_path = file_path.substr( 0, file_path.size() - 3 );
+
+		// If we've loaded this script before, use the module we've got
+		// (reloading it first if the file has changed since)
+		const std::string strResolved = _resolve_script_path( script_path );
+		long long llModified( 0 );
+		bool bHasFile = _get_mtime( strResolved, llModified );
+		auto itScript = _s_mapScripts.find( strResolved );
+		if ( itScript != _s_mapScripts.end() )
+		{
+			_ScriptEntry& script = itScript->second;
+			if ( bHasFile && llModified != script.llModified )
+			{
+				_reload_script( script );
+				script.llModified = llModified;
+			}
+
+			Py_INCREF( script.upModule.get() );
+			m_upPyObject.reset( script.upModule.get() );
+			return;
+		}
+
+		// Make sure the script's directory is on the path, then import
+		if ( !_add_script_dir( _resolve_path( base_path ) ) )
+		{
+			print_error();
+			throw runtime_error( "Error importing path" );
+		}
+
+		PyObject * pScript = PyImport_ImportModule( file_path.c_str() );
+		if ( pScript == nullptr )
+		{
+			print_error();
+			throw runtime_error( "Error locating module" );
+		}
+
+		// Cache our own reference, then take one for this object
+		_ScriptEntry& script = _s_mapScripts[strResolved];
+		script.strModName = file_path;
+		script.llModified = llModified;
+		script.upModule.reset( pScript );
+
+		Py_INCREF( pScript );
+		m_upPyObject.reset( pScript );
+	}
+	/*static*/ Object Object::from_script( std::string strScript )
+	{
+		return Object( strScript );
+	}
+
+	/*static*/ Object Object::steal( PyObject * obj )
+	{
+		if ( obj == nullptr )
+			throw pyl::runtime_error( "Error: Null object used to construct pyl Object" );
+
+		Object ret;
+		ret.m_upPyObject.reset( obj );
+		return ret;
+	}
+
+	Object Object::_call_impl( PyObject * pFunc, PyObject * pArgTup /*= nullptr*/ )
+	{
+		// Try to call, clean memory on error
+		Object func;
+		try
+		{
+			// Call object, return result
+			PyObject * pRet = PyObject_CallObject( pFunc, pArgTup );
+			if ( pRet == nullptr )
+				throw pyl::runtime_error( "Failed to call function " );
+			return Object::steal( pRet );
+		}
+		// Release memory and pass along
+		catch ( pyl::runtime_error e )
+		{
+			print_error();
+			func.reset();
+			throw e;
+		}
+	}
+
+	Object Object::call( const std::string strName )
+	{
+		return _call_impl( get_attr( strName ).get() );
+	}
+	Object Object::operator()()
+	{
+		return _call_impl( get() );
+	}
+
+	static Object _get_attr( PyObject * pObj, const std::string& strName )
+	{
+		if ( pObj == nullptr )
+			return {};
+
+		PyObject *obj( PyObject_GetAttrString( pObj, strName.c_str() ) );
+		if ( !obj )
+		{
+			clear_error();
+			throw pyl::runtime_error( "Unable to find attribute '" + strName + '\'' );
+		}
+		return Object::steal( obj );
+	}
+
+	Object Object::get_attr( const std::string strName )
+	{
+		return _get_attr( m_upPyObject.get(), strName );
+	}
+
+	// This doesn't need to take a reference to the attribute
+	bool Object::has_attr( const std::string strName )
+	{
+		return m_upPyObject && PyObject_HasAttrString( m_upPyObject.get(), strName.c_str() );
+	}
+
+	void Object::reset()
+	{
+		m_upPyObject.reset();
+	}
+	
+	PyObject * Object::get() const
+	{
+		return m_upPyObject.get();
+	}
+
+	static Object _get_item( PyObject * pObj, Py_ssize_t nIndex )
+	{
+		if ( pObj == nullptr )
+			throw runtime_error( "Attempting to index a null object" );
 
-		auto paInsert = m_setUsedMethodNames.insert( strMethodName );
-		if ( paInsert.second == false )
+		// Lists and tuples give us a borrowed reference, which we wrap
+		if ( PyList_CheckExact( pObj ) || PyTuple_CheckExact( pObj ) )
 		{
-			throw std::runtime_error( "Error: Attempting to overwrite exisiting exposed python function" );
-			return false;
+			const bool bList = PyList_CheckExact( pObj );
+			Py_ssize_t nSize = bList ? PyList_GET_SIZE( pObj ) : PyTuple_GET_SIZE( pObj );
+			Py_ssize_t nItem = nIndex < 0 ? nIndex + nSize : nIndex;
+			if ( nItem < 0 || nItem >= nSize )
+				throw runtime_error( "Index " + std::to_string( nIndex ) + " out of range" );
+			return Object( bList ? PyList_GET_ITEM( pObj, nItem ) : PyTuple_GET_ITEM( pObj, nItem ) );
 		}
 
-		const char * pName = paInsert.first->c_str();
-		const char * pDocs = docs.empty() ? nullptr : m_liMethodDocs.insert( m_liMethodDocs.end(), docs )->c_str();
-		m_ntMethodDefs.push_back( { pName, fnPtr, flags, pDocs } );
-		return true;
+		// Anything else has to go through __getitem__
+		unique_ptr upIndex( PyLong_FromSsize_t( nIndex ) );
+		PyObject * pItem = PyObject_GetItem( pObj, upIndex.get() );
+		if ( pItem == nullptr )
+		{
+			clear_error();
+			throw runtime_error( "Unable to get item " + std::to_string( nIndex ) );
+		}
+		return Object::steal( pItem );
 	}
 
-	// Add a member to our null terminated method definition buffer
-	bool _ExposedClassDef::AddMember( std::string strMemberName, int type, int offset, int flags, std::string docs )
+	static Object _get_item( PyObject * pObj, const std::string& strKey )
 	{
-		if ( strMemberName.empty() )
+		if ( pObj == nullptr )
+			throw runtime_error( "Attempting to index a null object" );
+
+		// Dicts give us a borrowed reference, anything else has to go through __getitem__
+		unique_ptr upKey( PyUnicode_FromStringAndSize( strKey.data(), strKey.size() ) );
+		if ( !upKey )
 		{
-			throw std::runtime_error( "Error adding member " + strMemberName );
-			return false;
+			clear_error();
+			throw runtime_error( "Unable to get item '" + strKey + '\'' );
 		}
 
-		auto paInsert = m_setUsedMemberNames.insert( strMemberName );
-		if ( paInsert.second == false )
+		if ( PyDict_CheckExact( pObj ) )
 		{
-			throw std::runtime_error( "Error: Attempting to overwrite exisiting exposed python function" );
-			return false;
+			if ( PyObject * pItem = PyDict_GetItemWithError( pObj, upKey.get() ) )
+				return Object( pItem );
 		}
+		else if ( PyObject * pItem = PyObject_GetItem( pObj, upKey.get() ) )
+			return Object::steal( pItem );
 
-		char * pName = (char *) paInsert.first->c_str();
-		char * pDocs = (char *) ( docs.empty() ? nullptr : m_liMemberDocs.insert( m_liMemberDocs.end(), docs )->c_str() );
-
-		m_ntMemberDefs.push_back( { pName, type, offset, flags, pDocs } );
-		return true;
+		clear_error();
+		throw runtime_error( "Unable to get item '" + strKey + '\'' );
 	}
 
-	PyTypeObject * _ExposedClassDef::GetTypeObject() const
+	static Py_ssize_t _get_size( PyObject * pObj )
 	{
-		return (PyTypeObject *) &m_TypeObject;
+		if ( pObj == nullptr )
+			throw runtime_error( "Attempting to get the size of a null object" );
+
+		if ( PyList_CheckExact( pObj ) )
+			return PyList_GET_SIZE( pObj );
+		if ( PyTuple_CheckExact( pObj ) )
+			return PyTuple_GET_SIZE( pObj );
+		if ( PyDict_CheckExact( pObj ) )
+			return PyDict_GET_SIZE( pObj );
+
+		Py_ssize_t nSize = PyObject_Size( pObj );
+		if ( nSize < 0 )
+		{
+			clear_error();
+			throw runtime_error( "Object has no size" );
+		}
+		return nSize;
 	}
 
-	const char * _ExposedClassDef::GetName() const
+	// Borrowed items of lists and tuples
+	static ObjectRef _borrow_item( PyObject * pObj, Py_ssize_t nIndex )
 	{
-		return m_strClassName.c_str();
+		if ( pObj == nullptr || !( PyList_Check( pObj ) || PyTuple_Check( pObj ) ) )
+			throw runtime_error( "Only lists and tuples can lend items by index" );
+
+		const bool bList = PyList_Check( pObj );
+		Py_ssize_t nSize = bList ? PyList_GET_SIZE( pObj ) : PyTuple_GET_SIZE( pObj );
+		Py_ssize_t nItem = nIndex < 0 ? nIndex + nSize : nIndex;
+		if ( nItem < 0 || nItem >= nSize )
+			throw runtime_error( "Index " + std::to_string( nIndex ) + " out of range" );
+		return bList ? PyList_GET_ITEM( pObj, nItem ) : PyTuple_GET_ITEM( pObj, nItem );
 	}
 
-	bool _ExposedClassDef::SetName( std::string strName )
+	// Borrowed items of dicts
+	static ObjectRef _borrow_item( PyObject * pObj, const std::string& strKey )
 	{
-		// We can't do this if we're been prepared
-		if ( IsPrepared() )
-			return false;
+		if ( pObj == nullptr || !PyDict_Check( pObj ) )
+			throw runtime_error( "Only dicts can lend items by key" );
 
-		m_strClassName = strName;
-		return true;
+		unique_ptr upKey( PyUnicode_FromStringAndSize( strKey.data(), strKey.size() ) );
+		PyObject * pItem = upKey ? PyDict_GetItemWithError( pObj, upKey.get() ) : nullptr;
+		if ( pItem == nullptr )
+		{
+			clear_error();
+			throw runtime_error( "Unable to get item '" + strKey + '\'' );
+		}
+		return pItem;
 	}
 
+	Object Object::operator[]( Py_ssize_t nIndex ) const
+	{
+		return _get_item( m_upPyObject.get(), nIndex );
+	}
 
-	// ------------------- pyl::Object ---------------------
+	Object Object::operator[]( const std::string& strKey ) const
+	{
+		return _get_item( m_upPyObject.get(), strKey );
+	}
 
-	void _PyObjectDeleter::operator()( PyObject * pObj )
+	ObjectRef Object::at( Py_ssize_t nIndex ) const
 	{
-		Py_XDECREF( pObj );
+		return _borrow_item( m_upPyObject.get(), nIndex );
 	}
 
-	Object::Object() {}
+	ObjectRef Object::at( const std::string& strKey ) const
+	{
+		return _borrow_item( m_upPyObject.get(), strKey );
+	}
 
-	Object::Object( PyObject *obj )
+	Py_ssize_t Object::size() const
 	{
-		if ( obj == nullptr )
-			throw pyl::runtime_error( "Error: Null object used to construct pyl Object" );
+		return _get_size( m_upPyObject.get() );
+	}
 
-		Py_INCREF( obj );
-		m_upPyObject.reset( obj );
+	Object::iterator Object::begin() const
+	{
+		return iterator( m_upPyObject.get() );
 	}
 
-	// Construct object from script
-	Object::Object( std::string script_path )
+	Object::iterator Object::end() const
 	{
-		// Get the directory path and file name
-		std::replace( script_path.begin(), script_path.end(), '\\', '/' );
-		std::string base_path( "." ), file_path;
-		size_t last_slash( script_path.rfind( "/" ) );
-		if ( last_slash != std::string::npos )
-		{
-			if ( last_slash >= script_path.size() - 2 )
-				throw runtime_error( "Invalid script path" );
-			base_path = script_path.substr( 0, last_slash );
-			file_path = script_path.substr( last_slash + 1 );
-		}
-		else
-			file_path = script_path;
+		return iterator();
+	}
 
-		// Remove .py extension, if it exists
-		if ( file_path.rfind( ".py" ) == file_path.size() - 3 )
-			file_path = file_path.substr( 0, file_path.size() - 3 );
+	// -------------- Object iterator ----------------
 
-		// Try to import the module, it may fail if our path isn't set up
-		PyObject * pScript = PyImport_ImportModule( file_path.c_str() );
-		if ( pScript )
-		{
-			m_upPyObject.reset( pScript );
-		}
+	Object::iterator::iterator() :
+		m_eKind( Kind::End ),
+		m_pContainer( nullptr ),
+		m_nPos( 0 ),
+		m_pDictKey( nullptr )
+	{}
 
-		// If we didn't get it, see if the dir path is in PyPath
-		pyl::Object path( PySys_GetObject( "path" ) );
-		std::set<std::string> curPath;
-		if ( pyl::convert( path.get(), curPath ) )
+	Object::iterator::iterator( PyObject * pContainer ) :
+		iterator()
+	{
+		if ( pContainer == nullptr )
+			throw runtime_error( "Attempting to iterate a null object" );
+
+		m_pContainer = pContainer;
+		if ( PyList_CheckExact( pContainer ) )
+			m_eKind = Kind::List;
+		else if ( PyTuple_CheckExact( pContainer ) )
+			m_eKind = Kind::Tuple;
+		else if ( PyDict_CheckExact( pContainer ) )
+			m_eKind = Kind::Dict;
+		else
 		{
-			// If it isn't add it to the path and try again
-			if ( curPath.count( base_path ) == 0 )
+			PyObject * pIter = PyObject_GetIter( pContainer );
+			if ( pIter == nullptr )
 			{
-				Object pwd( PyUnicode_FromString( base_path.c_str() ) );
-				PyList_Append( path.get(), pwd.get() );
+				clear_error();
+				throw runtime_error( "Object is not iterable" );
 			}
+			m_obIter = Object::steal( pIter );
+			m_eKind = Kind::Generic;
+		}
 
-			pScript = PyImport_ImportModule( file_path.c_str() );
-			if ( pScript )
-			{
-				Py_XINCREF( pScript );
-				m_upPyObject.reset( pScript );
-			}
-			// Adding to path didn't help... sorry
-			else
+		// Dicts and iterators have to look ahead to know whether they're done
+		m_nPos = -1;
+		advance();
+	}
+
+	void Object::iterator::advance()
+	{
+		switch ( m_eKind )
+		{
+			case Kind::List:
+				// Lists can shrink while we iterate, so check each time
+				if ( ++m_nPos >= PyList_GET_SIZE( m_pContainer ) )
+					m_eKind = Kind::End;
+				break;
+			case Kind::Tuple:
+				if ( ++m_nPos >= PyTuple_GET_SIZE( m_pContainer ) )
+					m_eKind = Kind::End;
+				break;
+			case Kind::Dict:
 			{
-				print_error();
-				throw runtime_error( "Error locating module" );
+				// PyDict_Next starts at position 0
+				if ( m_nPos < 0 )
+					m_nPos = 0;
+				PyObject * pValue( nullptr );
+				if ( !PyDict_Next( m_pContainer, &m_nPos, &m_pDictKey, &pValue ) )
+					m_eKind = Kind::End;
+				break;
 			}
+			case Kind::Generic:
+				if ( PyObject * pItem = PyIter_Next( m_obIter.get() ) )
+					m_obItem = Object::steal( pItem );
+				else
+				{
+					m_eKind = Kind::End;
+					if ( PyErr_Occurred() )
+					{
+						clear_error();
+						throw runtime_error( "Error iterating python object" );
+					}
+				}
+				break;
+			case Kind::End:
+				break;
 		}
-		// The path should be a list...
-		else
+
+		// Let go of what we no longer need once we're done
+		if ( m_eKind == Kind::End )
 		{
-			print_error();
-			throw runtime_error( "Error importing path" );
+			m_obIter.reset();
+			m_obItem.reset();
 		}
 	}
-	/*static*/ Object Object::from_script( std::string strScript )
-	{
-		return Object( strScript );
-	}
 
-	Object Object::_call_impl( PyObject * pFunc, PyObject * pArgTup /*= nullptr*/ )
+	ObjectRef Object::iterator::operator*() const
 	{
-		// Try to call, clean memory on error
-		Object func;
-		try
-		{
-			// Call object, return result
-			PyObject * pRet = PyObject_CallObject( pFunc, pArgTup );
-			if ( pRet == nullptr )
-				throw pyl::runtime_error( "Failed to call function " );
-			return Object(pRet);
-		}
-		// Release memory and pass along
-		catch ( pyl::runtime_error e )
+		switch ( m_eKind )
 		{
-			print_error();
-			func.reset();
-			throw e;
+			case Kind::List:
+				return PyList_GET_ITEM( m_pContainer, m_nPos );
+			case Kind::Tuple:
+				return PyTuple_GET_ITEM( m_pContainer, m_nPos );
+			case Kind::Dict:
+				return m_pDictKey;
+			case Kind::Generic:
+				return m_obItem.get();
+			default:
+				throw runtime_error( "Attempting to dereference an exhausted iterator" );
 		}
 	}
 
-	Object Object::call( const std::string strName )
+	Object::iterator& Object::iterator::operator++()
 	{
-		return _call_impl( get_attr( strName ).get() );
+		advance();
+		return *this;
 	}
-	Object Object::operator()()
+
+	// Iterators are only ever compared to the end
+	bool Object::iterator::operator==( const iterator& other ) const
 	{
-		return _call_impl( get() );
+		return ( m_eKind == Kind::End ) == ( other.m_eKind == Kind::End );
 	}
 
-	Object Object::get_attr( const std::string strName )
+	bool Object::iterator::operator!=( const iterator& other ) const
 	{
-		if ( !m_upPyObject )
-			return { nullptr };
+		return !( *this == other );
+	}
 
-		PyObject *obj( PyObject_GetAttrString( m_upPyObject.get(), strName.c_str() ) );
-		if ( !obj )
-			throw std::runtime_error( "Unable to find attribute '" + strName + '\'' );
-		return Object(obj);
+	// -------------- pyl::ObjectRef ----------------
+
+	Object ObjectRef::get_attr( const std::string strName ) const
+	{
+		return _get_attr( m_pPyObject, strName );
 	}
 
-	bool Object::has_attr( const std::string strName )
+	Object ObjectRef::operator[]( Py_ssize_t nIndex ) const
 	{
-		try
-		{
-			get_attr( strName );
-		}
-		catch ( pyl::runtime_error& ) { return false; }
+		return _get_item( m_pPyObject, nIndex );
+	}
 
-		return true;
+	Object ObjectRef::operator[]( const std::string& strKey ) const
+	{
+		return _get_item( m_pPyObject, strKey );
 	}
 
-	void Object::reset()
+	ObjectRef ObjectRef::at( Py_ssize_t nIndex ) const
 	{
-		m_upPyObject.reset();
+		return _borrow_item( m_pPyObject, nIndex );
 	}
-	
-	PyObject * Object::get() const
+
+	ObjectRef ObjectRef::at( const std::string& strKey ) const
 	{
-		return m_upPyObject.get();
+		return _borrow_item( m_pPyObject, strKey );
+	}
+
+	Py_ssize_t ObjectRef::size() const
+	{
+		return _get_size( m_pPyObject );
+	}
+
+	ObjectRef::iterator ObjectRef::begin() const
+	{
+		return iterator( m_pPyObject );
+	}
+
+	ObjectRef::iterator ObjectRef::end() const
+	{
+		return iterator();
 	}
 
 	// The actual init function that gets invoked for exposed class instances
@@ -603,6 +1750,14 @@ namespace pyl
 		return -1;
 	}
 
+	// Exposed class instances own their capsule member, so release it when they go away
+	void _PyClsDeallocFunc( PyObject * self )
+	{
+		_GenericPyClass * pClass = static_cast<_GenericPyClass *>( (void *) self );
+		Py_CLEAR( pClass->pCapsule );
+		Py_TYPE( self )->tp_free( self );
+	}
+
 	// Static module map map declaration
 	ModuleDef::ModuleMap ModuleDef::s_mapPyModules;
 
@@ -626,7 +1781,9 @@ namespace pyl
 		{
 			if ( itClass.first == P )
 			{
+				// The parent's type object may already be in use, so start fresh
 				_ExposedClassDef clsDef = itClass.second;
+				clsDef.UnPrepare();
 				clsDef.SetName( strClassName );
 				return m_mapExposedClasses.emplace( T, clsDef ).second;
 			}
@@ -644,16 +1801,19 @@ namespace pyl
 			return -1;
 
 		// If a module wasn't specified, just do main
-		pModule = pModule ? pModule : PyImport_ImportModule( "__main__" );
+		pModule = pModule ? pModule : _get_main_module();
 		if ( pModule == nullptr )
 			return -1;
 
-		// Make ref to expose class object
+		// Make ref to expose class object, which must be ready before we instantiate it
 		_ExposedClassDef& expCls = itExpCls->second;
+		PyTypeObject * pTypeObj = expCls.Ready();
+		if ( pTypeObj == nullptr )
+			return -1;
 
 		// Allocate a new object for the class instance
 		// This object really is a _GenericPyClass object, so cast it
-		_GenericPyClass * pNewClass = PyObject_New( _GenericPyClass, expCls.GetTypeObject() );
+		_GenericPyClass * pNewClass = PyObject_New( _GenericPyClass, pTypeObj );
 		
 		// Zero the capsule pointer
 		// I'd like this to occur in some sort of new function...
@@ -673,10 +1833,8 @@ namespace pyl
 		// pNewClass's reference count
 		int ret = PyObject_SetAttrString( pModule, strName.c_str(), (PyObject *) pNewClass );
 
-		// decref the module, new py object, and capsule
-		// (we don't need the module, and PyObject_SetAttrString
+		// decref the new py object and capsule (PyObject_SetAttrString
 		// should have taken care of the new object and its member)
-		Py_DECREF( pModule );
 		Py_DECREF( (PyObject *) pNewClass );
 		Py_DECREF( pCapsule );
 
@@ -687,48 +1845,267 @@ namespace pyl
 	// Create the function object invoked when this module is imported
 	void ModuleDef::createFnObject()
 	{
-		// Declare the init function, which gets called on import and returns a PyObject *
-		// that represent the module itself (I hate capture this, but it felt necessary)
+		// Declare the init function, which gets called on import and returns the
+		// module definition - Python creates the module from it and then calls
+		// the exec slot (I hate capture this, but it felt necessary)
 		m_fnModInit = [this]()
 		{
-			// The MethodDef contains all functions defined in C++ code,
-			// including those called into by exposed classes
-			m_pyModDef = PyModuleDef
-			{
-				PyModuleDef_HEAD_INIT,
-				m_strModName.c_str(),
-				m_strModDocs.c_str(),
-				-1,
-				(PyMethodDef *) m_ntMethodDefs.data()
-			};
-
-			// Create the module if possible
-			if ( PyObject * mod = PyModule_Create( &m_pyModDef ) )
+			return PyModuleDef_Init( prepareModuleDef() );
+		};
+	}
+
+	// Fill out the PyModuleDef used to create the module
+	PyModuleDef * ModuleDef::prepareModuleDef()
+	{
+		// The exec slot is where the module gets populated
+		m_arSlots[0] = { Py_mod_exec, (void *) &ModuleDef::execModuleSlot };
+		m_arSlots[1] = { 0, nullptr };
+
+		// The MethodDef contains all functions defined in C++ code,
+		// including those called into by exposed classes
+		m_pyModDef = PyModuleDef
+		{
+			PyModuleDef_HEAD_INIT,
+			m_strModName.c_str(),
+			m_strModDocs.c_str(),
+			0,
+			(PyMethodDef *) m_ntMethodDefs.data(),
+			m_arSlots.data()
+		};
+
+		return &m_pyModDef;
+	}
+
+	// Populate a module created from our PyModuleDef
+	int ModuleDef::execModule( PyObject * mod )
+	{
+		// Exposed classes aren't readied until they're first accessed, which
+		// happens through the module's __getattr__ (see PEP 562)
+		static PyMethodDef s_arClassAccessMethods[] = {
+			{ "__getattr__", (PyCFunction) &ModuleDef::moduleGetAttr, METH_O, nullptr },
+			{ "__dir__", (PyCFunction) &ModuleDef::moduleDir, METH_NOARGS, nullptr },
+			{ nullptr, nullptr, 0, nullptr }
+		};
+		if ( !m_mapExposedClasses.empty() && PyModule_AddFunctions( mod, s_arClassAccessMethods ) < 0 )
+			return -1;
+
+		// Call the init function once the module is created
+		m_fnCustomInit( { mod } );
+
+		return 0;
+	}
+
+	// The Py_mod_exec slot of every pyl module - finds the definition and executes it
+	/*static*/ int ModuleDef::execModuleSlot( PyObject * mod )
+	{
+		const char * pName = PyModule_GetName( mod );
+		ModuleDef * pModDef = pName ? GetModuleDef( pName ) : nullptr;
+		if ( pModDef == nullptr )
+		{
+			PyErr_SetString( PyExc_ImportError, "Error locating pyl module definition" );
+			return -1;
+		}
+
+		// Exceptions can't cross back into the interpreter
+		try
+		{
+			return pModDef->execModule( mod );
+		}
+		catch ( std::exception& e )
+		{
+			PyErr_SetString( PyExc_ImportError, e.what() );
+			return -1;
+		}
+		catch ( ... )
+		{
+			PyErr_SetString( PyExc_ImportError, "Unknown exception executing pyl module" );
+			return -1;
+		}
+	}
+
+	// Ready an exposed class and add it to a module, returning the (borrowed) type
+	static PyObject * _add_exposed_class( PyObject * mod, _ExposedClassDef& expCls )
+	{
+		PyTypeObject * pTypeObj = expCls.Ready();
+		if ( pTypeObj == nullptr )
+			return nullptr;
+
+		// PyModule_AddObject steals a reference on success, but the type object is ours
+		Py_INCREF( pTypeObj );
+		if ( PyModule_AddObject( mod, expCls.GetName(), (PyObject *) pTypeObj ) < 0 )
+		{
+			Py_DECREF( pTypeObj );
+			return nullptr;
+		}
+		return (PyObject *) pTypeObj;
+	}
+
+	// Module level __getattr__, which readies exposed classes as they're accessed
+	/*static*/ PyObject * ModuleDef::moduleGetAttr( PyObject * mod, PyObject * pName )
+	{
+		const char * pModName = PyModule_GetName( mod );
+		const char * pStrName = PyUnicode_AsUTF8( pName );
+		ModuleDef * pModDef = pModName ? GetModuleDef( pModName ) : nullptr;
+		if ( pModDef == nullptr || pStrName == nullptr )
+			return nullptr;
+
+		// Star imports ask for __all__ (without one they'd only see what's in the module dict),
+		// so ready every class and give them the public names
+		if ( strcmp( pStrName, "__all__" ) == 0 )
+		{
+			for ( ExposedTypeMap::value_type& itExposedClass : pModDef->m_mapExposedClasses )
+				if ( !PyDict_GetItemString( PyModule_GetDict( mod ), itExposedClass.second.GetName() ) &&
+					 _add_exposed_class( mod, itExposedClass.second ) == nullptr )
+					return nullptr;
+
+			unique_ptr upNames( PyDict_Keys( PyModule_GetDict( mod ) ) );
+			PyObject * pAll = upNames ? PyList_New( 0 ) : nullptr;
+			if ( pAll == nullptr )
+				return nullptr;
+			for ( Py_ssize_t i = 0; i < PyList_GET_SIZE( upNames.get() ); i++ )
 			{
-				// Declare all exposed classes within the module
-				for ( const ExposedTypeMap::value_type& itExposedClass : m_mapExposedClasses )
+				PyObject * pKey = PyList_GET_ITEM( upNames.get(), i );
+				if ( PyUnicode_Check( pKey ) && PyUnicode_GET_LENGTH( pKey ) > 0 && PyUnicode_READ_CHAR( pKey, 0 ) != '_' &&
+					 PyList_Append( pAll, pKey ) < 0 )
 				{
-					const _ExposedClassDef& expCls = itExposedClass.second;
+					Py_DECREF( pAll );
+					return nullptr;
+				}
+			}
+			return pAll;
+		}
+
+		// This is only a linear search the first time, since the type ends up in the module dict
+		for ( ExposedTypeMap::value_type& itExposedClass : pModDef->m_mapExposedClasses )
+		{
+			_ExposedClassDef& expCls = itExposedClass.second;
+			if ( strcmp( expCls.GetName(), pStrName ) != 0 )
+				continue;
+
+			// The caller gets a reference as well as the module
+			PyObject * pTypeObj = _add_exposed_class( mod, expCls );
+			Py_XINCREF( pTypeObj );
+			return pTypeObj;
+		}
 
-					// Get the classes itExposedClass
-					PyTypeObject * pTypeObj = expCls.GetTypeObject();
-					if ( expCls.IsPrepared() == false || PyType_Ready( pTypeObj ) < 0 )
-						throw pyl::runtime_error( "Error! Exposing class def prematurely!" );
+		PyErr_Format( PyExc_AttributeError, "module '%s' has no attribute '%s'", pModName, pStrName );
+		return nullptr;
+	}
 
-					// Add the type to the module, acting under the assumption that these pointers remain valid
-					PyModule_AddObject( mod, expCls.GetName(), (PyObject *) pTypeObj );
-				}
+	// Module level __dir__, which includes classes that haven't been readied
+	/*static*/ PyObject * ModuleDef::moduleDir( PyObject * mod, PyObject * )
+	{
+		const char * pModName = PyModule_GetName( mod );
+		ModuleDef * pModDef = pModName ? GetModuleDef( pModName ) : nullptr;
+		if ( pModDef == nullptr )
+			return nullptr;
+
+		PyObject * pDict = PyModule_GetDict( mod );
+		PyObject * pNames = PyDict_Keys( pDict );
+		if ( pNames == nullptr )
+			return nullptr;
 
-				// Call the init function once the module is created
-				m_fnCustomInit( { mod } );
+		for ( const ExposedTypeMap::value_type& itExposedClass : pModDef->m_mapExposedClasses )
+		{
+			const char * pClassName = itExposedClass.second.GetName();
+			if ( PyDict_GetItemString( pDict, pClassName ) )
+				continue;
 
-				// Return the created module
-				return mod;
+			unique_ptr upClassName( PyUnicode_FromString( pClassName ) );
+			if ( !upClassName || PyList_Append( pNames, upClassName.get() ) < 0 )
+			{
+				Py_DECREF( pNames );
+				return nullptr;
 			}
+		}
+
+		return pNames;
+	}
+
+	// Modules created after the interpreter has started can't be added to the builtin modules,
+	// so they're served by this meta path finder (which uses the functions below)
+	static const char * const _s_pFinderSource = R"(
+import sys, importlib.machinery, importlib.util
+
+class PylModuleFinder:
+    @classmethod
+    def find_spec(cls, name, path=None, target=None):
+        return importlib.util.spec_from_loader(name, cls) if _has_module(name) else None
+
+    @staticmethod
+    def create_module(spec):
+        return _create_module(spec)
+
+    @staticmethod
+    def exec_module(module):
+        _exec_module(module)
+
+# Get in before the path finder, the way builtin modules would
+sys.meta_path.insert(sys.meta_path.index(importlib.machinery.PathFinder), PylModuleFinder)
+)";
+
+	/*static*/ PyObject * ModuleDef::finderHasModule( PyObject *, PyObject * pName )
+	{
+		const char * pStrName = PyUnicode_AsUTF8( pName );
+		if ( pStrName == nullptr )
+			return nullptr;
+
+		return PyBool_FromLong( GetModuleDef( pStrName ) != nullptr );
+	}
+
+	/*static*/ PyObject * ModuleDef::finderCreateModule( PyObject *, PyObject * pSpec )
+	{
+		unique_ptr upName( PyObject_GetAttrString( pSpec, "name" ) );
+		const char * pStrName = upName ? PyUnicode_AsUTF8( upName.get() ) : nullptr;
+		ModuleDef * pModDef = pStrName ? GetModuleDef( pStrName ) : nullptr;
+		if ( pModDef == nullptr )
+		{
+			PyErr_SetString( PyExc_ImportError, "Error locating pyl module definition" );
+			return nullptr;
+		}
 
-			// If creating the module failed for whatever reason
-			return ( PyObject * )nullptr;
+		return PyModule_FromDefAndSpec( pModDef->prepareModuleDef(), pSpec );
+	}
+
+	/*static*/ PyObject * ModuleDef::finderExecModule( PyObject *, PyObject * pModule )
+	{
+		PyModuleDef * pPyModDef = PyModule_GetDef( pModule );
+		if ( pPyModDef == nullptr || PyModule_ExecDef( pModule, pPyModDef ) < 0 )
+			return nullptr;
+
+		Py_INCREF( Py_None );
+		return Py_None;
+	}
+
+	/*static*/ int ModuleDef::InstallModuleFinder()
+	{
+		static PyMethodDef s_arFinderMethods[] = {
+			{ "_has_module", (PyCFunction) &ModuleDef::finderHasModule, METH_O, nullptr },
+			{ "_create_module", (PyCFunction) &ModuleDef::finderCreateModule, METH_O, nullptr },
+			{ "_exec_module", (PyCFunction) &ModuleDef::finderExecModule, METH_O, nullptr },
+			{ nullptr, nullptr, 0, nullptr }
 		};
+
+		// Run the finder source in its own namespace, with our functions in it
+		unique_ptr upGlobals( PyDict_New() );
+		if ( !upGlobals || PyDict_SetItemString( upGlobals.get(), "__builtins__", PyEval_GetBuiltins() ) < 0 )
+			return -1;
+
+		for ( PyMethodDef * pMethod = s_arFinderMethods; pMethod->ml_name; ++pMethod )
+		{
+			unique_ptr upFn( PyCFunction_New( pMethod, nullptr ) );
+			if ( !upFn || PyDict_SetItemString( upGlobals.get(), pMethod->ml_name, upFn.get() ) < 0 )
+				return -1;
+		}
+
+		unique_ptr upResult( PyRun_String( _s_pFinderSource, Py_file_input, upGlobals.get(), upGlobals.get() ) );
+		if ( !upResult )
+		{
+			print_error();
+			return -1;
+		}
+
+		return 0;
 	}
 
 	bool ModuleDef::addMethod_impl( std::string strMethodName, PyCFunction fnPtr, int flags, std::string docs )
@@ -755,9 +2132,10 @@ namespace pyl
 	// This function locks down any exposed class definitions
 	void ModuleDef::prepareClasses()
 	{
-		// Lock down any definitions
+		// Lock down any definitions (unless we've already done it)
 		for ( ExposedTypeMap::value_type& e_Class : m_mapExposedClasses )
-			e_Class.second.Prepare();
+			if ( e_Class.second.IsPrepared() == false )
+				e_Class.second.Prepare();
 	}
 
 	/*static*/ ModuleDef * ModuleDef::GetModuleDef( const std::string moduleName )
@@ -777,7 +2155,7 @@ namespace pyl
 		if ( it == s_mapPyModules.end() )
 			return nullptr;
 
-		PyObject * plMod = PyImport_ImportModule( m_strModName.c_str() );
+		PyObject * plMod = _get_cached_module( m_strModName );
 
 		return plMod;
 	}
@@ -801,9 +2179,9 @@ namespace pyl
 		m_fnCustomInit = fnCustomInit;
 	}
 
-	Object GetModule( std::string modName )
+	Object GetModule( const std::string& modName )
 	{
-		PyObject * pModule = PyImport_ImportModule( modName.c_str() );
+		PyObject * pModule = _get_cached_module( modName );
 		if ( pModule )
 			return { pModule };
 
@@ -812,14 +2190,18 @@ namespace pyl
 
 	Object main()
 	{
-		return GetModule( "__main__" );
+		PyObject * pModule = _get_main_module();
+		if ( pModule )
+			return { pModule };
+
+		throw runtime_error( "Error locating module!" );
 	}
 
 	_PyFunc _getPyFunc_Case4( std::function<void()> fn )
 	{
 		_PyFunc pFn = [fn]( PyObject * s, PyObject * a )
 		{
-			fn();
+			_invoke( fn, std::tuple<>() );
 			Py_INCREF( Py_None );
 			return Py_None;
 		};
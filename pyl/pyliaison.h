@@ -7,11 +7,24 @@
 #include <set>
 #include <list>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <optional>
+#include <variant>
 #include <string>
+#include <string_view>
 #include <functional>
 #include <memory>
 #include <utility>
 #include <typeindex>
+#include <array>
+#include <stdexcept>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <type_traits>
 
 #include <Python.h>
 #include <structmember.h>
@@ -35,10 +48,57 @@ namespace pyl
 {
 	// ----------------- Engine -----------------
 
+	/*! InitOptions \brief Options for starting the interpreter*/
+	struct InitOptions
+	{
+		bool bPoolAllocator; /*!< Serve python's small allocations from per thread pools rather than pymalloc*/
+		size_t uMemoryCap;   /*!< If nonzero, python allocations fail with a MemoryError past this many live bytes*/
+		InitOptions() : bPoolAllocator( false ), uMemoryCap( 0 ) {}
+	};
+
 	void initialize();
+
+	/*! initialize
+	\brief Start the interpreter with options
+
+	Python's object and memory allocators can only be replaced before the interpreter
+	first starts, so asking for the pool allocator or a memory cap after an interpreter
+	has been started without them throws a pyl::runtime_error. Once installed, the
+	allocator stays installed (and keeps counting), but each interpreter gets the
+	pooling and memory cap it's started with.*/
+	void initialize( const InitOptions& options );
 	void finalize();
 	bool isInitialized();
 
+	/*! MemoryStats \brief Statistics for python's object and memory allocators
+	Only collected once the allocator has been installed via InitOptions*/
+	struct MemoryStats
+	{
+		size_t uLiveBytes;    /*!< Bytes currently allocated*/
+		size_t uPeakBytes;    /*!< The most bytes that have been allocated at once*/
+		uint64_t uAllocs;     /*!< Number of allocations*/
+		uint64_t uFailures;   /*!< Number of allocations refused because of the memory cap*/
+		size_t uPoolBytes;    /*!< Bytes taken for the pool allocator's chunks, which are kept for reuse*/
+	};
+
+	/*! get_memory_stats \brief Get python's memory statistics*/
+	MemoryStats get_memory_stats();
+
+	/*! reset_peak_memory \brief Reset the peak to the number of live bytes*/
+	void reset_peak_memory();
+
+	// Used internally by initialize
+	bool _install_allocator();
+	bool _is_allocator_installed();
+	void _configure_allocator( bool bPool, size_t uMemoryCap );
+
+	// Counts interpreters started by initialize, so that anything cached
+	// from an interpreter that's been finalized can tell it has to go
+	size_t _interpreter_generation();
+
+	/*! StructSequence \brief A struct sequence type described at runtime
+	Structs known at compile time are better off with PYL_STRUCT (see pylRecord.h),
+	which makes the type once and converts instances without any lookups*/
 	struct StructSequence
 	{
 		std::string strName;
@@ -68,9 +128,30 @@ namespace pyl
 	// Generic python ret(args, kwargs) function
 	using _PyFunc = std::function<PyObject *( PyObject *, PyObject * )>;
 
-	// Unique pointer with deleter to decrement PyObject ref count
-	struct _PyObjectDeleter { void operator()( PyObject *obj ); };
-	using unique_ptr = std::unique_ptr<PyObject, _PyObjectDeleter>;
+	// Deleter to decrement PyObject ref count, if the object
+	// belongs to the interpreter that's running now
+	struct _PyObjectDeleter
+	{
+		size_t uGeneration { _interpreter_generation() };
+		void operator()( PyObject *obj );
+	};
+
+	// Unique pointer with the above deleter, which notes the interpreter
+	// whenever it's given an object (an object from an interpreter that's
+	// been finalized would otherwise be released into the next one)
+	class unique_ptr : public std::unique_ptr<PyObject, _PyObjectDeleter>
+	{
+		using _Base = std::unique_ptr<PyObject, _PyObjectDeleter>;
+
+	public:
+		using _Base::_Base;
+
+		void reset( PyObject * obj = nullptr )
+		{
+			_Base::reset( obj );
+			get_deleter().uGeneration = _interpreter_generation();
+		}
+	};
 
 	// Null terminated buffers (kind of a lazy hack...)
 	// For method and member definitions in modules/classes
@@ -84,6 +165,28 @@ namespace pyl
 		runtime_error( std::string strMessage ) : std::runtime_error( strMessage ) {}
 	};
 
+#ifdef PYL_PROFILE_CALLEES
+	// While a pyl::Profiler is running, bindings mark the time they spend in the C++ callee
+	// (as opposed to converting arguments and return values) so that it can be told apart.
+	// Only the owning thread writes to its counter, so it needn't be a locked increment
+	extern std::atomic<bool> _g_bProfiling;
+	extern thread_local std::atomic<int> _t_nProfileCallee;
+	struct _ProfileCalleeScope
+	{
+		bool bActive;
+		_ProfileCalleeScope() : bActive( _g_bProfiling.load( std::memory_order_relaxed ) )
+		{
+			if ( bActive )
+				_t_nProfileCallee.store( _t_nProfileCallee.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+		}
+		~_ProfileCalleeScope()
+		{
+			if ( bActive )
+				_t_nProfileCallee.store( _t_nProfileCallee.load( std::memory_order_relaxed ) - 1, std::memory_order_relaxed );
+		}
+	};
+#endif // PYL_PROFILE_CALLEES
+
 	// Invoke some callable object with a std::tuple
 	template<typename Func, typename Tup, std::size_t... index>
 	decltype( auto ) _invoke_helper( Func&& func, Tup&& tup, std::index_sequence<index...> )
@@ -93,6 +196,9 @@ namespace pyl
 	template<typename Func, typename Tup>
 	decltype( auto ) _invoke( Func&& func, Tup&& tup )
 	{
+#ifdef PYL_PROFILE_CALLEES
+		_ProfileCalleeScope profileScope;
+#endif
 		constexpr auto Size = std::tuple_size<typename std::decay<Tup>::type>::value;
 		return
 			_invoke_helper( std::forward<Func>( func ), std::forward<Tup>( tup ), std::make_index_sequence<Size>{} );
@@ -182,6 +288,114 @@ namespace pyl
 	/*! run_file \brief Execute a script in the interpeter*/
 	int run_file( std::string strCMD );
 
+	// ----------------- Call statistics -----------------
+
+	/*! CallStats \brief Statistics for a function exposed to python
+	These are only collected when pyliaison is built with PYL_CALL_STATS,
+	in which case they can also be read from python via the pyl_stats module*/
+	struct CallStats
+	{
+		std::string strName;                 /*!< module.function or module.Class.method*/
+		uint64_t uCalls;                     /*!< Number of calls*/
+		uint64_t uTotalNs;                   /*!< Cumulative time spent in the call*/
+		std::array<uint64_t, 32> arLatency;  /*!< Bucket i counts calls taking [2^i, 2^(i+1)) ns*/
+	};
+
+	/*! get_call_stats \brief Get the statistics of every exposed function
+	Returns nothing if pyliaison wasn't built with PYL_CALL_STATS*/
+	std::vector<CallStats> get_call_stats();
+
+	/*! reset_call_stats \brief Start collecting call statistics from scratch*/
+	void reset_call_stats();
+
+	// Used internally to wrap exposed functions when PYL_CALL_STATS is defined
+	_PyFunc _instrument_call( _PyFunc pFn, std::string strName );
+
+	// Used internally so that the profiler can tell which C functions are pyl bindings
+	void _register_binding( PyCFunction fnPtr, const std::string& strName );
+	const std::string * _get_binding_name( PyCFunction fnPtr );
+
+	// ----------------- Conversion statistics -----------------
+
+	/*! ConversionStat \brief What it cost to convert some C++ type to or from python
+	These are only collected when pyliaison is built with PYL_CONVERSION_STATS.
+	Conversions are counted where pyl starts them (binding arguments and return values,
+	Object::convert, set_attr and call arguments), and nested conversions (like
+	the elements of a container) are counted towards the outermost type*/
+	struct ConversionStat
+	{
+		std::string strType;  /*!< The C++ type*/
+		bool bAlloc;          /*!< True for alloc_pyobject (C++ to python), false for convert*/
+		uint64_t uCalls;      /*!< Number of conversions*/
+		uint64_t uObjects;    /*!< Python objects created*/
+		uint64_t uBytes;      /*!< Bytes of data copied*/
+		uint64_t uTotalNs;    /*!< Cumulative time spent converting*/
+	};
+
+	/*! get_conversion_stats \brief Get the conversion statistics of every thread
+	Returns nothing if pyliaison wasn't built with PYL_CONVERSION_STATS*/
+	std::vector<ConversionStat> get_conversion_stats();
+
+	/*! reset_conversion_stats \brief Start collecting conversion statistics from scratch*/
+	void reset_conversion_stats();
+
+	/********************************************//*!
+	pyl::ConversionStats
+	\brief A scoped probe that collects the conversions made by the current thread
+
+	Construct one around a hot loop and call Get to see what its conversions cost.
+	Returns nothing if pyliaison wasn't built with PYL_CONVERSION_STATS
+	***********************************************/
+	class ConversionStats
+	{
+		std::vector<ConversionStat> m_vStart; /*!< This thread's statistics when we were constructed*/
+	public:
+		ConversionStats();
+
+		/*! Get \brief Get the conversions made by this thread since construction*/
+		std::vector<ConversionStat> Get() const;
+	};
+
+	// Leaf conversions tally the objects they create and the bytes they copy,
+	// and the outermost conversion scope charges the tally to its type
+#ifdef PYL_CONVERSION_STATS
+	struct _ConversionTally
+	{
+		uint64_t uObjects;
+		uint64_t uBytes;
+		int nDepth;
+	};
+	extern thread_local _ConversionTally _t_ConversionTally;
+
+	inline void _tally_conversion( uint64_t uObjects, uint64_t uBytes )
+	{
+		_t_ConversionTally.uObjects += uObjects;
+		_t_ConversionTally.uBytes += uBytes;
+	}
+
+	// Registers a type and direction, returning the ID it's counted under
+	size_t _register_conversion( const std::type_info& tiType, bool bAlloc );
+
+	template <typename T, bool bAlloc>
+	size_t _conversion_id()
+	{
+		static const size_t s_uID = _register_conversion( typeid( T ), bAlloc );
+		return s_uID;
+	}
+
+	struct _ConversionScope
+	{
+		size_t uID;
+		uint64_t uObjects;
+		uint64_t uBytes;
+		std::chrono::steady_clock::time_point tStart;
+		_ConversionScope( size_t uID );
+		~_ConversionScope();
+	};
+#else
+	inline void _tally_conversion( uint64_t, uint64_t ) {}
+#endif
+
 	/*! get_tabs \brief Get properly formatted tab characters
 	In case you need to run a long python command, this can be
 	used to return the proper number of spaces for a tab*/
@@ -190,21 +404,28 @@ namespace pyl
 	// ------------ Conversion functions ------------
 
 	/*! convert \brief Convert a PyObject to a string
-	Works if the object is a bytes or unicode string*/
+	Works if the object is a bytes, bytearray or unicode string (which is encoded as UTF-8)*/
 	bool convert( PyObject *obj, std::string &val );
 
+	/*! convert \brief View the contents of a PyObject as a string
+	Works if the object is a bytes or unicode string. Nothing is copied; the view
+	points into the object (the UTF-8 encoding of a unicode string is cached there)
+	so it's only valid for as long as the object is alive*/
+	bool convert( PyObject *obj, std::string_view &val );
+
 	/*! convert \brief Convert a PyObject to a wide string
-	Works if the object is a bytes or unicode string*/
+	Works if the object is a unicode string, or bytes and bytearrays holding UTF-8*/
 	bool convert( PyObject *obj, std::wstring &val );
+
+	/*! convert \brief Convert a PyObject to a UTF-16 string
+	Works if the object is a unicode string, or bytes and bytearrays holding UTF-8*/
+	bool convert( PyObject *obj, std::u16string &val );
 	
 	/*! convert \brief Convert a PyObject to a char vector
-	Works if the object is a bytearray*/
+	Works if the object is bytes, a bytearray or anything else with a
+	contiguous buffer (like a memoryview)*/
 	bool convert( PyObject *obj, std::vector<char> &val );
 
-	/*! convert \brief Convert a PyObject to a bool
-	Could be more lenient - only accepts True or False for now*/
-	bool convert( PyObject *obj, bool &value );
-
 	/*! convert \brief Convert a PyObject to a char
 	Works for bytes and unicode*/
 	bool convert( PyObject *obj, char &val );
@@ -213,43 +434,184 @@ namespace pyl
 	Works for bytes and unicode*/
 	bool convert( PyObject *obj, wchar_t &val );
 
-	/*! convert \brief Convert a PyObject to a double
-	Works if the object is a PyFloat or PyLong*/
-	bool convert( PyObject *obj, double &val );
+	/********************************************//*!
+	pyl::converter
+	\brief Compile time conversion traits for scalar types
+	\tparam T The C++ type being converted
+
+	A specialization provides
+	static bool from_python( PyObject * obj, T& val ) and
+	static PyObject * to_python( T val ) (or const T& val), which convert and
+	alloc_pyobject dispatch to without any type erasure, so they
+	inline into container conversions. Specialize this for your
+	own value types to make them convertible everywhere pyl converts.
+	***********************************************/
+	template <typename T, typename Enable = void>
+	struct converter {};
+
+	// Character types are strings to python, so they don't count as integers
+	template <typename T>
+	using _is_integer = std::integral_constant<bool, std::is_integral<T>::value &&
+		!std::is_same<T, bool>::value && !std::is_same<T, char>::value && !std::is_same<T, wchar_t>::value>;
+
+	/*! converter \brief Integers of any width or signedness
+	Converting fails if the python int doesn't fit in T*/
+	template <typename T>
+	struct converter<T, typename std::enable_if<_is_integer<T>::value>::type>
+	{
+		static bool from_python( PyObject * obj, T& val )
+		{
+			if ( !PyLong_Check( obj ) )
+				return false;
+
+			if constexpr ( std::is_signed<T>::value )
+			{
+				// These report overflow rather than raising it
+				int nOverflow( 0 );
+				long long llVal = sizeof( T ) <= sizeof( long ) ?
+					PyLong_AsLongAndOverflow( obj, &nOverflow ) :
+					PyLong_AsLongLongAndOverflow( obj, &nOverflow );
+				if ( nOverflow || llVal < (long long) std::numeric_limits<T>::min() || llVal > (long long) std::numeric_limits<T>::max() )
+					return false;
+				val = (T) llVal;
+			}
+			else
+			{
+				// Negative and oversized values raise an OverflowError, and return -1 (which
+				// is also a valid result, so look for an error only when we get that)
+				const bool bLong = sizeof( T ) <= sizeof( unsigned long );
+				unsigned long long ullVal = bLong ? PyLong_AsUnsignedLong( obj ) : PyLong_AsUnsignedLongLong( obj );
+				const unsigned long long ullError = bLong ? (unsigned long) -1 : (unsigned long long) -1;
+				if ( ullVal == ullError && PyErr_Occurred() )
+				{
+					PyErr_Clear();
+					return false;
+				}
+				if ( ullVal > (unsigned long long) std::numeric_limits<T>::max() )
+					return false;
+				val = (T) ullVal;
+			}
+
+			_tally_conversion( 0, sizeof( T ) );
+			return true;
+		}
 
-	/*! convert \brief Convert a PyObject to a float
-	Works if the object is a PyFloat or PyLong*/
-	bool convert( PyObject *obj, float &val );
+		static PyObject * to_python( T val )
+		{
+			_tally_conversion( 1, sizeof( T ) );
+			if constexpr ( std::is_signed<T>::value )
+				return sizeof( T ) <= sizeof( long ) ? PyLong_FromLong( (long) val ) : PyLong_FromLongLong( (long long) val );
+			else
+				return sizeof( T ) <= sizeof( unsigned long ) ? PyLong_FromUnsignedLong( (unsigned long) val ) : PyLong_FromUnsignedLongLong( (unsigned long long) val );
+		}
+	};
 
-	/*! convert \brief Convert a PyObject to some integral type
-	Works if the object is a PyLong*/
-	template<class T, typename std::enable_if<std::is_integral<T>::value, T>::type = 0>
-	bool convert( PyObject *obj, T &val )
+	/*! converter \brief Doubles convert from python floats or ints*/
+	template <>
+	struct converter<double>
 	{
-		if ( !PyLong_Check( obj ) )
-			return false;
-		val = PyLong_AsLong( obj );
-		return true;
+		static bool from_python( PyObject * obj, double& val )
+		{
+			if ( PyFloat_CheckExact( obj ) )
+				val = PyFloat_AS_DOUBLE( obj );
+			else if ( PyFloat_Check( obj ) )
+				val = PyFloat_AsDouble( obj );
+			else if ( PyLong_Check( obj ) )
+			{
+				// Ints too large for a double raise an OverflowError
+				double dVal = PyLong_AsDouble( obj );
+				if ( dVal == -1. && PyErr_Occurred() )
+				{
+					PyErr_Clear();
+					return false;
+				}
+				val = dVal;
+			}
+			else
+				return false;
+
+			_tally_conversion( 0, sizeof( double ) );
+			return true;
+		}
+
+		static PyObject * to_python( double val )
+		{
+			_tally_conversion( 1, sizeof( double ) );
+			return PyFloat_FromDouble( val );
+		}
+	};
+
+	/*! converter \brief There are no 32 bit floats in python, so these go through double*/
+	template <>
+	struct converter<float>
+	{
+		static bool from_python( PyObject * obj, float& val )
+		{
+			double dVal( 0 );
+			if ( !converter<double>::from_python( obj, dVal ) )
+				return false;
+			val = (float) dVal;
+			return true;
+		}
+
+		static PyObject * to_python( float val )
+		{
+			return converter<double>::to_python( (double) val );
+		}
+	};
+
+	/*! converter \brief Bools only accept True or False
+	True and False are singletons, so nothing is created*/
+	template <>
+	struct converter<bool>
+	{
+		static bool from_python( PyObject * obj, bool& val )
+		{
+			if ( obj == Py_True )
+				val = true;
+			else if ( obj == Py_False )
+				val = false;
+			else
+				return false;
+			_tally_conversion( 0, sizeof( bool ) );
+			return true;
+		}
+
+		static PyObject * to_python( bool val )
+		{
+			_tally_conversion( 0, sizeof( bool ) );
+			return PyBool_FromLong( val );
+		}
+	};
+
+	/*! convert \brief Convert a PyObject to any type with a pyl::converter
+	This covers integers, floating point types and bools*/
+	template<class T>
+	inline auto convert( PyObject *obj, T &val ) -> decltype( converter<T>::from_python( obj, val ) )
+	{
+		return converter<T>::from_python( obj, val );
 	}
 
 	/*! convert_list \brief Convert a PyObject to a generic container type
-	The Container type must have a push_back method*/
+	The Container type must have a push_back method. Works for lists and
+	tuples, and anything else python can iterate over (besides strings,
+	bytes and dicts), like generators*/
 	template<class T, class C> bool convert_list( PyObject *obj, C &container );
 
 	/*! convert \brief Convert a PyObject to a std::list of type T
-	Works if input is a python list and every entry is convertable to T*/
+	Works if input is a python sequence or iterable and every entry is convertable to T*/
 	template<class T> bool convert( PyObject *obj, std::list<T> &lst );
 
 	/*! convert \brief Convert a PyObject to a std::vector of type T
-	Works if input is a python list and every entry is convertable to T*/
+	Works if input is a python sequence or iterable and every entry is convertable to T*/
 	template<class T> bool convert( PyObject *obj, std::vector<T> &vec );
 
 	/*! convert \brief Convert a PyObject to an array of type T and size N
-	Works if input is a python list and every entry is convertable to T*/
+	Works if input is a python list or tuple and every entry is convertable to T*/
 	template<class T> bool convert( PyObject *obj, T * arr, int N );
 
 	/*! convert \brief Convert a PyObject to a std::array of type T and size N
-	Works if input is a python list and every entry is convertable to T*/
+	Works if input is a python list or tuple and every entry is convertable to T*/
 	template<class T, size_t N> bool convert( PyObject *obj, std::array<T, N>& arr );
 
 	/*! convert \brief Convert a PyObject to a std::map<K, V>
@@ -257,14 +619,39 @@ namespace pyl
 	template<class K, class V> bool convert( PyObject *obj, std::map<K, V> &mp );
 
 	/*! convert \brief Convert a PyObject to a std::set<T>
-	Works if input is a python set and each element is convertable to T*/
+	Works if input is a python set, or any other sequence where each element is convertable to T*/
 	template<class C> bool convert( PyObject *obj, std::set<C>& s );
 
-	// Used internally
-	template<class T> bool _generic_convert( PyObject *obj,
-											const std::function<bool( PyObject* )> &is_obj,
-											const std::function<T( PyObject* )> &converter,
-											T &val );
+	/*! convert \brief Convert a PyObject to a std::unordered_map<K, V>
+	Works if the input is a dict where each key/value is convertable to K/V*/
+	template<class K, class V> bool convert( PyObject *obj, std::unordered_map<K, V> &mp );
+
+	/*! convert \brief Convert a PyObject to a std::unordered_set<T>
+	Works if input is a python set, or any other sequence where each element is convertable to T*/
+	template<class C> bool convert( PyObject *obj, std::unordered_set<C>& s );
+
+	/*! convert \brief Convert a PyObject to a std::deque of type T
+	Works if input is a python sequence or iterable and every entry is convertable to T*/
+	template<class T> bool convert( PyObject *obj, std::deque<T> &dq );
+
+	/*! convert \brief Convert a PyObject to a std::pair<A, B>
+	Works if input is a python tuple or list of length 2 whose entries are convertable to A and B*/
+	template<class A, class B> bool convert( PyObject *obj, std::pair<A, B> &pr );
+
+	/*! convert \brief Convert a PyObject to a std::optional<T>
+	None becomes an empty optional, anything else must be convertable to T*/
+	template<class T> bool convert( PyObject *obj, std::optional<T> &opt );
+
+	/*! convert \brief Convert a PyObject to a std::variant<Ts...>
+	Each alternative is tried in order, and the first one the input converts to wins.
+	That means order matters; a variant<double, int> will never hold an int*/
+	template<class... Ts> bool convert( PyObject *obj, std::variant<Ts...> &var );
+
+	/*! convert \brief Convert None to a std::monostate, so variants can hold it*/
+	inline bool convert( PyObject *obj, std::monostate& )
+	{
+		return obj == Py_None;
+	}
 
 	/*! convert \brief Convert a PyObject to a pyl::Object
 	This allows the use of an opaque python object in C++ code*/
@@ -276,12 +663,16 @@ namespace pyl
 	It's up to you to make sure the address coming from python is valid*/
 	template<typename T> bool convert( PyObject * obj, T *& val );
 
+	// Defined below, once every conversion has been declared
+	template <typename T> bool _convert_scoped( PyObject * obj, T& val );
+	template <typename T> PyObject * _alloc_scoped( const T& val );
+
 	// Base case, when n==b, just convert and return
 	template<size_t n, size_t b, class... Args>
 	typename std::enable_if<n == b, bool>::type
 		_add_to_tuple( PyObject *obj, std::tuple<Args...> &tup )
 	{
-		return convert( PyTuple_GetItem( obj, n - b ), std::get<n>( tup ) );
+		return _convert_scoped( PyTuple_GetItem( obj, n - b ), std::get<n>( tup ) );
 	}
 
 	// Recurse down to b; note that this can't compile
@@ -292,7 +683,7 @@ namespace pyl
 		_add_to_tuple( PyObject *obj, std::tuple<Args...> &tup )
 	{
 		_add_to_tuple<n - 1, b, Args...>( obj, tup );
-		return convert( PyTuple_GetItem( obj, n - b ), std::get<n>( tup ) );
+		return _convert_scoped( PyTuple_GetItem( obj, n - b ), std::get<n>( tup ) );
 	}
 
 	// Convert to std::tuple of specified type
@@ -305,15 +696,30 @@ namespace pyl
 		return _add_to_tuple<sizeof...(Args) -1, 0, Args...>( obj, tup );
 	}
 
-	// Convert a PyObject to a std::map
-	template<class K, class V>
-	bool convert( PyObject *obj, std::map<K, V> &mp )
+	// Reserve space in containers that can
+	template<class C, class = void>
+	struct _has_reserve : std::false_type {};
+	template<class C>
+	struct _has_reserve<C, decltype( std::declval<C&>().reserve( 0 ), void() )> : std::true_type {};
+
+	template<class C>
+	inline void _reserve( C& container, Py_ssize_t nSize )
+	{
+		if constexpr ( _has_reserve<C>::value )
+			if ( nSize > 0 )
+				container.reserve( (size_t) nSize );
+	}
+
+	// Convert a PyObject to a generic map (std::map or std::unordered_map)
+	template<class K, class V, class M>
+	bool convert_dict( PyObject *obj, M &mp )
 	{
 		if ( !PyDict_Check( obj ) )
 			return false;
 
 		// Use this until we succeed
-		std::map<K, V> mapRet;
+		M mapRet;
+		_reserve( mapRet, PyDict_Size( obj ) );
 
 		// Iterate through key/value, convert all
 		PyObject *py_key, *py_val;
@@ -326,7 +732,7 @@ namespace pyl
 			V val;
 			if ( !convert( py_val, val ) )
 				return false;
-			mapRet.emplace( key, val );
+			mapRet.emplace( std::move( key ), std::move( val ) );
 		}
 
 		// Assign and return
@@ -334,26 +740,43 @@ namespace pyl
 		return true;
 	}
 
-	// Convert a PyObject to a std::set
-	template<class C>
-	bool convert( PyObject *obj, std::set<C>& s )
+	// Convert a PyObject to a std::map
+	template<class K, class V>
+	bool convert( PyObject *obj, std::map<K, V> &mp )
+	{
+		return convert_dict<K, V>( obj, mp );
+	}
+
+	// Convert a PyObject to a std::unordered_map
+	template<class K, class V>
+	bool convert( PyObject *obj, std::unordered_map<K, V> &mp )
+	{
+		return convert_dict<K, V>( obj, mp );
+	}
+
+	// Convert a PyObject to a generic set (std::set or std::unordered_set)
+	template<class C, class S>
+	bool convert_set( PyObject *obj, S& s )
 	{
 		// If this is a set, walk it
-		if ( PySet_Check( obj ) )
+		if ( PyAnySet_Check( obj ) )
 		{
 			// Use this until we succeed
 			// to avoid invalidating s
-			std::set<C> setRet;
+			S setRet;
+			_reserve( setRet, PySet_GET_SIZE( obj ) );
 
-			PyObject *iter = PyObject_GetIter( obj );
-			PyObject *item = PyIter_Next( iter );
-			while ( item )
+			// The iterator and each item are new references
+			unique_ptr upIter( PyObject_GetIter( obj ) );
+			if ( !upIter )
+				return false;
+			_tally_conversion( 1, 0 );
+			while ( unique_ptr upItem { PyIter_Next( upIter.get() ) } )
 			{
 				C val;
-				if ( !convert( item, val ) )
+				if ( !convert( upItem.get(), val ) )
 					return false;
-				setRet.insert( val );
-				item = PyIter_Next( iter );
+				setRet.insert( std::move( val ) );
 			}
 
 			s = std::move( setRet );
@@ -361,35 +784,149 @@ namespace pyl
 		}
 		else
 		{
-			// If this is a list, turn it into a set
-			if ( PyList_Check( obj ) )
+			// If this is any other sequence, turn it into a set
+			std::vector<C> vRet;
+			if ( convert_list<C>( obj, vRet ) )
 			{
-				std::list<C> liRet;
-				if (convert(obj, liRet))
-				{
-					s = std::set<C>(liRet.begin(), liRet.end());
-					return true;
-				}
+				S setRet;
+				_reserve( setRet, vRet.size() );
+				setRet.insert( std::make_move_iterator( vRet.begin() ), std::make_move_iterator( vRet.end() ) );
+				s = std::move( setRet );
+				return true;
 			}
 			return false;
 		}
 	}
 
+	// Convert a PyObject to a std::set
+	template<class C>
+	bool convert( PyObject *obj, std::set<C>& s )
+	{
+		return convert_set<C>( obj, s );
+	}
+
+	// Convert a PyObject to a std::unordered_set
+	template<class C>
+	bool convert( PyObject *obj, std::unordered_set<C>& s )
+	{
+		return convert_set<C>( obj, s );
+	}
+
+	// Convert a PyObject to a std::pair
+	template<class A, class B>
+	bool convert( PyObject *obj, std::pair<A, B> &pr )
+	{
+		if ( ( !PyTuple_Check( obj ) && !PyList_Check( obj ) ) || PySequence_Fast_GET_SIZE( obj ) != 2 )
+			return false;
+
+		std::pair<A, B> prRet;
+		if ( !convert( PySequence_Fast_GET_ITEM( obj, 0 ), prRet.first ) ||
+			 !convert( PySequence_Fast_GET_ITEM( obj, 1 ), prRet.second ) )
+			return false;
+
+		pr = std::move( prRet );
+		return true;
+	}
+
+	// Convert a PyObject to a std::optional
+	template<class T>
+	bool convert( PyObject *obj, std::optional<T> &opt )
+	{
+		if ( obj == Py_None )
+		{
+			opt.reset();
+			return true;
+		}
+
+		T val;
+		if ( !convert( obj, val ) )
+			return false;
+		opt = std::move( val );
+		return true;
+	}
+
+	// Try converting to the Ith alternative of a variant
+	template<size_t I, class... Ts>
+	bool _convert_alternative( PyObject *obj, std::variant<Ts...> &var )
+	{
+		std::variant_alternative_t<I, std::variant<Ts...>> val;
+		if ( !convert( obj, val ) )
+			return false;
+		var.template emplace<I>( std::move( val ) );
+		return true;
+	}
+
+	template<class... Ts, size_t... Is>
+	bool _convert_variant( PyObject *obj, std::variant<Ts...> &var, std::index_sequence<Is...> )
+	{
+		// || short circuits, so this stops at the first alternative that works
+		return ( _convert_alternative<Is>( obj, var ) || ... );
+	}
+
+	// Convert a PyObject to a std::variant
+	template<class... Ts>
+	bool convert( PyObject *obj, std::variant<Ts...> &var )
+	{
+		return _convert_variant( obj, var, std::index_sequence_for<Ts...>() );
+	}
+
+	// Strings, bytes and dicts can be iterated, but they aren't sequences of items
+	inline bool _is_item_sequence( PyObject *obj )
+	{
+		return !( PyUnicode_Check( obj ) || PyBytes_Check( obj ) || PyByteArray_Check( obj ) || PyDict_Check( obj ) );
+	}
+
 	// Convert a PyObject to a generic container.
 	template<class T, class C>
 	bool convert_list( PyObject *obj, C &container )
 	{
-		// Must be a list type
-		if ( !PyList_Check( obj ) )
+		if ( !_is_item_sequence( obj ) )
 			return false;
 
 		C cRet;
-		for ( Py_ssize_t i( 0 ); i < PyList_Size( obj ); ++i )
+
+		// Lists and tuples are what PySequence_Fast would give us anyway, so index them directly
+		if ( PyList_Check( obj ) || PyTuple_Check( obj ) )
+		{
+			_reserve( cRet, PySequence_Fast_GET_SIZE( obj ) );
+			for ( Py_ssize_t i( 0 ); i < PySequence_Fast_GET_SIZE( obj ); ++i )
+			{
+				T val;
+				if ( !convert( PySequence_Fast_GET_ITEM( obj, i ), val ) )
+					return false;
+				cRet.push_back( std::move( val ) );
+			}
+		}
+		// Anything else that's iterable (generators, array.array, ranges...) gets walked,
+		// rather than copied into a temporary list first
+		else
 		{
-			T val;
-			if ( !convert( PyList_GetItem( obj, i ), val ) )
+			unique_ptr upIter( PyObject_GetIter( obj ) );
+			if ( !upIter )
+			{
+				PyErr_Clear();
 				return false;
-			cRet.push_back( std::move( val ) );
+			}
+
+			// This is just a hint, so don't worry if we don't get one
+			Py_ssize_t nHint = PyObject_LengthHint( obj, 0 );
+			if ( nHint < 0 )
+				PyErr_Clear();
+			_reserve( cRet, nHint );
+
+			while ( unique_ptr upItem { PyIter_Next( upIter.get() ) } )
+			{
+				T val;
+				if ( !convert( upItem.get(), val ) )
+					return false;
+				cRet.push_back( std::move( val ) );
+			}
+
+			if ( PyErr_Occurred() )
+			{
+				PyErr_Clear();
+				return false;
+			}
 		}
 
 		container = std::move( cRet );
@@ -405,22 +942,26 @@ namespace pyl
 	{
 		return convert_list<T, std::vector<T>>( obj, vec );
 	}
+	// Convert a PyObject to a std::deque.
+	template<class T> bool convert( PyObject *obj, std::deque<T> &dq )
+	{
+		return convert_list<T, std::deque<T>>( obj, dq );
+	}
 
 	// Convert a PyObject to a contiguous buffer (very unsafe, but hey)
 	template<class T> bool convert( PyObject *obj, T * arr, int N )
 	{
-		if ( !PyList_Check( obj ) )
+		if ( !PyList_Check( obj ) && !PyTuple_Check( obj ) )
 			return false;
 
 		// I can't really afford to allocate temporary
 		// space here... think of something else
-		Py_ssize_t len = PyList_Size( obj );
+		Py_ssize_t len = PySequence_Fast_GET_SIZE( obj );
 		if ( len > N ) len = N;
 		for ( Py_ssize_t i( 0 ); i < len; ++i )
 		{
 			T& val = arr[i];
-			PyObject * pItem = PyList_GetItem( obj, i );
-			if ( !convert( pItem, val ) )
+			if ( !convert( PySequence_Fast_GET_ITEM( obj, i ), val ) )
 				return false;
 		}
 		return true;
@@ -432,20 +973,9 @@ namespace pyl
 		return convert<T>( obj, arr.data(), int( N ) );
 	}
 
-	// Generic convert function used by others
-	template<class T> bool _generic_convert( PyObject *obj,
-											const std::function<bool( PyObject* )> &is_obj,
-											const std::function<T( PyObject* )> &converter,
-											T &val )
-	{
-		if ( !is_obj( obj ) )
-			return false;
-		val = converter( obj );
-		return true;
-	}
-
 	// Convert to a pyl::Object; useful if function can unpack it
 	class Object;
+	class ObjectRef;
 	bool convert( PyObject * obj, pyl::Object& pyObj );
 
 	// This gets invoked on calls to member functions, which require the instance ptr
@@ -459,6 +989,7 @@ namespace pyl
 		T * pRet = static_cast<T *>( PyCapsule_GetPointer( obj, NULL ) );
 		if ( pRet )
 		{
+			_tally_conversion( 0, sizeof( T * ) );
 			val = pRet;
 			return true;
 		}
@@ -469,15 +1000,27 @@ namespace pyl
 
 	// -------------- PyObject allocators ----------------
 
-	/*! alloc_pyobject \brief Convert some integral type T to a PyLong
-	This will work for any integer based type (int, char, short, size_t, etc.)*/
-	template<class T, typename std::enable_if<std::is_integral<T>::value, T>::type = 0>
-	PyObject *alloc_pyobject( T num );
+	/*! alloc_pyobject \brief Create a PyObject from any type with a pyl::converter
+	This covers integers (of any width), floating point types and bools*/
+	template<class T>
+	inline auto alloc_pyobject( const T& val ) -> decltype( converter<T>::to_python( val ) )
+	{
+		return converter<T>::to_python( val );
+	}
 
 	/*! alloc_pyobject \brief Converts a string to a (bytes) string
 	I may have this convert to unicode instead...*/
 	PyObject *alloc_pyobject( const std::string &str );
 
+	/*! alloc_pyobject \brief Converts a string view to a (bytes) string*/
+	PyObject *alloc_pyobject( std::string_view str );
+
+	/*! alloc_pyobject \brief Converts a wide string to a unicode string*/
+	PyObject *alloc_pyobject( const std::wstring &str );
+
+	/*! alloc_pyobject \brief Converts a UTF-16 string to a unicode string*/
+	PyObject *alloc_pyobject( const std::u16string &str );
+
 	/*! alloc_pyobject \brief Creates a PyByteArray from a std::vector<char>*/
 	PyObject *alloc_pyobject( const std::vector<char> &val, size_t sz );
 
@@ -489,15 +1032,6 @@ namespace pyl
 
 	PyObject *alloc_pyobject( const char c );
 
-	/*! alloc_pyobject \brief Creates a PyBool from a bool*/
-	PyObject *alloc_pyobject( bool value );
-
-	/*! alloc_pyobject \brief Creates a PyFloat from a double*/
-	PyObject *alloc_pyobject( double num );
-
-	/*! alloc_pyobject \brief Creates a PyFloat from a float*/
-	PyObject *alloc_pyobject( float num );
-
 	/*! alloc_pyobject \brief Creates a PyCapsule for unspecified pointer types*/
 	template <typename T> PyObject * alloc_pyobject( T * ptr );
 
@@ -513,12 +1047,37 @@ namespace pyl
 	/*! alloc_pyobject \brief Creates a PySet from a std::set<C>*/
 	template<class C> PyObject *alloc_pyobject( const std::set<C>& s );
 
-	/*! alloc_pyobject \brief Creates a PyObject from any integral type (gets converted to PyLong)*/
-	template<class T, typename std::enable_if<std::is_integral<T>::value, T>::type /*= 0*/>
-	PyObject *alloc_pyobject( T num )
+	/*! alloc_pyobject \brief Creates a PyDict from a std::unordered_map<K, V>*/
+	template<class K, class V> PyObject *alloc_pyobject( const std::unordered_map<K, V> &container );
+
+	/*! alloc_pyobject \brief Creates a PySet from a std::unordered_set<C>*/
+	template<class C> PyObject *alloc_pyobject( const std::unordered_set<C>& s );
+
+	/*! alloc_pyobject \brief Creates a PyList from a std::deque<T>*/
+	template<class T> PyObject *alloc_pyobject( const std::deque<T> &container );
+
+	/*! alloc_pyobject \brief Creates a PyTuple of length 2 from a std::pair<A, B>*/
+	template<class A, class B> PyObject *alloc_pyobject( const std::pair<A, B> &pr );
+
+	/*! alloc_pyobject \brief Creates None from an empty std::optional<T>, or whatever T becomes*/
+	template<class T> PyObject *alloc_pyobject( const std::optional<T> &opt );
+
+	/*! alloc_pyobject \brief Creates a PyObject from whichever alternative a std::variant holds*/
+	template<class... Ts> PyObject *alloc_pyobject( const std::variant<Ts...> &var );
+
+	/*! alloc_pyobject \brief Creates None from a std::monostate*/
+	inline PyObject *alloc_pyobject( const std::monostate& )
 	{
-		return PyLong_FromLong( num );
+		Py_INCREF( Py_None );
+		return Py_None;
 	}
+
+	/*! alloc_pyobject \brief Returns a new reference to the object held by a pyl::Object*/
+	PyObject *alloc_pyobject( const Object& obj );
+
+	/*! alloc_pyobject \brief Returns a new reference to the object viewed by a pyl::ObjectRef*/
+	PyObject *alloc_pyobject( const ObjectRef& obj );
+
 	/*! alloc_pyobject \brief Creates a PyCapsule for unspecified pointer types
 	Useful if you want to pass a pointer to something throug the interpreter*/
 	template <typename T>
@@ -526,6 +1085,7 @@ namespace pyl
 	{
 		// The name is specified here to be NULL, but we could give it
 		// a name so long as the string address would outlive the object... 
+		_tally_conversion( 1, sizeof( T * ) );
 		return PyCapsule_New( (void *) ptr, NULL, NULL );
 	}
 
@@ -534,6 +1094,7 @@ namespace pyl
 	template<class T> static PyObject *alloc_list( const T &container )
 	{
 		PyObject *lst( PyList_New( container.size() ) );
+		_tally_conversion( 1, 0 );
 
 		Py_ssize_t i( 0 );
 		for ( auto it( container.begin() ); it != container.end(); ++it )
@@ -554,35 +1115,126 @@ namespace pyl
 		return alloc_list( container );
 	}
 
-	/*! alloc_pyobject \brief Creates a PyDict from a std::map*/
-	template<class T, class K> PyObject *alloc_pyobject( const std::map<T, K> &container )
+	/*! alloc_pyobject \brief Creates a PyList from a std::deque*/
+	template<class T> PyObject *alloc_pyobject( const std::deque<T> &container )
+	{
+		return alloc_list( container );
+	}
+
+	/*! alloc_dict \brief Generic python dict allocation
+	Any STL map with allocatable keys and values is fair game*/
+	template<class M> static PyObject *alloc_dict( const M &container )
 	{
 		PyObject *dict( PyDict_New() );
+		_tally_conversion( 1, 0 );
 
+		// PyDict_SetItem doesn't steal our references to the key and value
 		for ( auto it( container.begin() ); it != container.end(); ++it )
-			PyDict_SetItem( dict,
-							alloc_pyobject( it->first ),
-							alloc_pyobject( it->second )
-			);
+		{
+			unique_ptr upKey( alloc_pyobject( it->first ) );
+			unique_ptr upVal( alloc_pyobject( it->second ) );
+			PyDict_SetItem( dict, upKey.get(), upVal.get() );
+		}
 
 		return dict;
 	}
 
-	/*! alloc_pyobject \brief Creates a PySet from a std::set*/
-	template<class C> PyObject *alloc_pyobject( const std::set<C>& s )
+	/*! alloc_pyobject \brief Creates a PyDict from a std::map*/
+	template<class T, class K> PyObject *alloc_pyobject( const std::map<T, K> &container )
+	{
+		return alloc_dict( container );
+	}
+
+	/*! alloc_pyobject \brief Creates a PyDict from a std::unordered_map*/
+	template<class T, class K> PyObject *alloc_pyobject( const std::unordered_map<T, K> &container )
+	{
+		return alloc_dict( container );
+	}
+
+	/*! alloc_set \brief Generic python set allocation
+	Any STL set with an allocatable type is fair game*/
+	template<class S> static PyObject *alloc_set( const S& s )
 	{
 		PyObject * pSet( PySet_New( NULL ) );
+		_tally_conversion( 1, 0 );
+		// PySet_Add doesn't steal our reference to the item
 		for ( auto& i : s )
 		{
-			PySet_Add( pSet, alloc_pyobject( i ) );
+			unique_ptr upItem( alloc_pyobject( i ) );
+			PySet_Add( pSet, upItem.get() );
 		}
 		return pSet;
 	}
 
+	/*! alloc_pyobject \brief Creates a PySet from a std::set*/
+	template<class C> PyObject *alloc_pyobject( const std::set<C>& s )
+	{
+		return alloc_set( s );
+	}
+
+	/*! alloc_pyobject \brief Creates a PySet from a std::unordered_set*/
+	template<class C> PyObject *alloc_pyobject( const std::unordered_set<C>& s )
+	{
+		return alloc_set( s );
+	}
+
+	/*! alloc_pyobject \brief Creates a PyTuple of length 2 from a std::pair*/
+	template<class A, class B> PyObject *alloc_pyobject( const std::pair<A, B> &pr )
+	{
+		// PyTuple_Pack doesn't steal our references to the items
+		unique_ptr upFirst( alloc_pyobject( pr.first ) );
+		unique_ptr upSecond( alloc_pyobject( pr.second ) );
+		_tally_conversion( 1, 0 );
+		return PyTuple_Pack( 2, upFirst.get(), upSecond.get() );
+	}
+
+	/*! alloc_pyobject \brief Creates None or a T from a std::optional*/
+	template<class T> PyObject *alloc_pyobject( const std::optional<T> &opt )
+	{
+		if ( !opt )
+		{
+			Py_INCREF( Py_None );
+			return Py_None;
+		}
+		return alloc_pyobject( *opt );
+	}
+
+	/*! alloc_pyobject \brief Creates a PyObject from the alternative held by a std::variant*/
+	template<class... Ts> PyObject *alloc_pyobject( const std::variant<Ts...> &var )
+	{
+		// A variant that's valueless by exception holds nothing
+		if ( var.valueless_by_exception() )
+		{
+			Py_INCREF( Py_None );
+			return Py_None;
+		}
+		return std::visit( []( const auto& val ) { return alloc_pyobject( val ); }, var );
+	}
+
 	// Used to verify data type
 	bool is_py_float( PyObject *obj );
 	bool is_py_int( PyObject *obj );
 
+	// Conversions started by pyl (rather than by other conversions) go through
+	// these, so that they can be counted when PYL_CONVERSION_STATS is defined
+	template <typename T>
+	bool _convert_scoped( PyObject * obj, T& val )
+	{
+#ifdef PYL_CONVERSION_STATS
+		_ConversionScope scope( _conversion_id<T, false>() );
+#endif
+		return convert( obj, val );
+	}
+
+	template <typename T>
+	PyObject * _alloc_scoped( const T& val )
+	{
+#ifdef PYL_CONVERSION_STATS
+		_ConversionScope scope( _conversion_id<T, true>() );
+#endif
+		return alloc_pyobject( val );
+	}
+
 	// Add to Tuple functions
 	// These recurse to an arbitrary base b
 	// and convert objects in a PyTuple to objects in a
@@ -596,7 +1248,7 @@ namespace pyl
 	// Adds a PyObject* to the tuple object
 	template<class T> void _add_tuple_var( PyObject * pTup, Py_ssize_t i, const T &data )
 	{
-		PyTuple_SetItem( pTup, i, alloc_pyobject( data ) );
+		PyTuple_SetItem( pTup, i, _alloc_scoped( data ) );
 	}
 
 
@@ -604,7 +1256,7 @@ namespace pyl
 	template<typename T>
 	void _add_tuple_vars( PyObject * pTup, const T &arg )
 	{
-		_add_tuple_var( pTup, PyTuple_Size( pTup ) - 1, alloc_pyobject( arg ) );
+		_add_tuple_var( pTup, PyTuple_Size( pTup ) - 1, _alloc_scoped( arg ) );
 	}
 
 	// add_tuple_vars recursively inserts elements into a python tuple
@@ -615,8 +1267,6 @@ namespace pyl
 		_add_tuple_vars( pTup, tail... );
 	}
 
-	// TODO Unordered sets/maps
-
 	// -------------- Exposed Class Definition ----------------
 
 	// Defines an exposed class (which is not per instance)
@@ -648,6 +1298,10 @@ namespace pyl
 		void UnPrepare();
 		bool IsPrepared() const;
 
+		// Prepares the class if needed and readies the type object,
+		// which must happen before it's used (returns nullptr on failure)
+		PyTypeObject * Ready();
+
 		// Getters/Setters
 		PyTypeObject * GetTypeObject() const;
 		const char * GetName() const;
@@ -662,6 +1316,9 @@ namespace pyl
 	// it in the interpreter as a new python object
 	int _PyClsInitFunc( PyObject * self, PyObject * args, PyObject * kwargs );
 
+	// Releases the capsule member of exposed class instances
+	void _PyClsDeallocFunc( PyObject * self );
+
 	// All exposed objects inherit from this python type, 
 	// which has a capsule member holding a pointer to the original object
 	struct _GenericPyClass 
@@ -698,20 +1355,45 @@ namespace pyl
 		\param obj The pointer from which to construct this Object.*/
 
 		/*!
-		Object \brief Copy construct from another pyl Object
+		Object \brief Construct from a PyObject pointer
 
 		This will increment the reference counter of the
 		input object, making it similar to an assignment*/
 		Object( PyObject *obj );
 
+		/*!
+		Object \brief Copy construct from another pyl Object
+
+		Both Objects hold a reference to the same python object;
+		moving an Object transfers its reference instead*/
+		Object( const Object& other );
+		Object( Object&& other ) = default;
+		Object& operator=( const Object& other );
+		Object& operator=( Object&& other ) = default;
+
+		/*!
+		Object \brief Take a reference to the object viewed by an ObjectRef
+		Use this to hold on to a borrowed reference beyond its scope*/
+		Object( const ObjectRef& ref );
+
 		/*!
 		from_script \brief Construct from a script file
 		Will import a script file into the interpreter and
 		construct an object containing it. This, like any object,
-		can have its members and functions accessed*/
+		can have its members and functions accessed. Loaded scripts
+		are cached by their resolved path, so loading the same script
+		again is cheap; if the file has been modified since it was
+		last loaded it will be reloaded via importlib.reload*/
 		Object( std::string strScript );
 		static Object from_script( std::string strScript );
 
+		/*!
+		steal \brief Construct from a new reference
+		Unlike the PyObject * constructor, this takes ownership of
+		the reference without incrementing it; use it to wrap objects
+		returned from python API calls that give you a new reference*/
+		static Object steal( PyObject * obj );
+
 		// Actual call function that invokes __call__ operator
 		Object _call_impl( PyObject * pFunc, PyObject * pArgTup = nullptr );
 
@@ -802,7 +1484,7 @@ namespace pyl
 		template<typename T>
 		bool set_attr( const std::string strName, T obj )
 		{
-			unique_ptr pyObj( alloc_pyobject( obj ) );
+			unique_ptr pyObj( _alloc_scoped( obj ) );
 			int success = PyObject_SetAttrString( this->get(), strName.c_str(), pyObj.get() );
 			return ( success == 0 );
 		}
@@ -818,7 +1500,7 @@ namespace pyl
 		\brief Attempts to convert this object to a Type T, stored in param
 		\return True or false depending on success of conversion*/
 		template<class T>
-		bool convert( T &param ) const { return pyl::convert( this->get(), param ); }
+		bool convert( T &param ) const { return pyl::_convert_scoped( this->get(), param ); }
 
 		/*! as
 		\brief Get a PyObject as some type T
@@ -841,7 +1523,7 @@ namespace pyl
 		\return An instance of the converted type
 
 		Invokes the pyl::as function - just a convenience*/
-		template<typename T>
+		template<typename T, typename std::enable_if<!std::is_same<T, ObjectRef>::value, int>::type = 0>
 		operator T() const
 		{
 			return as<T>();
@@ -851,6 +1533,160 @@ namespace pyl
 		\brief Decerements our reference of the PyObject
 		This is what happens if a python object goes out of scope*/
 		void reset();
+
+		/*! operator[]
+		\brief Get an item of a sequence (or mapping) by index
+
+		Negative indices count from the end of lists and tuples, as they
+		do in python. Throws a runtime_error if there's no such item*/
+		Object operator[]( Py_ssize_t nIndex ) const;
+
+		/*! operator[]
+		\brief Get an item of a mapping (like a dict) by key
+
+		Throws a runtime_error if there's no such item*/
+		Object operator[]( const std::string& strKey ) const;
+
+		/*! at
+		\brief Borrow an item of a list or tuple by index
+
+		Unlike operator[] this doesn't take a reference, so the item is only
+		valid for as long as the container holds it (don't modify the container
+		while using it.) Throws a runtime_error if this isn't a list or tuple
+		or there's no such item*/
+		ObjectRef at( Py_ssize_t nIndex ) const;
+
+		/*! at
+		\brief Borrow an item of a dict by key
+
+		The item is only valid for as long as the dict holds it. Throws a
+		runtime_error if this isn't a dict or there's no such item*/
+		ObjectRef at( const std::string& strKey ) const;
+
+		/*! size
+		\brief Get the number of items in a container, as len() would
+
+		Throws a runtime_error if the object doesn't have a length*/
+		Py_ssize_t size() const;
+
+		/*! iterator
+		\brief Iterates over the items of this object, as a for loop in python would
+
+		Lists and tuples are indexed directly and dicts are walked with PyDict_Next
+		(giving their keys), so neither creates a python iterator or a container;
+		anything else is iterated via the python iterator protocol. Each item is an
+		ObjectRef borrowed from the container (or the iterator, until it advances),
+		so iterating takes no references and converts nothing*/
+		class iterator;
+
+		/*! begin \brief Start iterating over our items*/
+		iterator begin() const;
+
+		/*! end \brief The iterator we reach when we run out of items*/
+		iterator end() const;
+	};
+
+	class Object::iterator
+	{
+		enum class Kind { End, List, Tuple, Dict, Generic };
+
+		Kind m_eKind;            /*!< How we're iterating*/
+		PyObject * m_pContainer; /*!< The object we're iterating over (kept alive by its Object)*/
+		Py_ssize_t m_nPos;       /*!< Index of the current item, or our position in the dict*/
+		PyObject * m_pDictKey;   /*!< The current dict key (borrowed)*/
+		Object m_obIter;         /*!< The python iterator, for anything else*/
+		Object m_obItem;         /*!< The current item of the python iterator*/
+
+		void advance();
+
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = ObjectRef;
+		using difference_type = Py_ssize_t;
+		using pointer = void;
+		using reference = ObjectRef;
+
+		iterator();
+		iterator( PyObject * pContainer );
+
+		ObjectRef operator*() const;
+		iterator& operator++();
+		bool operator==( const iterator& other ) const;
+		bool operator!=( const iterator& other ) const;
+	};
+
+	/********************************************//*!
+	pyl::ObjectRef
+	\brief A borrowed reference to a python object
+
+	Unlike pyl::Object this doesn't own a reference to the python object, so
+	making, copying and dropping one costs nothing; it's what you get while
+	iterating over an Object or borrowing one of its items with at(). The
+	object is only guaranteed to be alive for as long as whatever lent it
+	to you holds it, so construct a pyl::Object from it to keep it around.
+	***********************************************/
+	class ObjectRef
+	{
+		PyObject * m_pPyObject; /*!< Borrowed*/
+	public:
+		using iterator = Object::iterator;
+
+		ObjectRef() : m_pPyObject( nullptr ) {}
+		ObjectRef( PyObject * obj ) : m_pPyObject( obj ) {}
+		ObjectRef( const Object& obj ) : m_pPyObject( obj.get() ) {}
+
+		/*! get \brief Returns the borrowed PyObject * */
+		PyObject * get() const { return m_pPyObject; }
+
+		/*! convert
+		\brief Attempts to convert the object to a Type T, stored in param
+		\return True or false depending on success of conversion*/
+		template<class T>
+		bool convert( T &param ) const { return pyl::_convert_scoped( m_pPyObject, param ); }
+
+		/*! as
+		\brief Get the object as some type T
+
+		Throws an exception if the conversion fails*/
+		template<typename T>
+		T as() const
+		{
+			T ret;
+			if ( !convert( ret ) )
+				throw pyl::runtime_error( "pyl::ObjectRef::as: Couldn't convert PyObject" );
+			return ret;
+		}
+
+		/*! Cast operator \brief Get the object as some type T (see as)*/
+		template<typename T, typename std::enable_if<!std::is_same<T, Object>::value, int>::type = 0>
+		operator T() const
+		{
+			return as<T>();
+		}
+
+		/*! get_attr \brief Returns the attr at strName (see Object::get_attr)*/
+		Object get_attr( const std::string strName ) const;
+
+		/*! operator[] \brief Get an item by index (see Object::operator[])*/
+		Object operator[]( Py_ssize_t nIndex ) const;
+
+		/*! operator[] \brief Get an item by key (see Object::operator[])*/
+		Object operator[]( const std::string& strKey ) const;
+
+		/*! at \brief Borrow an item of a list or tuple by index (see Object::at)*/
+		ObjectRef at( Py_ssize_t nIndex ) const;
+
+		/*! at \brief Borrow an item of a dict by key (see Object::at)*/
+		ObjectRef at( const std::string& strKey ) const;
+
+		/*! size \brief Get the number of items in a container (see Object::size)*/
+		Py_ssize_t size() const;
+
+		/*! begin \brief Start iterating over our items (see Object::iterator)*/
+		iterator begin() const;
+
+		/*! end \brief The iterator we reach when we run out of items*/
+		iterator end() const;
 	};
 
 	// Pretty ridiculous
@@ -878,7 +1714,7 @@ namespace pyl
 			convert( a, tup );
 			R rVal = _invoke( fn, tup );
 
-			return alloc_pyobject( rVal );
+			return _alloc_scoped( rVal );
 		};
 		return pFn;
 	}
@@ -903,8 +1739,8 @@ namespace pyl
 	{
 		_PyFunc pFn = [fn]( PyObject * s, PyObject * a )
 		{
-			R rVal = fn();
-			return alloc_pyobject( rVal );
+			R rVal = _invoke( fn, std::tuple<>() );
+			return _alloc_scoped( rVal );
 		};
 		return pFn;
 	}
@@ -927,7 +1763,7 @@ namespace pyl
 			R rVal = _invoke( fn, tup );
 
 			// convert rVal to PyObject, return
-			return alloc_pyobject( rVal );
+			return _alloc_scoped( rVal );
 		};
 		return pFn;
 	}
@@ -960,9 +1796,9 @@ namespace pyl
 		_PyFunc pFn = [fn]( PyObject * s, PyObject * a )
 		{
 			// Nothing special here
-			R rVal = fn( _getCapsulePtr<C>( s ) );
+			R rVal = _invoke( fn, std::make_tuple( _getCapsulePtr<C>( s ) ) );
 
-			return alloc_pyobject( rVal );
+			return _alloc_scoped( rVal );
 		};
 		return pFn;
 	}
@@ -973,7 +1809,7 @@ namespace pyl
 		_PyFunc pFn = [fn]( PyObject * s, PyObject * a )
 		{
 			// Nothing special here
-			fn( _getCapsulePtr<C>( s ) );
+			_invoke( fn, std::make_tuple( _getCapsulePtr<C>( s ) ) );
 
 			Py_INCREF( Py_None );
 			return Py_None;
@@ -1017,6 +1853,7 @@ namespace pyl
 		std::set<std::string> m_setUsedMethodNames;						/*!< Reference safe storage for method names*/
 
 		PyModuleDef m_pyModDef;											/*!< The actual Python module def */
+		std::array<PyModuleDef_Slot, 2> m_arSlots;						/*!< The module def's (null terminated) slots */
 		std::string m_strModDocs;										/*!< The string containing module docs */
 		std::string m_strModName;										/*!< The string containing the module name */
 		std::function<PyObject *( )> m_fnModInit;						/*!< Function called on import that creates the module*/
@@ -1025,6 +1862,22 @@ namespace pyl
 		// Sets up m_fnModInit
 		void createFnObject();
 
+		// Fills out m_pyModDef, which Python uses to create the module (see PEP 489)
+		PyModuleDef * prepareModuleDef();
+
+		// Populates the module once Python has created it - this is where our classes get declared
+		int execModule( PyObject * pModule );
+		static int execModuleSlot( PyObject * pModule );
+
+		// Module level __getattr__ and __dir__, which ready exposed classes as they're accessed
+		static PyObject * moduleGetAttr( PyObject * pModule, PyObject * pName );
+		static PyObject * moduleDir( PyObject * pModule, PyObject * );
+
+		// Used by the module finder to import modules created after the interpreter has started
+		static PyObject * finderHasModule( PyObject * self, PyObject * pName );
+		static PyObject * finderCreateModule( PyObject * self, PyObject * pSpec );
+		static PyObject * finderExecModule( PyObject * self, PyObject * pModule );
+
 		// Implementation of expose object function that doesn't need to be in this header file
 		int exposeObject_impl( const std::type_index T, void * pInstance, const std::string& strName, PyObject * pModule );
 
@@ -1049,14 +1902,22 @@ namespace pyl
 		bool addFunction( const _PyFunc pFn, const std::string methodName, const int methodFlags, const std::string docs )
 		{
 			// We need to store these where they won't move
+			const std::string strBinding = m_strModName + '.' + methodName;
+#ifdef PYL_CALL_STATS
+			m_liExposedFunctions.push_back( _instrument_call( pFn, strBinding ) );
+#else
 			m_liExposedFunctions.push_back( pFn );
+#endif
 
 			// now make the function pointer (TODO figure out these ids, or do something else)
 			PyCFunction fnPtr = _get_fn_ptr<tag>( m_liExposedFunctions.back() );
 
 			// You can key the methodName string to a std::function
 			if ( addMethod_impl( methodName, fnPtr, methodFlags, docs ) )
+			{
+				_register_binding( fnPtr, strBinding );
 				return true;
+			}
 
 			m_liExposedFunctions.pop_back();
 			return false;
@@ -1071,14 +1932,22 @@ namespace pyl
 				return false;
 
 			// We need to store these where they won't move
+			const std::string strBinding = m_strModName + '.' + it->second.GetName() + '.' + methodName;
+#ifdef PYL_CALL_STATS
+			m_liExposedFunctions.push_back( _instrument_call( pFn, strBinding ) );
+#else
 			m_liExposedFunctions.push_back( pFn );
+#endif
 
 			// now make the function pointer (TODO figure out these ids, or do something else)
 			PyCFunction fnPtr = _get_fn_ptr<tag>( m_liExposedFunctions.back() );
 
 			// Add function
 			if ( it->second.AddMethod( methodName, fnPtr, methodFlags, docs ) )
+			{
+				_register_binding( fnPtr, strBinding );
 				return true;
+			}
 
 			m_liExposedFunctions.pop_back();
 			return false;
@@ -1339,7 +2208,7 @@ namespace pyl
 		\param[out] pModule A pointer to the module you've requested, returns nullptr if not found
 
 		Use this function to get a pointer to a previously created module definition. If you plan on
-		modifying the definition you must do it prior to initializing the interpreter*/
+		modifying the definition you must do it before the module is first imported*/
 		static ModuleDef * GetModuleDef( const std::string moduleName );
 
 		/*! Create
@@ -1349,9 +2218,11 @@ namespace pyl
 		\param[in] moduleName The optional docString of the module, as seen by Python
 		\param[out] pModule A pointer to the module you've just greated, nullptr if something went wrong
 
-		Use this function to get create a new Python module (meaning it must be called prior to initializing the interpreter.)
-		The module will be available to to the interpreter under the name moduleName, and if you provide a documentation string
-		then that will be available to the interpreter via the __help__ function (?)*/
+		Use this function to get create a new Python module. The module will be available to to the interpreter under the name
+		moduleName, and if you provide a documentation string then that will be available to the interpreter via the __help__ function (?)
+		Modules created before the interpreter is initialized become builtin modules, while modules created afterwards are
+		imported through a meta path finder that pyl installs. Either way the module is only created when it's first imported,
+		and everything in it must be registered before then.*/
 		template <typename tag>
 		static ModuleDef * Create( const std::string moduleName, const std::string moduleDocs = "" )
 		{
@@ -1364,6 +2235,10 @@ namespace pyl
 			// Create an initialize m_fnModInit
 			mod.createFnObject();
 
+			// It's too late to add a builtin module once we've started, the finder will get it
+			if ( Py_IsInitialized() )
+				return &mod;
+
 			// Add this module to the list of builtin modules, and ensure m_fnModInit gets called on import
 			int success = PyImport_AppendInittab( mod.getNameBuf(), _get_fn_ptr<tag>( mod.m_fnModInit ) );
 			if ( success != 0 )
@@ -1383,7 +2258,7 @@ namespace pyl
 		Use this function to get a module as a pyl::Object. Once you have it as an object, you can invoke functions like
 		call_function or get_attr to access the module from C++ code. Note that this is different from having a handle
 		to the module definition; this is the real PyObject, owning references to all objects exposed within the module
-		and retreived by calling PyImport_ImportModule directly*/
+		and retreived the same way as pyl::GetModule*/
 		Object AsObject() const;
 
 		/*! SetCustomModuleInit
@@ -1401,18 +2276,38 @@ namespace pyl
 		\brief Initialize all modules in the internal module map
 
 		This function invokes Module::prepareClasses() on every function in the internal module map, which bakes any
-		existing class definitions and creates the corresponding type objects inside this modules Python representation.
+		existing class definitions. The corresponding type objects are readied when they're first accessed, either through
+		the module (via its __getattr__) or by exposing an instance, so import cost scales with the classes actually used.
 		This function should only be called once before the interpreter is initialized, and should not be called again
 		until the interpreter has been shut down.*/
 		static int InitAllModules();
+
+		/*! InstallModuleFinder
+		\brief Install the meta path finder that imports modules created after startup
+
+		This is called by pyl::initialize once the interpreter has started. Modules created from then
+		on can't be builtin modules, so this finder creates them (via PEP 489 multi-phase initialization)
+		when they're first imported.*/
+		static int InstallModuleFinder();
 	};
 
 	/*! InitAllModules \brief Returns the main module as a pyl::Object*/
 	Object main();
 
 	/*! InitAllModules \brief Returns the module with name modNameas a pyl::Object
-	Throws a runtime_error if the module is not found. */
-	Object GetModule( std::string modName );
+	Throws a runtime_error if the module is not found. Modules are cached
+	after the first import, and the cache is released on finalize. */
+	Object GetModule( const std::string& modName );
+
+	// Used internally to canonicalize script paths
+	std::string _resolve_path( const std::string& strPath );
+
+	// Used internally to canonicalize the path of a script, which may be named without ".py"
+	std::string _resolve_script_path( const std::string& strScript );
+
+	// Used internally to reload a script loaded via Object( script_path )
+	// if its file has changed - returns true and assigns obModule if reloaded
+	bool _refresh_script( const std::string& strScript, Object& obModule );
 
 // MACROS!
 
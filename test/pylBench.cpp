@@ -0,0 +1,380 @@
+#include <pyliaison.h>
+#include <pylBuffer.h>
+#include <pylChannel.h>
+#include <pylColumns.h>
+#include <pylRecord.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+
+// Functions covering each of the _getPyFunc cases
+int Add( int a, int b ) { return a + b; }
+void Consume( int, int ) {}
+int GetOne() { return 1; }
+void DoNothing() {}
+
+// Class covering each of the _getPyFunc_Mem cases
+class Counter
+{
+	int n;
+public:
+	Counter() : n( 0 ) {}
+	int Add( int a ) { return n += a; }
+	void Set( int a ) { n = a; }
+	int Get() { return n; }
+	void Reset() { n = 0; }
+};
+
+// A record converted a column at a time
+struct Trade
+{
+	int64_t nID;
+	double dPrice;
+	int32_t nQuantity;
+};
+PYL_RECORD( Trade, nID, dPrice, nQuantity )
+
+// A struct returned as a struct sequence
+struct Fill
+{
+	int64_t nID;
+	double dPrice;
+	std::string strSymbol;
+};
+PYL_STRUCT( Fill, nID, dPrice, strSymbol )
+
+// Collects timings and writes them out as JSON
+class Bench
+{
+	struct Result
+	{
+		std::string strName;
+		size_t uIterations;
+		double dNsPerOp;
+	};
+	std::vector<Result> m_vResults;
+	double m_dScale;
+
+public:
+	Bench( double dScale ) : m_dScale( dScale ) {}
+
+	// Runs fn the given number of times (scaled), keeping the best of a few repetitions
+	template <typename F>
+	void Run( std::string strName, size_t uIterations, F fn )
+	{
+		using namespace std::chrono;
+
+		uIterations = std::max<size_t>( 1, size_t( uIterations * m_dScale ) );
+		double dBest = 0;
+		for ( int r = 0; r < 3; r++ )
+		{
+			auto tStart = steady_clock::now();
+			for ( size_t i = 0; i < uIterations; i++ )
+				fn();
+			double dNs = (double) duration_cast<nanoseconds>( steady_clock::now() - tStart ).count() / uIterations;
+			dBest = r == 0 ? dNs : std::min( dBest, dNs );
+		}
+
+		m_vResults.push_back( { strName, uIterations, dBest } );
+		std::cerr << strName << ": " << dBest << " ns/op" << std::endl;
+	}
+
+	// Runs a python loop that performs an operation n times, for when the timing has to happen in python
+	void RunPython( std::string strName, size_t uIterations, std::string strLoopFn )
+	{
+		uIterations = std::max<size_t>( 1, size_t( uIterations * m_dScale ) );
+		pyl::Object obLoop = pyl::main().get_attr( strLoopFn );
+		double dBest = 0;
+		for ( int r = 0; r < 3; r++ )
+		{
+			auto tStart = std::chrono::steady_clock::now();
+			obLoop( uIterations );
+			double dNs = (double) std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - tStart ).count() / uIterations;
+			dBest = r == 0 ? dNs : std::min( dBest, dNs );
+		}
+
+		m_vResults.push_back( { strName, uIterations, dBest } );
+		std::cerr << strName << ": " << dBest << " ns/op" << std::endl;
+	}
+
+	void Write( std::ostream& out, std::string strPythonVersion ) const
+	{
+		out << "{\n  \"python\": \"" << strPythonVersion << "\",\n  \"results\": [\n";
+		for ( size_t i = 0; i < m_vResults.size(); i++ )
+		{
+			const Result& r = m_vResults[i];
+			out << "    { \"name\": \"" << r.strName << "\", \"iterations\": " << r.uIterations << ", \"ns_per_op\": " << r.dNsPerOp << " }";
+			out << ( i + 1 < m_vResults.size() ? ",\n" : "\n" );
+		}
+		out << "  ]\n}\n";
+	}
+};
+
+// Defines a python function that calls a bound function n times
+void DefineLoop( std::string strLoopFn, std::string strCall )
+{
+	std::string strCmd = "def " + strLoopFn + "(n):\n" +
+						 "    for i in range(n):\n" +
+						 "        " + strCall + "\n";
+	pyl::run_cmd( strCmd );
+}
+
+// Measures the overhead of pyliaison calls and conversions.
+// Usage: pylBench [output.json [iteration scale [pool]]]
+// Results are written as JSON to the output file (or stdout). Passing
+// "pool" starts python with the pool allocator, to compare against pymalloc
+int main( int argc, char ** argv )
+{
+	// We may get an exception from the interpreter if something is amiss
+	try
+	{
+		Bench bench( argc > 2 ? atof( argv[2] ) : 1. );
+
+		// Declare a module with a function for each binding case
+		pyl::ModuleDef * pBenchMod = pylCreateMod( pylBench );
+		pylAddFnToMod( pBenchMod, Add );
+		pylAddFnToMod( pBenchMod, Consume );
+		pylAddFnToMod( pBenchMod, GetOne );
+		pylAddFnToMod( pBenchMod, DoNothing );
+		pylAddClassToMod( pBenchMod, Counter );
+		pylAddMemFnToMod( pBenchMod, Counter, Add, int, int );
+		pylAddMemFnToMod( pBenchMod, Counter, Set, void, int );
+		pylAddMemFnToMod( pBenchMod, Counter, Get, int );
+		pylAddMemFnToMod( pBenchMod, Counter, Reset, void );
+
+		pyl::InitOptions options;
+		options.bPoolAllocator = argc > 3 && std::string( argv[3] ) == "pool";
+		pyl::initialize( options );
+
+		// Python -> C++ calls
+		Counter counter;
+		pyl::run_cmd( "import pylBench" );
+		pyl::main().set_attr( "p_counter", &counter );
+		pyl::run_cmd( "counter = pylBench.Counter(p_counter)" );
+		pyl::run_cmd( "def py_noop(*args):\n    pass" );
+		DefineLoop( "loop_py_noop", "py_noop(1, 2)" );
+		DefineLoop( "loop_case1", "pylBench.Add(1, 2)" );
+		DefineLoop( "loop_case2", "pylBench.Consume(1, 2)" );
+		DefineLoop( "loop_case3", "pylBench.GetOne()" );
+		DefineLoop( "loop_case4", "pylBench.DoNothing()" );
+		DefineLoop( "loop_mem_case1", "counter.Add(1)" );
+		DefineLoop( "loop_mem_case2", "counter.Set(1)" );
+		DefineLoop( "loop_mem_case3", "counter.Get()" );
+		DefineLoop( "loop_mem_case4", "counter.Reset()" );
+
+		const size_t uCalls = 1000000;
+		bench.RunPython( "py_call_python_noop", uCalls, "loop_py_noop" );
+		bench.RunPython( "py_call_case1_ret_args", uCalls, "loop_case1" );
+		bench.RunPython( "py_call_case2_void_args", uCalls, "loop_case2" );
+		bench.RunPython( "py_call_case3_ret_noargs", uCalls, "loop_case3" );
+		bench.RunPython( "py_call_case4_void_noargs", uCalls, "loop_case4" );
+		bench.RunPython( "py_call_mem_case1_ret_args", uCalls, "loop_mem_case1" );
+		bench.RunPython( "py_call_mem_case2_void_args", uCalls, "loop_mem_case2" );
+		bench.RunPython( "py_call_mem_case3_ret_noargs", uCalls, "loop_mem_case3" );
+		bench.RunPython( "py_call_mem_case4_void_noargs", uCalls, "loop_mem_case4" );
+
+		// Allocation heavy python, named for the allocator it ran with
+		const std::string strAllocator = options.bPoolAllocator ? "_pool" : "_pymalloc";
+		DefineLoop( "loop_alloc_small", "d = {'a': [i, i + 1], 'b': (i, str(i))}" );
+		pyl::run_cmd( "import threading\ndef thread_work():\n    d = {str(i): [i] for i in range(100)}" );
+		DefineLoop( "loop_alloc_threads", "t = threading.Thread(target=thread_work); t.start(); t.join()" );
+		bench.RunPython( "py_alloc_small_objects" + strAllocator, uCalls, "loop_alloc_small" );
+		bench.RunPython( "py_alloc_short_lived_threads" + strAllocator, uCalls / 1000, "loop_alloc_threads" );
+
+		// C++ -> Python calls
+		pyl::Object obNoop = pyl::main().get_attr( "py_noop" );
+		bench.Run( "object_call_operator_noargs", uCalls, [&obNoop]() { obNoop(); } );
+		bench.Run( "object_call_operator_args", uCalls, [&obNoop]() { obNoop( 1, 2.5 ); } );
+		bench.Run( "object_call_by_name_noargs", uCalls, []() { pyl::main().call( "py_noop" ); } );
+		bench.Run( "object_call_by_name_args", uCalls, []() { pyl::main().call( "py_noop", 1, 2.5 ); } );
+
+		// Attribute access
+		pyl::main().set_attr( "x", 1 );
+		bench.Run( "get_attr", uCalls, []() { pyl::main().get_attr( "x" ); } );
+		bench.Run( "get_attr_convert", uCalls, []() { [[maybe_unused]] int x = pyl::main().get_attr( "x" ); } );
+		bench.Run( "set_attr", uCalls, []() { pyl::main().set_attr( "x", 1 ); } );
+
+		// Conversions in both directions, for each supported type
+		const size_t uConversions = 100000;
+		const int N = 100;
+		std::vector<int> vInts( N );
+		std::list<double> liDoubles;
+		std::map<int, std::string> mapStrings;
+		std::set<int> setInts;
+		std::unordered_map<int, std::string> umapStrings;
+		std::unordered_set<int> usetInts;
+		for ( int i = 0; i < N; i++ )
+		{
+			vInts[i] = i;
+			liDoubles.push_back( i );
+			mapStrings[i] = std::to_string( i );
+			setInts.insert( i );
+			umapStrings[i] = std::to_string( i );
+			usetInts.insert( i );
+		}
+		std::array<float, 4> arFloats{ { 1.f, 2.f, 3.f, 4.f } };
+		std::tuple<int, double, std::string> tup( 1, 2., "three" );
+		std::string strBytes( 1000, 'x' );
+		std::vector<char> vBytes( 1000, 'x' );
+		std::wstring wstrChars( 1000, L'x' );
+		std::u16string u16strChars( 1000, u'\u00e9' );
+
+		// Allocates a python object from C++ data, then converts it back
+		auto benchConversion = [&bench, uConversions]( std::string strName, auto& val, size_t uScale )
+		{
+			auto valCopy = val;
+			bench.Run( "alloc_pyobject_" + strName, uConversions / uScale, [&val]() {
+				pyl::unique_ptr upObj( pyl::alloc_pyobject( val ) );
+			} );
+			pyl::unique_ptr upObj( pyl::alloc_pyobject( val ) );
+			// Conversions can inline entirely, so keep their results
+			volatile bool bConverted( false );
+			bench.Run( "convert_" + strName, uConversions / uScale, [&upObj, &valCopy, &bConverted]() {
+				bConverted = pyl::convert( upObj.get(), valCopy );
+			} );
+		};
+
+		int i( 1 );
+		double d( 1. );
+		float f( 1.f );
+		bool b( true );
+		benchConversion( "int", i, 1 );
+		benchConversion( "double", d, 1 );
+		benchConversion( "float", f, 1 );
+		benchConversion( "bool", b, 1 );
+		benchConversion( "string_1000", strBytes, 1 );
+		benchConversion( "vector_char_1000", vBytes, 1 );
+		benchConversion( "wstring_1000", wstrChars, 1 );
+		benchConversion( "u16string_1000", u16strChars, 1 );
+		benchConversion( "vector_int_100", vInts, 10 );
+		benchConversion( "list_double_100", liDoubles, 10 );
+		benchConversion( "map_int_string_100", mapStrings, 10 );
+		benchConversion( "set_int_100", setInts, 10 );
+		benchConversion( "unordered_map_int_string_100", umapStrings, 10 );
+		benchConversion( "unordered_set_int_100", usetInts, 10 );
+
+		// These can only be converted from python
+		pyl::run_cmd( "arr = [1., 2., 3., 4.]" );
+		pyl::run_cmd( "tup = (1, 2., 'three')" );
+		pyl::Object obArr = pyl::main().get_attr( "arr" );
+		pyl::Object obTup = pyl::main().get_attr( "tup" );
+		bench.Run( "convert_array_float_4", uConversions, [&obArr, &arFloats]() { obArr.convert( arFloats ); } );
+		bench.Run( "convert_tuple_int_double_string", uConversions, [&obTup, &tup]() { obTup.convert( tup ); } );
+
+		// Structs, against building a named tuple from python
+		Fill fill{ 1, 2., "three" };
+		benchConversion( "struct_int_double_string", fill, 1 );
+		pyl::run_cmd( "import collections\nNTFill = collections.namedtuple('NTFill', 'nID dPrice strSymbol')" );
+		bench.Run( "call_namedtuple_int_double_string", uConversions, [&fill]() {
+			pyl::main().call( "NTFill", fill.nID, fill.dPrice, fill.strSymbol );
+		} );
+
+		// Large strings, copied and viewed
+		pyl::run_cmd( "S1M = 'x' * (1 << 20)" );
+		pyl::Object obS1M = pyl::main().get_attr( "S1M" );
+		std::string strS1M;
+		std::string_view svS1M;
+		bench.Run( "convert_string_1M", uConversions / 100, [&obS1M, &strS1M]() { obS1M.convert( strS1M ); } );
+		bench.Run( "convert_string_view_1M", uConversions, [&obS1M, &svS1M]() { obS1M.convert( svS1M ); } );
+		strS1M.assign( 1 << 20, 'x' );
+		bench.Run( "alloc_pyobject_string_1M", uConversions / 100, [&strS1M]() { pyl::unique_ptr upObj( pyl::alloc_pyobject( strS1M ) ); } );
+		bench.Run( "alloc_buffer_1M", uConversions / 100, []() { pyl::alloc_buffer( std::unique_ptr<uint8_t[]>( new uint8_t[1 << 20] ), 1 << 20 ); } );
+
+		// Mapping a file and viewing it from C++, against copying it into a vector
+		const std::string strMapFile = "pylBench_map.bin";
+		std::ofstream( strMapFile, std::ios::binary ) << strS1M;
+		bench.Run( "map_file_1M", uConversions / 100, [&strMapFile]() { pyl::map_file( strMapFile ); } );
+		pyl::Object obMapped = pyl::map_file( strMapFile );
+		pyl::Span<const char> spMapped;
+		std::vector<char> vMapped;
+		bench.Run( "convert_span_1M", uConversions, [&obMapped, &spMapped]() { obMapped.convert( spMapped ); } );
+		bench.Run( "convert_vector_char_1M", uConversions / 100, [&obMapped, &vMapped]() { obMapped.convert( vMapped ); } );
+		obMapped.reset();
+		std::remove( strMapFile.c_str() );
+
+		// Records as columns, against a list of rows
+		std::vector<Trade> vTrades( 1000 );
+		std::vector<std::pair<int64_t, double>> vRows( 1000 );
+		for ( int i = 0; i < 1000; i++ )
+		{
+			vTrades[i] = { i, 1.5 * i, i % 100 };
+			vRows[i] = { i, 1.5 * i };
+		}
+		pyl::Columns<Trade> colTrades( vTrades );
+		benchConversion( "columns_3x1000", colTrades, 100 );
+		benchConversion( "vector_pair_1000", vRows, 100 );
+
+		// Handing items to python in batches through a channel, against calling python per item
+		pyl::Channel<double> channel( 1024 );
+		pyl::run_cmd( "def drain(ch):\n    return len(ch.pop(1000))\ndef take(x):\n    pass" );
+		pyl::Object obChannel = channel.GetPyObject();
+		pyl::Object obDrain = pyl::main().get_attr( "drain" );
+		pyl::Object obTake = pyl::main().get_attr( "take" );
+		bench.Run( "channel_push_pop_1000", uCalls / 1000, [&channel, &obChannel, &obDrain]() {
+			for ( int i = 0; i < 1000; i++ )
+				channel.TryPush( i );
+			obDrain( obChannel );
+		} );
+		bench.Run( "object_call_per_item_1000", uCalls / 1000, [&obTake]() {
+			for ( int i = 0; i < 1000; i++ )
+				obTake( double( i ) );
+		} );
+
+		// Sequences other than lists
+		pyl::run_cmd( "T100 = tuple(range(100))\nR100 = range(100)" );
+		pyl::Object obT100 = pyl::main().get_attr( "T100" );
+		pyl::Object obR100 = pyl::main().get_attr( "R100" );
+		bench.Run( "convert_vector_int_100_from_tuple", uConversions / 10, [&obT100, &vInts]() { obT100.convert( vInts ); } );
+		bench.Run( "convert_vector_int_100_from_range", uConversions / 10, [&obR100, &vInts]() { obR100.convert( vInts ); } );
+
+		// Indexing and iterating without converting
+		pyl::run_cmd( "L100 = list(range(100))\nD100 = {str(i): i for i in range(100)}" );
+		pyl::Object obL100 = pyl::main().get_attr( "L100" );
+		pyl::Object obD100 = pyl::main().get_attr( "D100" );
+		bench.Run( "object_index_list", uConversions, [&obL100]() { obL100[50]; } );
+		bench.Run( "object_index_dict", uConversions, [&obD100]() { obD100["50"]; } );
+		bench.Run( "object_at_list", uConversions, [&obL100]() { obL100.at( 50 ); } );
+		bench.Run( "object_at_dict", uConversions, [&obD100]() { obD100.at( "50" ); } );
+		bench.Run( "object_iterate_list_100", uConversions / 10, [&obL100]() { for ( pyl::ObjectRef o : obL100 ) (void) o; } );
+		bench.Run( "object_iterate_dict_100", uConversions / 10, [&obD100]() { for ( pyl::ObjectRef o : obD100 ) (void) o; } );
+		bench.Run( "object_copy", uCalls, [&obL100]() { pyl::Object obCopy( obL100 ); } );
+
+		// Exposing objects
+		bench.Run( "expose_object", uConversions, [&counter]() {
+			pyl::ModuleDef::GetModuleDef( "pylBench" )->Expose_Object( &counter, "exposed_counter" );
+		} );
+
+		// Running commands and scripts (the script is next to this file)
+		std::string strDirectory = pyl::GetModule( "os.path" ).call( "dirname", __FILE__ );
+		std::string strScriptPath = pyl::GetModule( "os.path" ).call( "join", strDirectory, "pylTestScript.py" );
+		bench.Run( "run_cmd", uConversions, []() { pyl::run_cmd( "x = 1" ); } );
+		bench.Run( "run_file", uConversions / 10, [strScriptPath]() { pyl::run_file( strScriptPath ); } );
+
+		// Write results
+		std::string strVersion = pyl::GetModule( "sys" ).get_attr( "version" );
+		strVersion = strVersion.substr( 0, strVersion.find( ' ' ) );
+		if ( argc > 1 )
+		{
+			std::ofstream out( argv[1] );
+			bench.Write( out, strVersion );
+		}
+		else
+			bench.Write( std::cout, strVersion );
+
+		// Shut down the interpreter
+		pyl::finalize();
+
+		return EXIT_SUCCESS;
+	}
+	// These exceptions are thrown when something in pyliaison
+	// goes wrong, but they're a child of std::runtime_error
+	catch ( pyl::runtime_error e )
+	{
+		std::cout << e.what() << std::endl;
+		pyl::print_error();
+		pyl::finalize();
+		return EXIT_FAILURE;
+	}
+}
@@ -0,0 +1,483 @@
+#include <pyliaison.h>
+#include <pylIterator.h>
+#include <pylBuffer.h>
+#include <pylChannel.h>
+#include <pylColumns.h>
+#include <pylRecord.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <functional>
+
+// Functions covering each of the _getPyFunc cases
+int Add( int a, int b ) { return a + b; }
+void Consume( int, int ) {}
+int GetOne() { return 1; }
+void DoNothing() {}
+
+// Functions that move containers and strings across
+size_t TakeVector( std::vector<int> v ) { return v.size(); }
+std::vector<int> MakeVector() { return { 1, 2, 3, 4, 5 }; }
+size_t TakeMap( std::map<int, std::string> m ) { return m.size(); }
+std::map<int, std::string> MakeMap() { return { { 1, "one" }, { 2, "two" } }; }
+size_t TakeSet( std::set<int> s ) { return s.size(); }
+std::set<int> MakeSet() { return { 1, 2, 3 }; }
+std::string Echo( std::string s ) { return s; }
+
+// Class covering each of the _getPyFunc_Mem cases
+class Counter
+{
+	int n;
+public:
+	Counter() : n( 0 ) {}
+	int Add( int a ) { return n += a; }
+	void Set( int a ) { n = a; }
+	int Get() { return n; }
+	void Reset() { n = 0; }
+};
+
+// A record converted a column at a time
+struct Trade
+{
+	int64_t nID;
+	double dPrice;
+	int32_t nQuantity;
+	std::string strSymbol;
+};
+PYL_RECORD( Trade, nID, dPrice, nQuantity, strSymbol )
+
+// A struct converted to and from a struct sequence
+struct Fill
+{
+	int64_t nID;
+	double dPrice;
+	std::string strSymbol;
+};
+PYL_STRUCT( Fill, nID, dPrice, strSymbol )
+
+// Runs each conversion and call path many times and checks that nothing grows.
+// After a warm up, we take a snapshot of the memory traced by tracemalloc, the
+// number of each type of object tracked by the garbage collector and the reference
+// counts of the objects being converted, then run the path and look again. Anything
+// that leaks once per iteration grows with the iteration count, so a path fails if
+// any of these grow by more than a small fraction of it.
+class Soak
+{
+	struct Snapshot
+	{
+		size_t uTracedBytes;
+		std::map<std::string, long> mapTypeCounts;
+		Py_ssize_t nRefCount;
+	};
+
+	pyl::Object m_obSnapshot;  /*!< Python function returning (traced bytes, {type name : count})*/
+	double m_dScale;           /*!< Scales the number of iterations*/
+	int m_nFailures;
+
+	// Sum the reference counts of some objects and whatever they contain
+	static Py_ssize_t getRefCount( const std::vector<PyObject *>& vWatched )
+	{
+		Py_ssize_t nRefs( 0 );
+		for ( PyObject * pObj : vWatched )
+		{
+			nRefs += Py_REFCNT( pObj );
+			if ( PyDict_Check( pObj ) )
+			{
+				PyObject *pKey, *pVal;
+				Py_ssize_t nPos( 0 );
+				while ( PyDict_Next( pObj, &nPos, &pKey, &pVal ) )
+					nRefs += Py_REFCNT( pKey ) + Py_REFCNT( pVal );
+			}
+			else if ( PyList_Check( pObj ) || PyTuple_Check( pObj ) || PyAnySet_Check( pObj ) )
+			{
+				// Iterating takes references, so count what we have before we start
+				pyl::unique_ptr upSeq( PySequence_List( pObj ) );
+				for ( Py_ssize_t i = 0; i < PyList_GET_SIZE( upSeq.get() ); i++ )
+					nRefs += Py_REFCNT( PyList_GET_ITEM( upSeq.get(), i ) ) - 1;
+			}
+		}
+		return nRefs;
+	}
+
+	Snapshot takeSnapshot( const std::vector<PyObject *>& vWatched )
+	{
+		Snapshot snap;
+		pyl::Object obRet = m_obSnapshot();
+		std::tuple<size_t, std::map<std::string, long>> tupRet;
+		if ( !obRet.convert( tupRet ) )
+			throw pyl::runtime_error( "Unable to take soak snapshot" );
+		snap.uTracedBytes = std::get<0>( tupRet );
+		snap.mapTypeCounts = std::get<1>( tupRet );
+		snap.nRefCount = getRefCount( vWatched );
+		return snap;
+	}
+
+public:
+	Soak( double dScale ) : m_dScale( dScale ), m_nFailures( 0 )
+	{
+		std::string strCmd =
+			"import gc, tracemalloc\n"
+			"from collections import Counter\n"
+			"tracemalloc.start()\n"
+			"def soak_snapshot():\n"
+			"    gc.collect()\n"
+			"    counts = dict(Counter(type(o).__name__ for o in gc.get_objects()))\n"
+			"    return (tracemalloc.get_traced_memory()[0], counts)\n";
+		pyl::run_cmd( strCmd );
+		m_obSnapshot = pyl::main().get_attr( "soak_snapshot" );
+	}
+
+	// Run fn the given number of times (scaled), watching the reference counts of vWatched
+	// (which must be kept alive elsewhere)
+	void Run( std::string strName, size_t uIterations, std::function<void( size_t )> fn, std::vector<PyObject *> vWatched = {} )
+	{
+		uIterations = std::max<size_t>( 1, size_t( uIterations * m_dScale ) );
+
+		// Warm up so that caches and free lists are filled before we look
+		fn( std::max<size_t>( 1, uIterations / 10 ) );
+		Snapshot before = takeSnapshot( vWatched );
+		fn( uIterations );
+		Snapshot after = takeSnapshot( vWatched );
+
+		// Anything that grows by more than this is leaking
+		const long nAllowed = long( std::max<size_t>( 16, uIterations / 100 ) );
+		const long nAllowedBytes = 256 * 1024 + 8 * nAllowed;
+
+		long nBytesGrowth = long( after.uTracedBytes ) - long( before.uTracedBytes );
+		long nRefGrowth = long( after.nRefCount - before.nRefCount );
+		std::string strWorstType;
+		long nWorstTypeGrowth( 0 );
+		for ( auto& typeCount : after.mapTypeCounts )
+		{
+			long nGrowth = typeCount.second - before.mapTypeCounts[typeCount.first];
+			if ( nGrowth > nWorstTypeGrowth )
+			{
+				strWorstType = typeCount.first;
+				nWorstTypeGrowth = nGrowth;
+			}
+		}
+
+		bool bPassed = nBytesGrowth <= nAllowedBytes && nRefGrowth <= nAllowed && nWorstTypeGrowth <= nAllowed;
+		if ( !bPassed )
+			m_nFailures++;
+
+		std::cout << ( bPassed ? "ok   " : "FAIL " ) << std::left << std::setw( 36 ) << strName << std::right
+				  << " iterations: " << std::setw( 8 ) << uIterations
+				  << " bytes: " << std::setw( 9 ) << nBytesGrowth
+				  << " refs: " << std::setw( 8 ) << nRefGrowth;
+		if ( nWorstTypeGrowth )
+			std::cout << " " << strWorstType << ": " << nWorstTypeGrowth;
+		std::cout << std::endl;
+	}
+
+	// Run a python loop that exercises some path n times
+	void RunPython( std::string strName, size_t uIterations, std::string strCall, std::vector<PyObject *> vWatched = {} )
+	{
+		std::string strLoopFn = "soak_" + strName;
+		std::string strCmd = "def " + strLoopFn + "(n):\n" +
+							 "    for i in range(n):\n" +
+							 "        " + strCall + "\n";
+		pyl::run_cmd( strCmd );
+		pyl::Object obLoop = pyl::main().get_attr( strLoopFn );
+		Run( strName, uIterations, [&obLoop]( size_t n ) { obLoop( n ); }, vWatched );
+	}
+
+	int GetFailures() const { return m_nFailures; }
+};
+
+// Runs every conversion and call path millions of times and fails if anything leaks.
+// Usage: pylSoak [iteration scale]
+int main( int argc, char ** argv )
+{
+	// We may get an exception from the interpreter if something is amiss
+	try
+	{
+		// Declare a module with a function for each binding case
+		pyl::ModuleDef * pSoakMod = pylCreateMod( pylSoak );
+		pylAddFnToMod( pSoakMod, Add );
+		pylAddFnToMod( pSoakMod, Consume );
+		pylAddFnToMod( pSoakMod, GetOne );
+		pylAddFnToMod( pSoakMod, DoNothing );
+		pylAddFnToMod( pSoakMod, TakeVector );
+		pylAddFnToMod( pSoakMod, MakeVector );
+		pylAddFnToMod( pSoakMod, TakeMap );
+		pylAddFnToMod( pSoakMod, MakeMap );
+		pylAddFnToMod( pSoakMod, TakeSet );
+		pylAddFnToMod( pSoakMod, MakeSet );
+		pylAddFnToMod( pSoakMod, Echo );
+		pylAddClassToMod( pSoakMod, Counter );
+		pylAddMemFnToMod( pSoakMod, Counter, Add, int, int );
+		pylAddMemFnToMod( pSoakMod, Counter, Set, void, int );
+		pylAddMemFnToMod( pSoakMod, Counter, Get, int );
+		pylAddMemFnToMod( pSoakMod, Counter, Reset, void );
+
+		pyl::initialize();
+
+		Soak soak( argc > 1 ? atof( argv[1] ) : 1. );
+		const size_t N = 100000;
+
+		// Python -> C++ calls
+		Counter counter;
+		std::string strSetup =
+			"import pylSoak\n"
+			"counter = pylSoak.Counter(p_counter)\n"
+			"L = [1, 2, 3, 4, 5]\n"
+			"D = {1: 'one', 2: 'two'}\n"
+			"S = {1, 2, 3}\n"
+			"str_val = 'hello'\n";
+		pyl::main().set_attr( "p_counter", &counter );
+		pyl::run_cmd( strSetup );
+
+		// These are kept alive by the main module
+		std::vector<PyObject *> vContainers{ pyl::main().get_attr( "L" ).get(), pyl::main().get_attr( "D" ).get(), pyl::main().get_attr( "S" ).get() };
+
+		soak.RunPython( "call_case1", N, "pylSoak.Add(1, 2)" );
+		soak.RunPython( "call_case2", N, "pylSoak.Consume(1, 2)" );
+		soak.RunPython( "call_case3", N, "pylSoak.GetOne()" );
+		soak.RunPython( "call_case4", N, "pylSoak.DoNothing()" );
+		soak.RunPython( "call_mem_case1", N, "counter.Add(1)" );
+		soak.RunPython( "call_mem_case2", N, "counter.Set(1)" );
+		soak.RunPython( "call_mem_case3", N, "counter.Get()" );
+		soak.RunPython( "call_mem_case4", N, "counter.Reset()" );
+		soak.RunPython( "call_vector_arg", N, "pylSoak.TakeVector(L)", vContainers );
+		soak.RunPython( "call_vector_ret", N, "pylSoak.MakeVector()" );
+		soak.RunPython( "call_map_arg", N, "pylSoak.TakeMap(D)", vContainers );
+		soak.RunPython( "call_map_ret", N, "pylSoak.MakeMap()" );
+		soak.RunPython( "call_set_arg", N, "pylSoak.TakeSet(S)", vContainers );
+		soak.RunPython( "call_set_ret", N, "pylSoak.MakeSet()" );
+		soak.RunPython( "call_string", N, "pylSoak.Echo(str_val)" );
+
+		// C++ -> Python calls and attribute access
+		pyl::run_cmd( "def py_noop(*args):\n    pass" );
+		pyl::Object obNoop = pyl::main().get_attr( "py_noop" );
+		soak.Run( "object_call_noargs", N, [&obNoop]( size_t n ) { for ( size_t i = 0; i < n; i++ ) obNoop(); }, { obNoop.get() } );
+		soak.Run( "object_call_args", N, [&obNoop]( size_t n ) { for ( size_t i = 0; i < n; i++ ) obNoop( 1, 2.5, std::string( "three" ) ); }, { obNoop.get() } );
+		soak.Run( "object_call_by_name", N, []( size_t n ) { for ( size_t i = 0; i < n; i++ ) pyl::main().call( "py_noop", 1 ); } );
+		soak.Run( "get_attr", N, []( size_t n ) { for ( size_t i = 0; i < n; i++ ) pyl::main().get_attr( "L" ); }, vContainers );
+		soak.Run( "has_attr", N, []( size_t n ) { for ( size_t i = 0; i < n; i++ ) pyl::main().has_attr( "L" ); }, vContainers );
+		soak.Run( "set_attr", N, []( size_t n ) { for ( size_t i = 0; i < n; i++ ) pyl::main().set_attr( "x", 12345 ); } );
+		soak.Run( "get_module", N, []( size_t n ) { for ( size_t i = 0; i < n; i++ ) pyl::GetModule( "sys" ); } );
+
+		// Indexing and iterating
+		pyl::Object obL = pyl::main().get_attr( "L" ), obD = pyl::main().get_attr( "D" ), obS = pyl::main().get_attr( "S" );
+		soak.Run( "object_index", N, [&obL, &obD]( size_t n ) { for ( size_t i = 0; i < n; i++ ) { obL[-1]; obD[1]; obL.at( 0 ); } }, vContainers );
+		soak.Run( "object_iterate", N / 10, [&obL, &obD, &obS]( size_t n ) {
+			for ( size_t i = 0; i < n; i++ )
+			{
+				for ( pyl::ObjectRef o : obL ) pyl::Object obHeld( o );
+				for ( pyl::ObjectRef o : obD ) (void) o;
+				for ( pyl::ObjectRef o : obS ) (void) o;
+			}
+		}, vContainers );
+		soak.Run( "object_copy", N, [&obL]( size_t n ) {
+			for ( size_t i = 0; i < n; i++ )
+			{
+				pyl::Object obCopy( obL ), obAssigned;
+				obAssigned = obCopy;
+				pyl::Object obMoved( std::move( obCopy ) );
+			}
+		}, vContainers );
+
+		// Conversions from python
+		auto soakConvert = [&soak, N]( std::string strName, std::string strExpr, auto * pVal )
+		{
+			std::string strCmd = "soak_val = " + strExpr;
+			pyl::run_cmd( strCmd );
+			pyl::Object obVal = pyl::main().get_attr( "soak_val" );
+			soak.Run( "convert_" + strName, N, [&obVal, pVal]( size_t n ) {
+				for ( size_t i = 0; i < n; i++ )
+					obVal.convert( *pVal );
+			}, { obVal.get() } );
+		};
+		int i; double d; float f; bool b; char c;
+		std::string str; std::string_view sv; std::wstring wstr; std::u16string u16str;
+		std::vector<char> vChars; std::vector<int> vInts; std::list<double> liDoubles; std::array<float, 4> arFloats;
+		std::map<int, std::string> mapStrings; std::set<int> setInts;
+		std::unordered_map<int, std::string> umapStrings; std::unordered_set<int> usetInts; std::deque<int> dqInts;
+		std::tuple<int, double, std::string> tup; std::pair<int, std::string> pr;
+		pyl::Columns<Trade> colTrades;
+		pyl::run_cmd( "import array" );
+		Fill fill;
+		pyl::run_cmd( "import collections\nNTFill = collections.namedtuple('NTFill', 'nID dPrice strSymbol')" );
+		std::optional<int> optInt; std::variant<std::monostate, int, std::string> varIntString;
+		pyl::Object obj;
+		Counter * pCounter( nullptr );
+		soakConvert( "int", "12345", &i );
+		soakConvert( "double", "1.5", &d );
+		soakConvert( "float", "1.5", &f );
+		soakConvert( "bool", "True", &b );
+		soakConvert( "char", "'c'", &c );
+		soakConvert( "string", "'hello'", &str );
+		soakConvert( "string_bytes", "b'hello'", &str );
+		soakConvert( "string_bytearray", "bytearray(b'hello')", &str );
+		soakConvert( "string_embedded_nul", "'hel\\0lo'", &str );
+		soakConvert( "string_view", "'hello'", &sv );
+		soakConvert( "string_view_bytes", "b'hello'", &sv );
+		soakConvert( "wstring", "'hello'", &wstr );
+		soakConvert( "wstring_wide", "'x\\U0001F600y'", &wstr );
+		soakConvert( "wstring_bytes", "b'caf\\xc3\\xa9'", &wstr );
+		soakConvert( "wstring_bad_bytes", "b'\\xff'", &wstr );
+		soakConvert( "u16string", "'x\\U0001F600y'", &u16str );
+		soakConvert( "vector_char", "b'hello'", &vChars );
+		soakConvert( "vector_int", "[1, 2, 3]", &vInts );
+		soakConvert( "vector_int_from_tuple", "(1, 2, 3)", &vInts );
+		soakConvert( "vector_int_from_range", "range(100)", &vInts );
+		soakConvert( "vector_int_bad_item", "(1, 2, 'three')", &vInts );
+		soakConvert( "list_double", "[1., 2., 3.]", &liDoubles );
+		soakConvert( "array_float", "[1., 2., 3., 4.]", &arFloats );
+		soakConvert( "array_float_from_tuple", "(1., 2., 3., 4.)", &arFloats );
+		soakConvert( "map_int_string", "{1: 'one', 2: 'two'}", &mapStrings );
+		soakConvert( "set_int", "{1, 2, 3}", &setInts );
+		soakConvert( "set_int_from_list", "[1, 2, 3]", &setInts );
+		soakConvert( "unordered_map_int_string", "{1: 'one', 2: 'two'}", &umapStrings );
+		soakConvert( "unordered_set_int", "{1, 2, 3}", &usetInts );
+		soakConvert( "unordered_set_int_from_list", "[1, 2, 3]", &usetInts );
+		soakConvert( "deque_int", "[1, 2, 3]", &dqInts );
+		soakConvert( "tuple", "(1, 2., 'three')", &tup );
+		soakConvert( "columns", "{'nID': memoryview(array.array('q', [1, 2])), 'dPrice': [1.5, 2.5], 'nQuantity': (10, 20), 'strSymbol': ['A', 'B']}", &colTrades );
+		soakConvert( "columns_ragged", "{'nID': [1, 2], 'dPrice': [1.5], 'nQuantity': (10, 20), 'strSymbol': ['A', 'B']}", &colTrades );
+		soakConvert( "struct_from_namedtuple", "NTFill(1, 1.5, 'A')", &fill );
+		soakConvert( "struct_bad_item", "(1, 'one', 'A')", &fill );
+		soakConvert( "pair", "(1, 'one')", &pr );
+		soakConvert( "optional_none", "None", &optInt );
+		soakConvert( "optional_int", "12345", &optInt );
+		soakConvert( "variant_none", "None", &varIntString );
+		soakConvert( "variant_string", "'hello'", &varIntString );
+		soakConvert( "variant_bad", "1.5", &varIntString );
+		soakConvert( "object", "[1, 2, 3]", &obj );
+		soakConvert( "pointer", "p_counter", &pCounter );
+		obj.reset();
+
+		// Allocations from C++
+		auto soakAlloc = [&soak, N]( std::string strName, auto val )
+		{
+			soak.Run( "alloc_" + strName, N, [val]( size_t n ) {
+				for ( size_t i = 0; i < n; i++ )
+					pyl::unique_ptr upObj( pyl::alloc_pyobject( val ) );
+			} );
+		};
+		soakAlloc( "int", 12345 );
+		soakAlloc( "double", 1.5 );
+		soakAlloc( "float", 1.5f );
+		soakAlloc( "bool", true );
+		soakAlloc( "char", 'c' );
+		soakAlloc( "string", std::string( "hello" ) );
+		soakAlloc( "cstring", "hello" );
+		soakAlloc( "string_view", std::string_view( "hello" ) );
+		soakAlloc( "wstring", std::wstring( L"h\u00e9llo" ) );
+		soakAlloc( "u16string", std::u16string( u"x\U0001F600y" ) );
+		soakAlloc( "vector_char", std::vector<char>{ 'a', 'b', 'c' } );
+		soakAlloc( "vector_int", std::vector<int>{ 1, 2, 3 } );
+		soakAlloc( "list_double", std::list<double>{ 1., 2., 3. } );
+		soakAlloc( "map_int_string", std::map<int, std::string>{ { 1, "one" }, { 2, "two" } } );
+		soakAlloc( "set_int", std::set<int>{ 1, 2, 3 } );
+		soakAlloc( "unordered_map_int_string", std::unordered_map<int, std::string>{ { 1, "one" }, { 2, "two" } } );
+		soakAlloc( "unordered_set_int", std::unordered_set<int>{ 1, 2, 3 } );
+		soakAlloc( "deque_int", std::deque<int>{ 1, 2, 3 } );
+		soakAlloc( "pair", std::pair<int, std::string>( 1, "one" ) );
+		soakAlloc( "optional_none", std::optional<int>() );
+		soakAlloc( "optional_int", std::optional<int>( 12345 ) );
+		soakAlloc( "variant_string", std::variant<std::monostate, int, std::string>( "hello" ) );
+		soakAlloc( "columns", pyl::Columns<Trade>( { { 1, 1.5, 10, "A" }, { 2, 2.5, 20, "B" } } ) );
+		soakAlloc( "struct", Fill{ 1, 1.5, "A" } );
+		soakAlloc( "pointer", &counter );
+
+		// Streaming generators in both directions
+		std::string strGen = "def soak_gen(n):\n    for i in range(n):\n        yield [i]\n";
+		pyl::run_cmd( strGen );
+		pyl::Object obGen = pyl::main().get_attr( "soak_gen" );
+		soak.Run( "iterate_generator", N, [&obGen]( size_t n ) {
+			for ( const std::vector<int>& v : pyl::iterate<std::vector<int>>( obGen( n ), 16 ) )
+				(void) v;
+		}, { obGen.get() } );
+		soak.Run( "make_iterator", N, []( size_t n ) {
+			size_t i( 0 );
+			pyl::Object obIter = pyl::make_iterator<std::vector<int>>( [&i, n]() -> std::optional<std::vector<int>> {
+				if ( i < n ) return std::vector<int>{ int( i++ ) };
+				return std::nullopt;
+			}, 16 );
+			pyl::main().set_attr( "soak_iter", obIter );
+			pyl::run_cmd( "for x in soak_iter: pass" );
+			PyObject_DelAttrString( pyl::main().get(), "soak_iter" );
+		} );
+
+		// Buffers handed to python, which python frees
+		std::string strBuf = "def soak_buf(mv):\n    if not mv.readonly: mv[0] = mv[-1]\n    return bytes(mv[:4])\n";
+		pyl::run_cmd( strBuf );
+		pyl::Object obBuf = pyl::main().get_attr( "soak_buf" );
+		soak.Run( "alloc_buffer", N, [&obBuf]( size_t n ) {
+			for ( size_t i = 0; i < n; i++ )
+			{
+				obBuf( pyl::alloc_buffer( std::vector<char>( 100, 'x' ) ) );
+				obBuf( pyl::alloc_buffer( std::string( 100, 'x' ), true ) );
+				obBuf( pyl::alloc_buffer( std::unique_ptr<uint8_t[]>( new uint8_t[100]() ), 100, true ) );
+				std::vector<char> vCopy = obBuf( pyl::alloc_buffer( std::vector<double>( 10, 1.5 ) ) );
+			}
+		}, { obBuf.get() } );
+
+		// Mapped files, viewed from both sides
+		const std::string strMapFile = "pylSoak_map.bin";
+		std::ofstream( strMapFile, std::ios::binary ) << std::string( 4096, 'x' );
+		soak.Run( "map_file", N / 10, [&obBuf, &strMapFile]( size_t n ) {
+			for ( size_t i = 0; i < n; i++ )
+			{
+				pyl::Object obMapped = pyl::map_file( strMapFile, pyl::MapMode::CopyOnWrite );
+				obBuf( obMapped );
+				pyl::Span<char> spMapped = obMapped;
+				spMapped[0] = 'y';
+			}
+		}, { obBuf.get() } );
+		std::remove( strMapFile.c_str() );
+
+		// Channels drained by python
+		std::string strDrain = "def soak_drain(ch):\n    return sum(len(b) for b in ch)\n";
+		pyl::run_cmd( strDrain );
+		pyl::Object obDrain = pyl::main().get_attr( "soak_drain" );
+		soak.Run( "channel", N / 10, [&obDrain]( size_t n ) {
+			for ( size_t i = 0; i < n; i++ )
+			{
+				pyl::Channel<int> channel( 128 );
+				for ( int j = 0; j < 100; j++ )
+					channel.TryPush( j );
+				channel.Close();
+				obDrain( channel.GetPyObject() );
+			}
+		}, { obDrain.get() } );
+
+		// Exposing objects, running commands and loading scripts
+		soak.Run( "expose_object", N / 10, [&counter]( size_t n ) {
+			for ( size_t i = 0; i < n; i++ )
+				pyl::ModuleDef::GetModuleDef( "pylSoak" )->Expose_Object( &counter, "exposed_counter" );
+		} );
+		soak.Run( "run_cmd", N / 10, []( size_t n ) {
+			std::string strCmd = "x = [1, 2, 3]";
+			for ( size_t i = 0; i < n; i++ )
+				pyl::run_cmd( strCmd );
+		} );
+
+		// The script is next to this file
+		std::string strDirectory = pyl::GetModule( "os.path" ).call( "dirname", __FILE__ );
+		std::string strScriptPath = pyl::GetModule( "os.path" ).call( "join", strDirectory, "pylTestScript.py" );
+		soak.Run( "load_script", N / 10, [strScriptPath]( size_t n ) {
+			for ( size_t i = 0; i < n; i++ )
+				pyl::Object obScript( strScriptPath );
+		} );
+
+		int nFailures = soak.GetFailures();
+		std::cout << ( nFailures ? std::to_string( nFailures ) + " paths leaked" : "No leaks found" ) << std::endl;
+
+		// Shut down the interpreter
+		pyl::finalize();
+
+		return nFailures ? EXIT_FAILURE : EXIT_SUCCESS;
+	}
+	// These exceptions are thrown when something in pyliaison
+	// goes wrong, but they're a child of std::runtime_error
+	catch ( pyl::runtime_error e )
+	{
+		std::cout << e.what() << std::endl;
+		pyl::print_error();
+		pyl::finalize();
+		return EXIT_FAILURE;
+	}
+}
@@ -23,6 +23,16 @@ public:
 	int GetY() const { return y; }
 };
 
+// Exposed in its own module, which checks that classes
+// can be found before they've been used
+class Baz
+{
+	int z;
+public:
+	Baz() : z( 0 ) {}
+	int GetZ() const { return z; }
+};
+
 // The purpose of this example is to show how code 
 // written in a python script can be used in C++ code 
 int main( int argc, char ** argv )
@@ -46,6 +56,10 @@ int main( int argc, char ** argv )
 		pylAddMemFnToMod( pFooMod, Foo, SetY, void, int );
 		pylAddMemFnToMod( pFooMod, Foo, GetY, int );
 
+		pyl::ModuleDef * pBazMod = pylCreateMod( pylBaz );
+		pylAddClassToMod( pBazMod, Baz );
+		pylAddMemFnToMod( pBazMod, Baz, GetZ, int );
+
 		// Initialize the python interpreter
 		pyl::initialize();
 
@@ -75,6 +89,18 @@ int main( int argc, char ** argv )
 		pyl::run_cmd( "f2.SetY(54321)" );
 		pyl::run_cmd( "print(f2.GetY())" );
 
+		// Classes aren't readied until they're used, but they're still found
+		// by attribute access, dir() and star imports
+		pyl::run_cmd( "\
+import pylBaz                                               \n\
+baz_ns = {}                                                 \n\
+exec( 'from pylBaz import *', baz_ns )                      \n\
+baz_found = [ 'Baz' in dir( pylBaz ), 'Baz' in baz_ns,      \n\
+              baz_ns.get( 'Baz' ) is pylBaz.Baz ]" );
+		std::vector<bool> vBazFound = pyl::main().get_attr( "baz_found" );
+		if ( vBazFound != std::vector<bool>{ true, true, true } )
+			throw pyl::runtime_error( "Exposed class wasn't found before it was used" );
+
 		// Here we declare a class called Bar in the main module
 		// (note the in line class definition)
 		pyl::run_cmd( "\
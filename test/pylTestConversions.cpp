@@ -0,0 +1,341 @@
+#include <pyliaison.h>
+#include <pylBuffer.h>
+#include <pylColumns.h>
+#include <iostream>
+#include <deque>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+// Throws if a check fails, so that the test fails
+static void check( bool bPassed, std::string strWhat )
+{
+	if ( !bPassed )
+		throw pyl::runtime_error( "Check failed: " + strWhat );
+}
+
+// Returns true if fn throws a pyl::runtime_error, and makes sure no python error is left set
+template <typename F>
+static bool throws( F fn )
+{
+	try
+	{
+		fn();
+	}
+	catch ( pyl::runtime_error& )
+	{
+		check( PyErr_Occurred() == nullptr, "python error left set after an exception" );
+		return true;
+	}
+	return false;
+}
+
+// Evaluate a python expression in the main module
+static pyl::Object eval( std::string strExpr )
+{
+	std::string strCmd = "_eval_result = " + strExpr;
+	pyl::run_cmd( strCmd );
+	return pyl::main().get_attr( "_eval_result" );
+}
+
+// Convert the value of a python expression, returning false if it doesn't convert
+template <typename T>
+static bool from_python( std::string strExpr, T& val )
+{
+	return eval( strExpr ).convert( val );
+}
+
+// Hand a value to python as v, then evaluate a python expression about it
+template <typename T>
+static bool to_python( const T& val, std::string strCheck )
+{
+	pyl::main().set_attr( "v", val );
+	return eval( "bool(" + strCheck + ")" ).as<bool>();
+}
+
+// A record whose fields become columns of each kind
+struct Reading
+{
+	int32_t nSensor;
+	double dValue;
+	bool bValid;
+	uint16_t uFlags;
+	std::string strUnit;
+};
+PYL_RECORD( Reading, nSensor, dValue, bValid, uFlags, strUnit )
+
+// Whether two readings hold the same values
+static bool same_reading( const Reading& a, const Reading& b )
+{
+	return a.nSensor == b.nSensor && a.dValue == b.dValue && a.bValid == b.bValid && a.uFlags == b.uFlags && a.strUnit == b.strUnit;
+}
+
+// A struct that converts to and from a struct sequence
+struct Point
+{
+	int64_t nX;
+	double dY;
+	std::string strLabel;
+};
+PYL_STRUCT( Point, nX, dY, strLabel )
+
+// The purpose of this example is to show what C++ values become
+// in python and back, and to check that they arrive intact
+int main( int argc, char ** argv )
+{
+	// We may get an exception from the interpreter if something is amiss
+	try
+	{
+		pyl::initialize();
+
+		{
+			// Objects can be indexed by position or by key
+			pyl::run_cmd( "index_list = [1, 2, 3]\nindex_dict = {'one': 1}\nclass Keyed:\n    def __getitem__(self, key): return len(key)\nindex_keyed = Keyed()" );
+			pyl::Object obList = pyl::main().get_attr( "index_list" );
+			pyl::Object obDict = pyl::main().get_attr( "index_dict" );
+			pyl::Object obKeyed = pyl::main().get_attr( "index_keyed" );
+			check( obList[-1].as<int>() == 3 && obDict["one"].as<int>() == 1 && obKeyed["four"].as<int>() == 4, "indexing" );
+
+			// Keys that aren't valid UTF-8 can't be python strings, so they're never found
+			std::string strBadKey( "\xff" );
+			check( throws( [&]() { obDict[strBadKey]; } ), "indexing a dict with a key that isn't UTF-8" );
+			check( throws( [&]() { obKeyed[strBadKey]; } ), "indexing an object with a key that isn't UTF-8" );
+			check( throws( [&]() { obDict.at( strBadKey ); } ), "borrowing with a key that isn't UTF-8" );
+			check( throws( [&]() { obDict["two"]; } ) && throws( [&]() { obList[3]; } ), "indexing with missing keys" );
+			std::cout << "Indexing checked" << std::endl;
+		}
+
+		{
+			// Unordered containers, deques and pairs convert item by item (std::strings go back as bytes)
+			std::unordered_map<int, std::string> umapStrings;
+			check( from_python( "{1: 'one', 2: 'two'}", umapStrings ) && umapStrings.size() == 2 && umapStrings[1] == "one" && umapStrings[2] == "two", "unordered_map from a dict" );
+			check( to_python( umapStrings, "type(v) is dict and v == {1: b'one', 2: b'two'}" ), "unordered_map to a dict" );
+			check( !from_python( "{1: 'one', 'two': 2}", umapStrings ), "unordered_map from a dict with a bad key" );
+
+			std::unordered_set<int> usetInts;
+			check( from_python( "{1, 2, 3}", usetInts ) && usetInts == std::unordered_set<int>{ 1, 2, 3 }, "unordered_set from a set" );
+			check( from_python( "[3, 3, 4]", usetInts ) && usetInts == std::unordered_set<int>{ 3, 4 }, "unordered_set from a list" );
+			check( to_python( usetInts, "type(v) is set and v == {3, 4}" ), "unordered_set to a set" );
+
+			std::deque<int> dqInts;
+			check( from_python( "[1, 2, 3]", dqInts ) && dqInts == std::deque<int>{ 1, 2, 3 }, "deque from a list" );
+			check( to_python( dqInts, "type(v) is list and v == [1, 2, 3]" ), "deque to a list" );
+
+			std::pair<int, std::string> prNamed;
+			check( from_python( "(1, 'one')", prNamed ) && prNamed.first == 1 && prNamed.second == "one", "pair from a tuple" );
+			check( to_python( prNamed, "v == (1, b'one')" ), "pair to a tuple" );
+			check( !from_python( "(1, 'one', 'uno')", prNamed ) && !from_python( "('one', 1)", prNamed ), "pair from the wrong tuple" );
+
+			// None is an empty optional, and the other way around
+			std::optional<int> optInt( 1 );
+			check( from_python( "None", optInt ) && !optInt, "optional from None" );
+			check( from_python( "5", optInt ) && optInt == 5, "optional from a value" );
+			check( !from_python( "'five'", optInt ), "optional from the wrong type" );
+			check( to_python( std::optional<int>(), "v is None" ) && to_python( std::optional<int>( 7 ), "v == 7" ), "optional to python" );
+
+			// Variants hold the first alternative that converts
+			std::variant<int, std::string> varIntString;
+			check( from_python( "3", varIntString ) && varIntString.index() == 0 && std::get<int>( varIntString ) == 3, "variant from an int" );
+			check( from_python( "'hello'", varIntString ) && varIntString.index() == 1 && std::get<std::string>( varIntString ) == "hello", "variant from a string" );
+			check( !from_python( "1.5", varIntString ), "variant from none of its alternatives" );
+			check( to_python( varIntString, "v == b'hello'" ), "variant to python" );
+
+			std::variant<double, int> varDoubleInt;
+			check( from_python( "3", varDoubleInt ) && varDoubleInt.index() == 0 && std::get<double>( varDoubleInt ) == 3., "variant whose first alternative takes ints" );
+			std::variant<int, double> varIntDouble;
+			check( from_python( "2.5", varIntDouble ) && varIntDouble.index() == 1 && std::get<double>( varIntDouble ) == 2.5, "variant that skips an alternative" );
+
+			// monostate is None, so a variant can be empty
+			std::variant<std::monostate, int, std::string> varMaybe( 1 );
+			check( from_python( "None", varMaybe ) && varMaybe.index() == 0, "variant from None" );
+			check( to_python( varMaybe, "v is None" ), "variant holding monostate to python" );
+			check( from_python( "'x'", varMaybe ) && varMaybe.index() == 2, "variant with monostate from a string" );
+			std::cout << "Standard containers, optionals and variants checked" << std::endl;
+		}
+
+		{
+			// Python stores each string with one, two or four bytes per character,
+			// and wide strings copy from each of those directly
+			std::wstring wstr;
+			std::u16string u16str;
+			std::string str;
+			check( from_python( "'caf\\u00e9'", wstr ) && wstr == L"café", "wstring from a one byte string" );
+			check( from_python( "'caf\\u00e9'", u16str ) && u16str == u"café", "u16string from a one byte string" );
+			check( from_python( "'caf\\u00e9'", str ) && str == "caf\xc3\xa9", "string from a one byte string is UTF-8" );
+			check( from_python( "'\\u00e9' * 100", u16str ) && u16str == std::u16string( 100, u'é' ), "u16string from a long one byte string" );
+			check( from_python( "'\\u20ac10'", wstr ) && wstr == L"€10", "wstring from a two byte string" );
+			check( from_python( "'\\u20ac10'", u16str ) && u16str == u"€10", "u16string from a two byte string" );
+			check( from_python( "'a\\U0001F600b'", wstr ) && wstr == L"a\U0001F600b", "wstring from a four byte string" );
+
+			// Code points outside the BMP become surrogate pairs
+			check( from_python( "'a\\U0001F600b'", u16str ) && u16str.size() == 4 && u16str[1] == 0xD83D && u16str[2] == 0xDE00, "u16string from a four byte string" );
+			check( from_python( "'\\u20ac\\U0001F600' * 50", u16str ) && u16str.size() == 150 && u16str.substr( 0, 3 ) == u"€\U0001F600", "u16string from a long four byte string" );
+
+			// And they go back as unicode, with the pairs rejoined
+			check( to_python( std::wstring( L"café" ), "v == 'caf\\u00e9'" ), "one byte wstring to python" );
+			check( to_python( std::u16string( u"€10" ), "v == '\\u20ac10'" ), "two byte u16string to python" );
+			check( to_python( std::wstring( L"a\U0001F600b" ), "v == 'a\\U0001F600b'" ), "four byte wstring to python" );
+			check( to_python( std::u16string( u"a\U0001F600b" ), "v == 'a\\U0001F600b' and len(v) == 3" ), "u16string with a surrogate pair to python" );
+			check( to_python( std::string( "caf\xc3\xa9" ), "v == b'caf\\xc3\\xa9'" ), "string to python" );
+
+			// Bytes are decoded as UTF-8, skipping the decode when they're ASCII
+			check( from_python( "b'abc'", u16str ) && u16str == u"abc", "u16string from ASCII bytes" );
+			check( from_python( "b'caf\\xc3\\xa9'", wstr ) && wstr == L"café", "wstring from UTF-8 bytes" );
+			check( from_python( "bytearray(b'\\xe2\\x82\\xac10')", u16str ) && u16str == u"€10", "u16string from a UTF-8 bytearray" );
+			check( from_python( "b'\\xf0\\x9f\\x98\\x80'", u16str ) && u16str == u"\U0001F600" && u16str.size() == 2, "u16string from four byte UTF-8" );
+			check( !from_python( "b'caf\\xff'", wstr ) && !from_python( "b'\\xc3'", u16str ), "wide strings from bytes that aren't UTF-8" );
+			std::cout << "Strings checked" << std::endl;
+		}
+
+		{
+			// Buffers of bytes are unsigned bytes, read only unless asked
+			check( to_python( pyl::alloc_buffer( std::vector<char>{ 'a', 'b', 'c' } ), "v.format == 'B' and v.itemsize == 1 and v.readonly and v.tobytes() == b'abc'" ), "alloc_buffer of a char vector" );
+			check( to_python( pyl::alloc_buffer( std::string( "abcd" ), true ), "v.format == 'B' and v.itemsize == 1 and not v.readonly and v.tobytes() == b'abcd'" ), "writable alloc_buffer of a string" );
+			std::unique_ptr<uint8_t[]> upBytes( new uint8_t[3]{ 1, 2, 3 } );
+			check( to_python( pyl::alloc_buffer( std::move( upBytes ), 3 ), "v.format == 'B' and v.itemsize == 1 and v.readonly and list(v) == [1, 2, 3]" ), "alloc_buffer of a byte array" );
+
+			// Writes to a writable buffer land in the memory we handed over
+			pyl::main().set_attr( "v", pyl::alloc_buffer( std::vector<char>( 2, 'x' ), true ) );
+			pyl::run_cmd( "v[0] = ord('y')" );
+			check( eval( "v.tobytes() == b'yx'" ).as<bool>(), "writing to a writable alloc_buffer" );
+			pyl::main().set_attr( "v", pyl::alloc_buffer( std::vector<char>( 2, 'x' ) ) );
+			pyl::run_cmd( "try:\n\tv[0] = 0\n\tbWrote = True\nexcept TypeError:\n\tbWrote = False" );
+			check( !eval( "bWrote" ).as<bool>() && eval( "v.tobytes() == b'xx'" ).as<bool>(), "writing to a read only alloc_buffer" );
+
+			// Vectors of numbers have one item per element
+			check( to_python( pyl::alloc_buffer( std::vector<int32_t>{ -1, 2 } ), "v.format == 'i' and v.itemsize == 4 and v.readonly and v.tolist() == [-1, 2]" ), "alloc_buffer of int32s" );
+			check( to_python( pyl::alloc_buffer( std::vector<uint16_t>{ 1, 65535 }, true ), "v.format == 'H' and v.itemsize == 2 and not v.readonly and v.tolist() == [1, 65535]" ), "alloc_buffer of uint16s" );
+			check( to_python( pyl::alloc_buffer( std::vector<int64_t>{ -5 } ), "v.format == 'q' and v.itemsize == 8 and v.tolist() == [-5]" ), "alloc_buffer of int64s" );
+			check( to_python( pyl::alloc_buffer( std::vector<int8_t>{ -2 } ), "v.format == 'b' and v.itemsize == 1 and v.tolist() == [-2]" ), "alloc_buffer of int8s" );
+			check( to_python( pyl::alloc_buffer( std::vector<float>{ 0.5f } ), "v.format == 'f' and v.itemsize == 4 and v.tolist() == [0.5]" ), "alloc_buffer of floats" );
+			check( to_python( pyl::alloc_buffer( std::vector<double>{ 1.5, -2.5 }, true ), "v.format == 'd' and v.itemsize == 8 and not v.readonly and v.tolist() == [1.5, -2.5]" ), "alloc_buffer of doubles" );
+			std::cout << "Buffers checked" << std::endl;
+		}
+
+		{
+			const std::string strMapFile = "pylTestConversions_map.bin";
+			std::ofstream( strMapFile, std::ios::binary ) << "abcd";
+			auto fnFileContents = [&strMapFile] () {
+				std::ostringstream ss;
+				ss << std::ifstream( strMapFile, std::ios::binary ).rdbuf();
+				return ss.str();
+			};
+
+			// Read mappings are read only, on both sides
+			pyl::Object obRead = pyl::map_file( strMapFile, pyl::MapMode::Read );
+			check( to_python( obRead, "v.readonly and v.format == 'B' and v.tobytes() == b'abcd'" ), "map_file for reading" );
+			pyl::Span<const char> spConst;
+			pyl::Span<char> spWritable;
+			check( obRead.convert( spConst ) && spConst.size() == 4 && spConst[0] == 'a', "const Span of a read mapping" );
+			check( !obRead.convert( spWritable ), "Span of a read mapping" );
+
+			// Copy on write mappings can be written to, but the file is untouched
+			pyl::Object obCopy = pyl::map_file( strMapFile, pyl::MapMode::CopyOnWrite );
+			check( obCopy.convert( spWritable ) && spWritable.size() == 4, "Span of a copy on write mapping" );
+			spWritable[0] = 'z';
+			check( to_python( obCopy, "not v.readonly and v.tobytes() == b'zbcd'" ), "copy on write mapping sees writes from C++" );
+			pyl::run_cmd( "v[1] = ord('y')" );
+			check( spWritable[1] == 'y' && spConst[0] == 'a' && spConst[1] == 'b' && fnFileContents() == "abcd", "copy on write leaves the file alone" );
+
+			// Read write mappings write through to the file
+			pyl::Object obReadWrite = pyl::map_file( strMapFile, pyl::MapMode::ReadWrite );
+			check( obReadWrite.convert( spWritable ), "Span of a read write mapping" );
+			spWritable[3] = 'e';
+			check( fnFileContents() == "abce" && spConst[3] == 'e', "read write mapping writes to the file" );
+			check( throws( [] () { pyl::map_file( "pylTestConversions_missing.bin" ); } ), "map_file of a missing file" );
+
+			// Spans need the item type to match the buffer's format, and a writable buffer unless they're const
+			pyl::Object obInts = pyl::alloc_buffer( std::vector<int32_t>{ 1, 2, 3 }, true );
+			pyl::Span<int32_t> spInts;
+			pyl::Span<const int32_t> spConstInts;
+			pyl::Span<uint32_t> spUnsigned;
+			pyl::Span<float> spFloats;
+			check( obInts.convert( spInts ) && spInts.size() == 3 && spInts[2] == 3, "Span of an int buffer" );
+			check( !obInts.convert( spUnsigned ) && !obInts.convert( spFloats ), "Span of a buffer with another format" );
+			pyl::Object obConstInts = pyl::alloc_buffer( std::vector<int32_t>{ 1, 2, 3 } );
+			check( !obConstInts.convert( spInts ) && obConstInts.convert( spConstInts ) && spConstInts.size() == 3, "Span of a read only buffer" );
+			check( !eval( "b'abcd'" ).convert( spInts ) && !eval( "bytearray(4)" ).convert( spInts ), "Span of bytes as ints" );
+			pyl::Object obArray = eval( "__import__('array').array('h', [1, -2])" );
+			pyl::Span<int16_t> spShorts;
+			pyl::Span<uint16_t> spUnsignedShorts;
+			check( obArray.convert( spShorts ) && spShorts.size() == 2 && spShorts[1] == -2, "Span of an array" );
+			check( !obArray.convert( spUnsignedShorts ), "Span of an array with another signedness" );
+			check( !eval( "[1, 2, 3]" ).convert( spInts ), "Span of something without a buffer" );
+
+			obRead = obCopy = obReadWrite = pyl::Object();
+			pyl::run_cmd( "del v" );
+			std::remove( strMapFile.c_str() );
+			std::cout << "Mapped files and spans checked" << std::endl;
+		}
+
+		{
+			// Numeric fields become typed, writable memoryviews and everything else a list
+			const std::vector<Reading> vReadings{ { 1, 1.5, true, 7, "C" }, { -2, -2.5, false, 65535, "F" } };
+			pyl::Columns<Reading> colReadings( vReadings );
+			check( to_python( colReadings, "type(v) is dict and list(v) == ['nSensor', 'dValue', 'bValid', 'uFlags', 'strUnit']" ), "Columns to a dict" );
+			check( eval( "v['nSensor'].format == 'i' and v['nSensor'].itemsize == 4 and v['nSensor'].tolist() == [1, -2]" ).as<bool>(), "int column" );
+			check( eval( "v['dValue'].format == 'd' and v['dValue'].itemsize == 8 and v['dValue'].tolist() == [1.5, -2.5]" ).as<bool>(), "double column" );
+			check( eval( "v['bValid'].format == '?' and v['bValid'].itemsize == 1 and v['bValid'].tolist() == [True, False]" ).as<bool>(), "bool column" );
+			check( eval( "v['uFlags'].format == 'H' and v['uFlags'].itemsize == 2 and v['uFlags'].tolist() == [7, 65535]" ).as<bool>(), "unsigned column" );
+			check( eval( "not any(v[k].readonly for k in ('nSensor', 'dValue', 'bValid', 'uFlags'))" ).as<bool>(), "numeric columns are writable" );
+			check( eval( "v['strUnit'] == [b'C', b'F']" ).as<bool>(), "string column falls back to a list" );
+
+			// And come back intact, including whatever python wrote to them
+			pyl::run_cmd( "v['dValue'][1] = 3.5\nv['bValid'][1] = True" );
+			pyl::Columns<Reading> colBack;
+			check( from_python( "v", colBack ) && colBack.vRecords.size() == 2 && same_reading( colBack.vRecords[0], vReadings[0] ), "Columns from a dict" );
+			check( colBack.vRecords[1].dValue == 3.5 && colBack.vRecords[1].bValid && colBack.vRecords[1].uFlags == 65535 && colBack.vRecords[1].strUnit == "F", "Columns see writes from python" );
+
+			// Columns can be any sequence of the right items, or a buffer of another type
+			pyl::run_cmd( "from array import array" );
+			check( from_python( "{'nSensor': (3,), 'dValue': array('f', [0.5]), 'bValid': [True], 'uFlags': array('H', [9]), 'strUnit': ['K']}", colBack ), "Columns from sequences" );
+			check( colBack.vRecords.size() == 1 && same_reading( colBack.vRecords[0], { 3, 0.5, true, 9, "K" } ), "Columns from sequences values" );
+
+			// Every column has to be there, the right type and the same length, otherwise nothing changes
+			check( !from_python( "{'nSensor': [1, 2], 'dValue': [1.5], 'bValid': [True, False], 'uFlags': [1, 2], 'strUnit': ['A', 'B']}", colBack ), "ragged Columns" );
+			check( !from_python( "{'nSensor': array('i', [1, 2]), 'dValue': array('d', [1.5]), 'bValid': [True, False], 'uFlags': [1, 2], 'strUnit': ['A', 'B']}", colBack ), "ragged buffer Columns" );
+			check( !from_python( "{'nSensor': [1], 'dValue': [1.5], 'bValid': [True], 'uFlags': [1]}", colBack ), "Columns missing a field" );
+			check( !from_python( "{'nSensor': ['one'], 'dValue': [1.5], 'bValid': [True], 'uFlags': [1], 'strUnit': ['A']}", colBack ), "Columns with the wrong item type" );
+			check( !from_python( "[[1, 1.5, True, 1, 'A']]", colBack ), "Columns from a list of rows" );
+			check( colBack.vRecords.size() == 1 && colBack.vRecords[0].nSensor == 3, "failed Columns conversions leave the records alone" );
+			std::cout << "Columns checked" << std::endl;
+		}
+
+		{
+			// Structs become struct sequences named after them, with one item per field
+			check( pyl::record_field_names<Point>() == std::vector<std::string>{ "nX", "dY", "strLabel" }, "struct field names" );
+			check( to_python( Point{ 3, 1.5, "a" }, "type(v).__name__ == 'Point' and type(v).__module__ == 'pyl' and type(v).__match_args__ == ('nX', 'dY', 'strLabel')" ), "struct sequence type" );
+			check( eval( "type(v)" ).get() == (PyObject *) pyl::struct_sequence_type<Point>(), "struct sequence type is made once" );
+			check( eval( "isinstance(v, tuple) and len(v) == 3 and v[0] == 3 and v[1] == 1.5 and v[2] == b'a'" ).as<bool>(), "struct sequence by index" );
+			check( eval( "v.nX == 3 and v.dY == 1.5 and v.strLabel == b'a'" ).as<bool>(), "struct sequence by name" );
+
+			// Any tuple with one item per field converts back
+			Point pt{};
+			check( from_python( "v", pt ) && pt.nX == 3 && pt.dY == 1.5 && pt.strLabel == "a", "struct from a struct sequence" );
+			pyl::run_cmd( "import collections\nNTPoint = collections.namedtuple('NTPoint', 'nX dY strLabel')" );
+			check( from_python( "NTPoint(4, 2.5, 'b')", pt ) && pt.nX == 4 && pt.dY == 2.5 && pt.strLabel == "b", "struct from a namedtuple" );
+			check( from_python( "(5, 6, 'c')", pt ) && pt.nX == 5 && pt.dY == 6. && pt.strLabel == "c", "struct from a tuple" );
+
+			// But not if the length or an item's type is wrong, or it isn't a tuple
+			check( !from_python( "(1, 2.5)", pt ) && !from_python( "(1, 2.5, 'a', 'b')", pt ), "struct from a tuple of the wrong length" );
+			check( !from_python( "(1, 'one', 'a')", pt ) && !from_python( "NTPoint(1.5, 2.5, 'a')", pt ), "struct from a tuple with the wrong item type" );
+			check( !from_python( "[1, 2.5, 'a']", pt ), "struct from a list" );
+			std::cout << "Structs checked" << std::endl;
+		}
+
+		// Shut down the interpreter
+		pyl::finalize();
+
+		return EXIT_SUCCESS;
+	}
+	// These exceptions are thrown when something in pyliaison
+	// goes wrong, but they're a child of std::runtime_error
+	catch ( pyl::runtime_error e )
+	{
+		std::cout << e.what() << std::endl;
+		pyl::print_error();
+		pyl::finalize();
+		return EXIT_FAILURE;
+	}
+}
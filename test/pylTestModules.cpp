@@ -16,8 +16,8 @@ int main( int argc, char ** argv )
 	// We may get an exception from the interpreter if something is amiss
 	try
 	{
-		// Create modules - this must be done
-		// prior to initializing the interpreter
+		// Create modules - this can be done before or after initializing
+		// the interpreter, so long as it's done before the module is imported.
 		// The name of the module can be whatever you like,
 		// so long as you don't conflict with anything important
 		pyl::ModuleDef * pModDef = pylCreateMod( pylModule );
@@ -33,6 +33,23 @@ int main( int argc, char ** argv )
 		pyl::run_cmd( "import pylModule" );
 		pyl::run_cmd( "print('The cosine of', 0, 'is', pylModule.MyCos(0))" );
 
+		// Modules can also be created once the interpreter is running
+		pyl::ModuleDef * pLateModDef = pylCreateMod( pylLateModule );
+		pylAddFnToMod( pLateModDef, MyCos );
+		pyl::run_cmd( "import pylLateModule" );
+		double dLateCos = pyl::GetModule( "pylLateModule" ).call( "MyCos", 0. );
+		if ( dLateCos != 1. )
+			throw pyl::runtime_error( "Error calling into a module created after initializing" );
+
+		// Exceptions thrown while importing a module become an ImportError
+		pyl::ModuleDef * pBadModDef = pylCreateMod( pylBadModule );
+		pBadModDef->SetCustomModuleInit( []( pyl::Object ) { throw std::logic_error( "pylBadModule can't be imported" ); } );
+		std::string strImportBad = "try:\n    import pylBadModule\n    bad_import = 'imported'\nexcept ImportError as e:\n    bad_import = str(e)";
+		pyl::run_cmd( strImportBad );
+		std::string strBadImport = pyl::main().get_attr( "bad_import" );
+		if ( strBadImport != "pylBadModule can't be imported" )
+			throw pyl::runtime_error( "Exception importing a module wasn't an ImportError" );
+
 		// We can also store references to python modules
 		// Here we'll get the os.path module and use it 
 		// to determine the absolute path of this .cpp file
@@ -40,6 +57,13 @@ int main( int argc, char ** argv )
 		std::string strCurFile = obPathMod.call("abspath", __FILE__).as<std::string>();
 		std::cout << "We are currently in " << strCurFile << " line " << __LINE__ << std::endl;
 
+		// Modules we get are cached, but not past the module being imported again
+		pyl::Object obJson = pyl::GetModule( "json" );
+		pyl::run_cmd( "import sys\ndel sys.modules['json']\nimport json" );
+		pyl::Object obSysModules = pyl::GetModule( "sys" ).get_attr( "modules" );
+		if ( pyl::GetModule( "json" ).get() != obSysModules["json"].get() || pyl::GetModule( "json" ).get() == obJson.get() )
+			throw pyl::runtime_error( "GetModule returned a module that was imported again" );
+
 		// Shut down the interpreter
 		pyl::finalize();
 
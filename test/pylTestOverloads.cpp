@@ -49,6 +49,24 @@ int main( int argc, char ** argv )
 			std::cout << v4[i] << (i == 3 ? "]" : ", ");
 		std::cout << std::endl;
 
+		// The built in integer conversions fail on values that don't fit in the
+		// C++ type, but shouldn't trip over a python error that was already set
+		pyl::run_cmd( "u64_max = 2**64 - 1\nminus_one = -1\none = 1" );
+		uint64_t u64( 0 );
+		uint32_t u32( 0 );
+		if ( !pyl::main().get_attr( "u64_max" ).convert( u64 ) || u64 != std::numeric_limits<uint64_t>::max() )
+			throw pyl::runtime_error( "Converting 2**64 - 1 to uint64_t failed" );
+		if ( pyl::main().get_attr( "u64_max" ).convert( u32 ) || pyl::main().get_attr( "minus_one" ).convert( u32 ) )
+			throw pyl::runtime_error( "Converting an int that doesn't fit to uint32_t worked" );
+
+		pyl::Object obOne = pyl::main().get_attr( "one" );
+		PyErr_SetString( PyExc_RuntimeError, "Unrelated error" );
+		bool bConverted = pyl::convert( obOne.get(), u32 ) && u32 == 1;
+		bool bErrorKept = PyErr_ExceptionMatches( PyExc_RuntimeError );
+		PyErr_Clear();
+		if ( !bConverted || !bErrorKept )
+			throw pyl::runtime_error( "Converting to uint32_t with an error set went wrong" );
+
 		// Shut down the interpreter
 		pyl::finalize();
 
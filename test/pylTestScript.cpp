@@ -1,5 +1,7 @@
 #include <pyliaison.h>
+#include <pylScriptWatcher.h>
 #include <iostream>
+#include <fstream>
 
 /* Here is the a copy of the script used in this program
 
@@ -43,6 +45,42 @@ int main( int argc, char ** argv )
 		std::string strIn = "My name is John";
 		std::vector<std::string> vOut = obScript.call( "delimit", strIn, " " );
 
+		// Scripts are cached, and reloaded when their file changes. They
+		// can be named without ".py", like they would be imported
+		std::string strTempDir = pyl::GetModule( "tempfile" ).call( "mkdtemp" );
+		std::string strReloadPath = strTempDir + "/pylReloadScript";
+		auto writeScript = [strReloadPath]( std::string strBody, int nTime )
+		{
+			std::ofstream ofScript( strReloadPath + ".py" );
+			ofScript << strBody;
+			ofScript.close();
+			// Bump the modification time, so the change is seen (and no stale bytecode is used)
+			std::string strTouch = "import os\nos.utime('" + strReloadPath + ".py', (" + std::to_string( nTime ) + ", " + std::to_string( nTime ) + "))";
+			pyl::run_cmd( strTouch );
+		};
+		writeScript( "def value():\n    return 1\n", 1000000000 );
+		int nValue = pyl::Object( strReloadPath ).call( "value" );
+		writeScript( "def value():\n    return 22\n", 1000000100 );
+		int nReloaded = pyl::Object( strReloadPath ).call( "value" );
+		if ( nValue != 1 || nReloaded != 22 )
+			throw pyl::runtime_error( "Script wasn't reloaded after its file changed" );
+
+		// A script watcher reloads scripts as they change, once per update
+		pyl::ScriptWatcher watcher;
+		pyl::ScriptWatcher::ScriptPtr spWatched = watcher.Watch( strReloadPath );
+		writeScript( "def value():\n    return 333\n", 1000000200 );
+		int nWatchReloads = watcher.Update();
+		int nWatched = spWatched->GetModule()->call( "value" );
+		pyl::GetModule( "shutil" ).call( "rmtree", strTempDir );
+		if ( nWatchReloads != 1 || nWatched != 333 )
+			throw pyl::runtime_error( "Watched script wasn't reloaded after its file changed" );
+
+		// An object that outlives its interpreter must not be released into the next one
+		pyl::Object obStale = pyl::Object::steal( pyl::alloc_pyobject( vOut ) );
+		pyl::finalize();
+		pyl::initialize();
+		obStale.reset();
+
 		// Shut down the interpreter
 		pyl::finalize();
 
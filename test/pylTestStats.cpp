@@ -0,0 +1,165 @@
+#include <pyliaison.h>
+#include <pylProfiler.h>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <numeric>
+#include <chrono>
+
+// Called from python to give the statistics something to count
+int Twice( int n )
+{
+	return 2 * n;
+}
+
+// Takes long enough that the profiler catches it in the act
+int SlowTwice( int n )
+{
+	auto tEnd = std::chrono::steady_clock::now() + std::chrono::microseconds( 200 );
+	while ( std::chrono::steady_clock::now() < tEnd );
+	return 2 * n;
+}
+
+// Throws if a check fails, so that the test fails
+static void check( bool bPassed, std::string strWhat )
+{
+	if ( !bPassed )
+		throw pyl::runtime_error( "Check failed: " + strWhat );
+}
+
+// The purpose of this example is to show how the statistics pyliaison
+// can optionally collect are read, and to check what they count. Each
+// kind of statistic is only checked if pyliaison was built with it
+int main( int argc, char ** argv )
+{
+	// We may get an exception from the interpreter if something is amiss
+	try
+	{
+		pyl::ModuleDef * pModDef = pylCreateMod( pylStatsModule );
+		pylAddFnToMod( pModDef, Twice );
+		pylAddFnToMod( pModDef, SlowTwice );
+
+		pyl::initialize();
+		pyl::run_cmd( "import pylStatsModule" );
+
+#ifdef PYL_CALL_STATS
+		{
+			// Every call to an exposed function is counted, with its latency
+			auto getTwiceStats = []()
+			{
+				for ( const pyl::CallStats& stats : pyl::get_call_stats() )
+					if ( stats.strName == "pylStatsModule.Twice" )
+						return stats;
+				throw pyl::runtime_error( "No call statistics for pylStatsModule.Twice" );
+			};
+
+			pyl::reset_call_stats();
+			pyl::run_cmd( "for i in range(10): pylStatsModule.Twice(i)" );
+			pyl::CallStats stats = getTwiceStats();
+			check( stats.uCalls == 10, "call count" );
+			check( std::accumulate( stats.arLatency.begin(), stats.arLatency.end(), uint64_t( 0 ) ) == 10, "latency histogram count" );
+
+			// Resetting starts the counts over
+			pyl::reset_call_stats();
+			check( getTwiceStats().uCalls == 0, "call count after reset" );
+
+			// The same numbers can be read (and reset) from python
+			pyl::run_cmd( "import pyl_stats\nfor i in range(3): pylStatsModule.Twice(i)\npy_calls = pyl_stats.snapshot()['pylStatsModule.Twice']['calls']\npyl_stats.reset()" );
+			int nPyCalls = pyl::main().get_attr( "py_calls" );
+			check( nPyCalls == 3, "call count from pyl_stats" );
+			check( getTwiceStats().uCalls == 0, "call count after pyl_stats.reset" );
+			std::cout << "Call statistics checked" << std::endl;
+		}
+#else
+		check( pyl::get_call_stats().empty(), "no call statistics without PYL_CALL_STATS" );
+		std::cout << "Call statistics not built (PYL_CALL_STATS is off)" << std::endl;
+#endif
+
+#ifdef PYL_CONVERSION_STATS
+		{
+			// Conversions are counted by C++ type and direction, nested ones
+			// (like the elements of a container) towards the outermost type
+			auto findStat = []( const std::vector<pyl::ConversionStat>& vStats, std::string strType, bool bAlloc )
+			{
+				for ( const pyl::ConversionStat& stat : vStats )
+					if ( stat.strType == strType && stat.bAlloc == bAlloc )
+						return stat;
+				throw pyl::runtime_error( "No conversion statistics for " + strType );
+			};
+
+			pyl::reset_conversion_stats();
+			pyl::ConversionStats probe;
+			std::vector<int> vInts{ 1, 2, 3 };
+			std::map<int, std::string> mapStrings{ { 1, "one" }, { 2, "two" } };
+			pyl::main().set_attr( "conv_ints", vInts );
+			pyl::main().set_attr( "conv_strings", mapStrings );
+			pyl::main().set_attr( "conv_strings", mapStrings );
+			std::vector<int> vBack;
+			pyl::main().get_attr( "conv_ints" ).convert( vBack );
+
+			for ( const std::vector<pyl::ConversionStat>& vStats : { pyl::get_conversion_stats(), probe.Get() } )
+			{
+				pyl::ConversionStat statInts = findStat( vStats, "std::vector<int>", true );
+				check( statInts.uCalls == 1 && statInts.uObjects == 4 && statInts.uBytes == 3 * sizeof( int ), "vector<int> to python" );
+				pyl::ConversionStat statStrings = findStat( vStats, "std::map<int, std::string>", true );
+				check( statStrings.uCalls == 2 && statStrings.uObjects == 10 && statStrings.uBytes == 2 * ( 2 * sizeof( int ) + 6 ), "map<int, string> to python" );
+				pyl::ConversionStat statBack = findStat( vStats, "std::vector<int>", false );
+				check( statBack.uCalls == 1 && statBack.uObjects == 0 && statBack.uBytes == 3 * sizeof( int ), "vector<int> from python" );
+			}
+
+			pyl::reset_conversion_stats();
+			check( pyl::get_conversion_stats().empty(), "no conversions after reset" );
+			std::cout << "Conversion statistics checked" << std::endl;
+		}
+#else
+		check( pyl::get_conversion_stats().empty(), "no conversion statistics without PYL_CONVERSION_STATS" );
+		std::cout << "Conversion statistics not built (PYL_CONVERSION_STATS is off)" << std::endl;
+#endif
+
+		{
+			// The profiler charges its samples to python stacks, with bindings named
+			pyl::run_cmd( "def busy():\n    for i in range(200): pylStatsModule.SlowTwice(i)" );
+			pyl::Profiler profiler;
+			check( profiler.Start( 100 ), "starting the profiler" );
+			pyl::main().call( "busy" );
+			profiler.Stop();
+			check( profiler.GetSampleCount() > 0, "profiler samples" );
+
+			// Collapsed stacks are "frame;frame;frame count" lines, and every sample is in one
+			std::istringstream issStacks( profiler.GetCollapsedStacks() );
+			uint64_t uLineSamples( 0 );
+			bool bSawBinding( false ), bSawCallee( false );
+			for ( std::string strLine; std::getline( issStacks, strLine ); )
+			{
+				size_t uSpace = strLine.rfind( ' ' );
+				check( uSpace != std::string::npos, "collapsed stack line format" );
+				uLineSamples += std::stoull( strLine.substr( uSpace + 1 ) );
+				std::string strStack = strLine.substr( 0, uSpace );
+				bSawBinding |= strStack.find( "busy (" ) != std::string::npos && strStack.find( ";pylStatsModule.SlowTwice [pyl]" ) != std::string::npos;
+				bSawCallee |= strStack.find( "pylStatsModule.SlowTwice [pyl];[C++]" ) != std::string::npos;
+			}
+			check( uLineSamples == profiler.GetSampleCount(), "collapsed stack sample counts" );
+			check( bSawBinding, "binding called from python in the collapsed stacks" );
+#ifdef PYL_PROFILE_CALLEES
+			check( bSawCallee, "time in the C++ callee split out" );
+#else
+			check( !bSawCallee, "bindings not split without PYL_PROFILE_CALLEES" );
+#endif
+			std::cout << "Profiler checked" << std::endl;
+		}
+
+		// Shut down the interpreter
+		pyl::finalize();
+
+		return EXIT_SUCCESS;
+	}
+	// These exceptions are thrown when something in pyliaison
+	// goes wrong, but they're a child of std::runtime_error
+	catch ( pyl::runtime_error e )
+	{
+		std::cout << e.what() << std::endl;
+		pyl::print_error();
+		pyl::finalize();
+		return EXIT_FAILURE;
+	}
+}
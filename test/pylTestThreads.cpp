@@ -0,0 +1,303 @@
+#include <pyliaison.h>
+#include <pylGIL.h>
+#include <pylChannel.h>
+#include <pylIterator.h>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+// Throws if a check fails, so that the test fails
+static void check( bool bPassed, std::string strWhat )
+{
+	if ( !bPassed )
+		throw pyl::runtime_error( "Check failed: " + strWhat );
+}
+
+// Holds a python object, and counts the times one is let go of without the GIL
+struct GILCheckedItem
+{
+	pyl::Object obItem;
+	static std::atomic<int> s_nUnguardedFrees;
+
+	GILCheckedItem() = default;
+	GILCheckedItem( GILCheckedItem&& ) = default;
+	~GILCheckedItem()
+	{
+		if ( obItem.get() && PyGILState_Check() == 0 )
+			s_nUnguardedFrees++;
+	}
+};
+std::atomic<int> GILCheckedItem::s_nUnguardedFrees( 0 );
+
+namespace pyl
+{
+	template <>
+	struct converter<GILCheckedItem>
+	{
+		static bool from_python( PyObject * obj, GILCheckedItem& val )
+		{
+			val.obItem = Object( obj );
+			return true;
+		}
+	};
+}
+
+// Stops a thread and joins it on the way out, so a failed check doesn't leave it running
+class ThreadJoiner
+{
+	std::thread& m_Thread;
+	std::atomic<bool>& m_bStop;
+
+public:
+	ThreadJoiner( std::thread& thread, std::atomic<bool>& bStop ) : m_Thread( thread ), m_bStop( bStop ) {}
+	~ThreadJoiner()
+	{
+		m_bStop = true;
+		if ( m_Thread.joinable() )
+		{
+			pyl::GILRelease rel( "test join" );
+			m_Thread.join();
+		}
+	}
+};
+
+// The purpose of this example is to show pyliaison being used
+// from more than one thread, and to check that what it keeps
+// for each thread is cleaned up when those threads exit
+int main( int argc, char ** argv )
+{
+	// We may get an exception from the interpreter if something is amiss
+	try
+	{
+		// The pool allocator keeps blocks for each thread
+		pyl::InitOptions options;
+		options.bPoolAllocator = true;
+		pyl::initialize( options );
+
+		{
+			// Start a lot of short lived threads that allocate and free a little. Whatever
+			// the pools of a thread that's exited hold should go to the threads after it
+			pyl::run_cmd( "import threading\n"
+						  "def churn(n):\n"
+						  "    def work():\n"
+						  "        d = {str(i): [i] * (i % 20) for i in range(200)}\n"
+						  "    for i in range(n):\n"
+						  "        t = threading.Thread(target=work)\n"
+						  "        t.start()\n"
+						  "        t.join()" );
+			pyl::main().call( "churn", 100 );
+			size_t uPoolBytes = pyl::get_memory_stats().uPoolBytes;
+			pyl::main().call( "churn", 2000 );
+			size_t uGrowth = pyl::get_memory_stats().uPoolBytes - uPoolBytes;
+			check( uGrowth < ( 2 << 20 ), "pool growth with short lived threads (" + std::to_string( uGrowth >> 10 ) + " KB)" );
+			std::cout << "Thread churn checked" << std::endl;
+		}
+
+		{
+			// Take turns with another thread, which has to take the GIL to run python
+			pyl::reset_gil_stats();
+			pyl::name_gil_thread( "main" );
+			// The worker stays alive until we're done looking at its row
+			std::atomic<bool> bWorked( false ), bDone( false );
+			std::thread worker( [&bWorked, &bDone]() {
+				pyl::name_gil_thread( "worker" );
+				for ( int i = 0; i < 100; i++ )
+				{
+					pyl::GILGuard gil( "worker loop" );
+					pyl::run_cmd( "busy_sum = sum(range(2000))" );
+				}
+				bWorked = true;
+				while ( !bDone )
+					std::this_thread::yield();
+			} );
+			ThreadJoiner joinWorker( worker, bDone );
+			for ( int i = 0; i < 100; i++ )
+			{
+				pyl::GILRelease rel( "main loop" );
+				std::this_thread::yield();
+			}
+			{
+				// Don't hold the GIL while the worker may still want it
+				pyl::GILRelease rel( "main wait" );
+				while ( !bWorked )
+					std::this_thread::yield();
+			}
+
+#ifdef PYL_GIL_STATS
+			// Each thread and site gets its own counts
+			auto getStats = []( std::string strThread, std::string strSite )
+			{
+				for ( const pyl::GILStats& stats : pyl::get_gil_stats() )
+					if ( stats.strThread == strThread && stats.strSite == strSite )
+						return stats;
+				throw pyl::runtime_error( "No GIL statistics for " + strThread + " at " + strSite );
+			};
+			check( getStats( "worker", "worker loop" ).uAcquires == 100, "worker acquisitions" );
+			check( getStats( "main", "main loop" ).uAcquires == 100, "main acquisitions" );
+			check( getStats( "main", "main wait" ).uAcquires == 1, "acquisitions after waiting" );
+
+			// The report has a row per thread and site, with wait and hold percentiles
+			bool bSawWorker( false );
+			std::istringstream issReport( pyl::get_gil_report() );
+			for ( std::string strLine; std::getline( issReport, strLine ); )
+			{
+				std::istringstream issRow( strLine );
+				std::string strThread, strSite;
+				uint64_t uAcquires( 0 );
+				double arWait[3], arHold[3], dHeld;
+				issRow >> strThread >> uAcquires >> arWait[0] >> arWait[1] >> arWait[2] >> arHold[0] >> arHold[1] >> arHold[2] >> dHeld;
+				std::getline( issRow >> std::ws, strSite );
+				if ( strThread != "worker" || strSite != "worker loop" )
+					continue;
+
+				bSawWorker = true;
+				check( uAcquires == 100, "worker acquisitions in the report" );
+				check( arWait[0] <= arWait[1] && arWait[1] <= arWait[2], "wait percentiles in order" );
+				check( arHold[0] > 0 && arHold[0] <= arHold[1] && arHold[1] <= arHold[2], "hold percentiles in order" );
+				check( dHeld > 0 && dHeld <= 100, "share of time held" );
+			}
+			check( bSawWorker, "worker in the GIL report" );
+
+			// Threads that have exited share one row for each site. Counts from before a
+			// reset stay out of it, even if the thread that made them exits after the reset
+			auto countSiteRows = []( std::string strSite )
+			{
+				size_t uRows( 0 );
+				for ( const pyl::GILStats& stats : pyl::get_gil_stats() )
+					uRows += stats.strSite == strSite;
+				return uRows;
+			};
+			std::atomic<bool> bAcquired( false ), bReset( false );
+			std::thread early( [&bAcquired, &bReset]() {
+				{
+					pyl::GILGuard gil( "short lived" );
+				}
+				bAcquired = true;
+				while ( !bReset )
+					std::this_thread::yield();
+			} );
+			ThreadJoiner joinEarly( early, bReset );
+			{
+				pyl::GILRelease rel( "short lived wait" );
+				while ( !bAcquired )
+					std::this_thread::yield();
+			}
+			pyl::reset_gil_stats();
+			bReset = true;
+			{
+				pyl::GILRelease rel( "short lived join" );
+				early.join();
+			}
+			check( countSiteRows( "short lived" ) == 0, "exited thread's counts from before a reset" );
+
+			{
+				pyl::GILRelease rel( "short lived join" );
+				for ( int i = 0; i < 10; i++ )
+					std::thread( []() { pyl::GILGuard gil( "short lived" ); } ).join();
+			}
+			check( countSiteRows( "short lived" ) == 1, "one row for exited threads" );
+			check( getStats( "exited threads", "short lived" ).uAcquires == 10, "exited threads' acquisitions" );
+			std::cout << "GIL statistics checked" << std::endl;
+#else
+			check( pyl::get_gil_stats().empty(), "no GIL statistics without PYL_GIL_STATS" );
+			std::cout << "GIL statistics not built (PYL_GIL_STATS is off)" << std::endl;
+#endif
+
+			bDone = true;
+			{
+				pyl::GILRelease rel( "main join" );
+				worker.join();
+			}
+		}
+
+		{
+			// Several producers push into a channel too small to hold everything, so they
+			// have to wait for room, while python drains it. Nothing should be lost or repeated
+			const int64_t nProducers = 4, nPerProducer = 20000;
+			pyl::Channel<int64_t> channel( 64 );
+			std::vector<std::thread> vProducers;
+			for ( int64_t p = 0; p < nProducers; p++ )
+				vProducers.emplace_back( [&channel, p, nPerProducer]() {
+					for ( int64_t i = 0; i < nPerProducer; i++ )
+						channel.Push( p * nPerProducer + i );
+				} );
+			std::thread closer( [&channel, &vProducers]() {
+				for ( std::thread& producer : vProducers )
+					producer.join();
+				channel.Close();
+			} );
+
+			pyl::run_cmd( "def drain(ch):\n"
+						  "    count, total = 0, 0\n"
+						  "    for batch in ch:\n"
+						  "        count += len(batch)\n"
+						  "        total += sum(batch)\n"
+						  "    return count, total" );
+			std::tuple<int64_t, int64_t> tupDrained = pyl::main().call( "drain", channel.GetPyObject() );
+			{
+				pyl::GILRelease rel( "channel join" );
+				closer.join();
+			}
+
+			const int64_t nItems = nProducers * nPerProducer;
+			check( std::get<0>( tupDrained ) == nItems, "items popped from the channel" );
+			check( std::get<1>( tupDrained ) == nItems * ( nItems - 1 ) / 2, "sum of items popped from the channel" );
+			check( channel.Push( 0 ) == false, "pushing into a closed channel" );
+			std::cout << "Channel with several producers checked" << std::endl;
+		}
+
+		{
+			// Iterate from a thread that doesn't hold the GIL, letting go of items (which hold
+			// python objects) between chunks and when we stop partway through a chunk
+			pyl::run_cmd( "def gen_objects(n):\n    for i in range(n):\n        yield [i]\n"
+						  "def gen_raises():\n    yield 1\n    raise ValueError('gen_raises')" );
+			pyl::Object obGenerator = pyl::main().call( "gen_objects", 100 );
+			int nItems( 0 );
+			bool bRaised( false ), bErrorLeft( true );
+			pyl::Object obRaises = pyl::main().call( "gen_raises" );
+			std::thread iterating( [&]() {
+				{
+					pyl::Iterable<GILCheckedItem> itItems( obGenerator, 8 );
+					for ( [[maybe_unused]] GILCheckedItem& item : itItems )
+						if ( ++nItems == 20 )
+							break;
+				}
+
+				// An error from python becomes an exception, and doesn't stay set
+				try
+				{
+					for ( int n : pyl::iterate<int>( obRaises ) )
+						(void) n;
+				}
+				catch ( pyl::runtime_error& )
+				{
+					bRaised = true;
+					pyl::GILGuard gil( "test iterate" );
+					bErrorLeft = PyErr_Occurred() != nullptr;
+				}
+			} );
+			{
+				pyl::GILRelease rel( "test iterate" );
+				iterating.join();
+			}
+			check( nItems == 20, "items iterated" );
+			check( GILCheckedItem::s_nUnguardedFrees == 0, "items let go of without the GIL (" + std::to_string( GILCheckedItem::s_nUnguardedFrees ) + ")" );
+			check( bRaised && !bErrorLeft, "python error while iterating" );
+			std::cout << "Iterating from another thread checked" << std::endl;
+		}
+
+		// Shut down the interpreter
+		pyl::finalize();
+
+		return EXIT_SUCCESS;
+	}
+	// These exceptions are thrown when something in pyliaison
+	// goes wrong, but they're a child of std::runtime_error
+	catch ( pyl::runtime_error e )
+	{
+		std::cout << e.what() << std::endl;
+		pyl::print_error();
+		pyl::finalize();
+		return EXIT_FAILURE;
+	}
+}